@@ -2,12 +2,17 @@
 /// @brief A parser of bed format file 
 
 #pragma once
-#include <boost/algorithm/string/classification.hpp>
-#include <boost/algorithm/string/split.hpp>
-#include <boost/spirit/include/qi.hpp>
 #include <Biovoltron/format/bed/header.hpp>
 #include <Biovoltron/format/bed/is_tuple_type.hpp>
 #include <Biovoltron/format/bed/is_vector_type.hpp>
+#include <Biovoltron/format/bed/block_span.hpp>
+#include <Biovoltron/format/bed/projection.hpp>
+#include <Biovoltron/format/bed/stats.hpp>
+#include <Biovoltron/format/bed/tokenizer.hpp>
+#include <Biovoltron/format/bed/formatter.hpp>
+#include <Biovoltron/format/bed/writer.hpp>
+#include <array>
+#include <string_view>
 #include <vector>
 #include <tuple>
 
@@ -15,17 +20,15 @@ namespace biovoltron::format{
 
 using BEDHeader = bed::Header;
 
-/// @class BED
-/// @brief BED class which store BED data and BED header.
+/// @class BEDRecord
+/// @brief One data line of a BED file, without any header.
 ///
 /// Member variable<br>
-///         BEDHeader& header<br>
 ///         TupleType data<br>   
 ///
 /// Member functions<br>
 ///         to_string<br>
 ///         set_bed_data<br>
-///         dump<br>
 ///         get_obj<br>
 ///         fill<br>
 ///         to_comma_delimited_string<br>
@@ -35,85 +38,94 @@ using BEDHeader = bed::Header;
 ///         operator>>
 ///         operator<<
 ///     
-/// This class store BED data and header from an BED format file.
-/// The BED class only stores one data entry from the BED file. 
-///  reference.
+/// The lean record type: containers that keep the header once for the whole
+/// file (BEDFile, BEDTable, BEDParallelParser) store BEDRecord.
 
     template<class TupleType = std::tuple <std::string, uint32_t, uint32_t> >
-    class BED
+    class BEDRecord
     { 
       public:
         
         static_assert( IsTupleType<TupleType>::value, "ARGUMENT IS NOT A TUPLE");
         
 
-        void set_bed_data(std::string& str)
+        void set_bed_data(std::string_view str)
         {
-            constexpr auto tup_size = std::tuple_size<TupleType>::value;
-            std::vector<std::string> split_string;
-            boost::split( split_string, str, boost::is_any_of( " \t" ), boost::token_compress_on );
+            static_assert( !bed::BlockStore<TupleType>::enabled,
+                           "BLOCKSPAN COLUMNS ARE ONLY FILLED BY BEDFILE" );
+
+            // trailing bed::Skip columns are not even split
+            constexpr auto col_num = bed::parsed_columns<TupleType>();
+            std::array<std::string_view, col_num> split_string;
+            {
+                bed::StageTimer timer(bed::Stage::tokenize);
+                bed::split_fields(str, split_string);
+            }
 
-            fill<TupleType, tup_size>(data, split_string);
+            bed::StageTimer timer(bed::Stage::convert);
+            fill<TupleType, col_num>(data, split_string);
         }
 
 
-        friend std::istream& operator>>(std::istream& is, BED<TupleType>& bed)
+        friend std::istream& operator>>(std::istream& is, BEDRecord<TupleType>& bed)
         {
             get_obj(is, bed);
             return is;
         }
 
-        friend std::ostream& operator<<(std::ostream& os, BED<TupleType>& bed)
+        friend std::ostream& operator<<(std::ostream& os, const BEDRecord<TupleType>& bed)
         {
             os << bed.to_string()<<"\n";
             return os;
         }
 
         
-        std::string to_string()
+        std::string to_string() const
         {
+            bed::StageTimer timer(bed::Stage::format);
             std::string str;
-            constexpr auto tup_size = std::tuple_size<TupleType>::value;
-            
-            this->to_string<TupleType, tup_size>(this->data, str);
-            
-            str.erase(str.end()-1);
+            bed::append_record(str, this->data);
+            if constexpr(bed::stats_enabled)
+                bed::stats().add_formatted(str.size());
             return str;
         }
 
 
-        static std::istream& get_obj(std::istream& is, BED<TupleType>& bed)
+        static std::istream& get_obj(std::istream& is, BEDRecord<TupleType>& bed)
         {
             std::string str;
-            if(std::getline(is, str))
+            bool ok;
+            {
+                bed::StageTimer timer(bed::Stage::read);
+                ok = bool(std::getline(is, str));
+            }
+            if(ok)
+            {
+                if constexpr(bed::stats_enabled)
+                    bed::stats().add_read(str.size() + 1);
                 bed.set_bed_data(str);
+            }
 
             return is;
         }
 
-        static void dump(std::ostream& os, std::vector<BED>& v_bed)
-        {
-            if(v_bed.size() == 0)
-                return;
-
-            os << v_bed[0].header.to_string() << "\n";
-
-            for(auto& bed: v_bed)
-                os << bed.to_string() << "\n";
-        }
-        
-
         template<int i, class TUPLETYPE>
         using element_t = std::tuple_element_t<i, TUPLETYPE>;
 
-        template<class TUPLETYPE, int i>
-        void fill(TUPLETYPE& t, std::vector<std::string>& split_str)
+        /// @brief Convert split fields into the tuple, column by column.
+        ///
+        /// FIELDS is any indexable container of std::string or
+        /// std::string_view, so fields can also refer to a mapped file.
+        /// col is the column a nested tuple belongs to, for the error
+        /// counters of bed::stats().
+        template<class TUPLETYPE, int i, int col = -1, class FIELDS>
+        void fill(TUPLETYPE& t, FIELDS& split_str)
         {
             if constexpr(i == 0)
                 return;
             else
             {
-                fill<TUPLETYPE, i-1>(t, split_str);
+                fill<TUPLETYPE, i-1, col>(t, split_str);
 
                 if constexpr( std::is_same<char, 
                                         element_t<i-1, TUPLETYPE>
@@ -123,36 +135,54 @@ using BEDHeader = bed::Header;
                 }
                 else if constexpr ( std::is_integral<element_t<i-1, TUPLETYPE>>::value)
                 {
-                    std::get<i-1>(t) = stoi(split_str[i-1]);
+                    bed::convert_column(col < 0 ? i-1 : col, [&]
+                    {
+                        std::get<i-1>(t) = bed::to_integral<element_t<i-1, TUPLETYPE>>(split_str[i-1]);
+                    });
                 }
                 else if constexpr( std::is_same<std::string, 
                                         element_t<i-1, TUPLETYPE>
                                         >::value )
                 {
+                    const auto capacity = std::get<i-1>(t).capacity();
                     std::get<i-1>(t) = split_str[i-1];
+                    bed::count_growth(std::get<i-1>(t), capacity);
                 }
-                else if constexpr( std::is_same<std::string, 
+                else if constexpr( IsVectorType<
+                                    element_t<i-1, TUPLETYPE>
+                                        >::value )
+                {
+                    const auto capacity = std::get<i-1>(t).capacity();
+                    bed::parse_list(split_str[i-1], std::get<i-1>(t));
+                    bed::count_growth(std::get<i-1>(t), capacity);
+                }
+                else if constexpr( bed::IsBlockSpan<
+                                    element_t<i-1, TUPLETYPE>
+                                        >::value )
+                {
+                    // stored flat by BEDFile; the other readers reject
+                    // such a TupleType at compile time
+                }
+                else if constexpr( std::is_same<bed::Skip,
                                         element_t<i-1, TUPLETYPE>
                                         >::value )
                 {
-                    std::get<i-1>(t) = split_str[i-1];
                 }
-                else if constexpr( IsVectorType<
+                else if constexpr( bed::IsLazy<
                                     element_t<i-1, TUPLETYPE>
                                         >::value )
                 {
-                    boost::spirit::qi::phrase_parse(split_str[i-1].begin(), split_str[i-1].end(), 
-                    boost::spirit::qi::int_ % ',', boost::spirit::ascii::space, std::get<i-1>(t));
+                    std::get<i-1>(t).set_raw(split_str[i-1]);
                 }
                 else   // tuple type
                 {
                     using nested_tuple = element_t<i-1, TUPLETYPE>;
                     static_assert( IsTupleType<nested_tuple>::value, "ARGUMENT IS NOT A TUPLE");
                     
-                    std::vector<std::string> split_str2;
-                    boost::split( split_str2, split_str[i-1], boost::is_any_of( "," ), boost::token_compress_on );
+                    std::array<std::string_view, std::tuple_size<nested_tuple>::value> split_str2;
+                    bed::split_list(split_str[i-1], split_str2);
                     
-                    fill<nested_tuple, std::tuple_size<nested_tuple>::value>(std::get<i-1>(t), split_str2);
+                    fill<nested_tuple, std::tuple_size<nested_tuple>::value, col < 0 ? i-1 : col>(std::get<i-1>(t), split_str2);
                 }
             }
         }
@@ -160,60 +190,60 @@ using BEDHeader = bed::Header;
         template<class...Ts>
         void to_comma_delimited_string( std::tuple<Ts...>& t, std::string& str)
         {
-            std::apply ([&str] (const auto &... elem)
-                        {
-                            str += ((std::to_string(elem) + ",") + ...); 
-                        },
-                        t);
+            bed::append_comma_delimited(str, t);
         }
 
         template<class TUPLETYPE, int i>
         void to_string(TUPLETYPE& t, std::string& str)
         {
-            if constexpr(i == 0)
-                return;
-            else
-            {
-                to_string<TUPLETYPE, i-1>(t, str);
+            bed::append_columns<TUPLETYPE, i>(str, t);
+        }
 
-                if constexpr( std::is_same<char, 
-                                        element_t<i-1, TUPLETYPE>
-                                        >::value )
-                {
-                    str += std::get<i-1>(t);
-                }
-                else if constexpr ( std::is_integral<element_t<i-1, TUPLETYPE>>::value)
-                {
-                    str += std::to_string(std::get<i-1>(t));
-                }
-                else if constexpr( std::is_same<std::string, 
-                                        element_t<i-1, TUPLETYPE>
-                                        >::value )
-                {
-                    str += std::get<i-1>(t);
-                }
-                else if constexpr( IsVectorType<
-                                    element_t<i-1, TUPLETYPE>
-                                        >::value )
-                {
-                    for(auto it = std::get<i-1>(t).begin(); it != std::get<i-1>(t).end(); it++)
-                        str += std::to_string(*it) + ",";
-                }
-                else   // tuple type
-                {
-                    using nested_tuple = element_t<i-1, TUPLETYPE>;
-                    //static_assert( IsTupleType<nested_tuple>::value, "ARGUMENT IS NOT A TUPLE");
-                    
-                    to_comma_delimited_string(std::get<i-1>(t), str);
-                }
-            
-                str += "\t";
-            }
+        TupleType data;
+
+    };
+
+/// @class BED
+/// @brief BED class which store BED data and BED header.
+///
+/// Member variable<br>
+///         BEDHeader header<br>
+///         TupleType data<br>   
+///
+/// Member functions<br>
+///         dump<br>
+///         and the ones of BEDRecord<br>
+///     
+/// This class store BED data and header from an BED format file.
+/// The BED class only stores one data entry from the BED file. 
+/// Every object carries its own copy of the header; use BEDFile to
+/// keep the header once for a whole file.
+
+    template<class TupleType = std::tuple <std::string, uint32_t, uint32_t> >
+    class BED : public BEDRecord<TupleType>
+    { 
+      public:
+
+        static void dump(std::ostream& os, std::vector<BED>& v_bed)
+        {
+            BEDWriter<TupleType> writer(os);
+            writer.dump(v_bed);
         }
 
         BEDHeader header;
-        TupleType data;
 
     };
 
+    namespace bed {
+
+        template<class T>
+        void convert_field(std::string_view field, T& value)
+        {
+            std::array<std::string_view, 1> fields{ field };
+            BEDRecord<std::tuple<T>> record;
+            record.template fill<std::tuple<T>, 1>(record.data, fields);
+            value = std::move(std::get<0>(record.data));
+        }
+    }
+
 }
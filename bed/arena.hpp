@@ -0,0 +1,315 @@
+/// @file arena.hpp
+/// @brief Arena-backed BED loading: interned chrom, bump-allocated strings
+
+#pragma once
+#include <Biovoltron/format/bed.hpp>
+#include <Biovoltron/format/bed/array_view.hpp>
+#include <Biovoltron/format/bed/chrom_dict.hpp>
+#include <Biovoltron/format/bed/mmap_reader.hpp>
+#include <Biovoltron/format/bed/parallel_parser.hpp>
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <string_view>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace biovoltron::format{
+
+    namespace bed {
+
+/// @class Arena
+/// @brief Bump allocator handing out memory from large blocks, all freed at once.
+///
+/// Memory handed out stays in place when the arena is moved, so views into
+/// it survive moving the arena into its owner.
+        class Arena
+        {
+          public:
+
+            explicit Arena(std::size_t block_size = std::size_t(1) << 20)
+                : block_size(block_size)
+            {}
+
+            Arena(Arena&&) = default;
+            Arena& operator=(Arena&&) = default;
+
+            void* allocate(std::size_t n, std::size_t align = alignof(std::max_align_t))
+            {
+                std::size_t pos = (used + align - 1) & ~(align - 1);
+                if(blocks.empty() || pos + n > capacity)
+                {
+                    capacity = std::max(block_size, n);
+                    // new char[] is aligned for any fundamental type
+                    blocks.emplace_back(new char[capacity]);
+                    pos = 0;
+                    total += capacity;
+                }
+                used = pos + n;
+                return blocks.back().get() + pos;
+            }
+
+            /// @brief Copy str into the arena.
+            std::string_view store(std::string_view str)
+            {
+                if(str.empty())
+                    return {};
+                char* p = static_cast<char*>(allocate(str.size(), 1));
+                std::memcpy(p, str.data(), str.size());
+                return { p, str.size() };
+            }
+
+            /// @brief Copy the elements of v into the arena.
+            template<class T>
+            ArrayView<T> store(const std::vector<T>& v)
+            {
+                if(v.empty())
+                    return {};
+                T* p = static_cast<T*>(allocate(v.size() * sizeof(T), alignof(T)));
+                std::copy(v.begin(), v.end(), p);
+                return { p, v.size() };
+            }
+
+            /// @brief Bytes reserved from the system.
+            std::size_t capacity_bytes() const { return total; }
+
+            void clear()
+            {
+                blocks.clear();
+                used = capacity = total = 0;
+            }
+
+          private:
+
+            std::size_t block_size;
+            std::vector<std::unique_ptr<char[]>> blocks;
+            std::size_t used = 0, capacity = 0, total = 0;
+        };
+
+        /// @brief Storage type of column I in an arena record: chrom becomes
+        ///        a ChromDict ID, strings and lists become views into the arena.
+        template<class T, std::size_t I>
+        struct ArenaStorage
+        {
+            using type = T;
+        };
+
+        template<std::size_t I>
+        struct ArenaStorage<std::string, I>
+        {
+            using type = std::string_view;
+        };
+
+        template<>
+        struct ArenaStorage<std::string, Col::chrom>
+        {
+            using type = ChromDict::id_type;
+        };
+
+        template<class T, std::size_t I>
+        struct ArenaStorage<std::vector<T>, I>
+        {
+            using type = ArrayView<T>;
+        };
+
+        template<class TupleType, class Seq>
+        struct ArenaTupleOf;
+
+        template<class TupleType, std::size_t... Is>
+        struct ArenaTupleOf<TupleType, std::index_sequence<Is...>>
+        {
+            using type = std::tuple< typename ArenaStorage<std::tuple_element_t<Is, TupleType>, Is>::type... >;
+        };
+
+        template<class TupleType>
+        using ArenaTuple = typename ArenaTupleOf<TupleType,
+                                       std::make_index_sequence<std::tuple_size<TupleType>::value>>::type;
+    }
+
+/// @class BEDArenaFile
+/// @brief BED records loaded without a heap allocation per field.
+///
+/// The chrom column is interned into one ChromDict shared by all records,
+/// string columns are std::string_view and list columns bed::ArrayView into
+/// bump-allocated arenas (one per parsing task), so loading costs a handful
+/// of large allocations instead of several per record and parsing threads
+/// do not contend on the allocator. Everything is released together with
+/// the file. Rows convert back to BEDRecord<TupleType> with get().
+///
+///     auto file = BEDArenaFile<TupleType>::load(path);
+///     auto& [ chrom_id, start, end, name ] = file[i];
+///     std::string_view chrom = file.chrom(i);
+    template<class TupleType = std::tuple <std::string, uint32_t, uint32_t> >
+    class BEDArenaFile
+    {
+      public:
+
+        static_assert( IsTupleType<TupleType>::value, "ARGUMENT IS NOT A TUPLE");
+        static_assert( std::is_same<std::string, std::tuple_element_t<bed::Col::chrom, TupleType>>::value,
+                       "CHROM COLUMN MUST BE A STRING");
+
+        using record_type = bed::ArenaTuple<TupleType>;
+
+        std::size_t size() const { return records.size(); }
+        bool empty() const { return records.empty(); }
+
+        const record_type& operator[](std::size_t i) const { return records[i]; }
+        auto begin() const { return records.begin(); }
+        auto end() const { return records.end(); }
+
+        const std::string& chrom(std::size_t i) const { return dict.name(std::get<bed::Col::chrom>(records[i])); }
+        const bed::ChromDict& chrom_dict() const { return dict; }
+
+        /// @brief Bytes held by the arenas.
+        std::size_t arena_bytes() const
+        {
+            std::size_t n = 0;
+            for(auto& arena: arenas)
+                n += arena.capacity_bytes();
+            return n;
+        }
+
+        BEDRecord<TupleType> get(std::size_t i) const
+        {
+            BEDRecord<TupleType> record;
+            get_impl(records[i], record.data, std::make_index_sequence<std::tuple_size<TupleType>::value>{});
+            return record;
+        }
+
+        /// @brief Parse data lines (no header lines) held in memory.
+        static BEDArenaFile parse(std::string_view data, std::size_t thread_num = bed::default_thread_num())
+        {
+            thread_num = std::max<std::size_t>(thread_num, 1);
+            auto chunks = bed::split_by_lines(data, thread_num == 1 ? 1 : thread_num * 4);
+
+            // every chunk parses straight into its slice of the result
+            std::vector<std::size_t> offsets(chunks.size() + 1, 0), counts(chunks.size(), 0);
+            for(std::size_t i = 0; i < chunks.size(); i++)
+                offsets[i + 1] = offsets[i] + std::count(chunks[i].begin(), chunks[i].end(), '\n')
+                               + (chunks[i].back() != '\n');
+
+            BEDArenaFile file;
+            file.records.resize(offsets.back());
+            std::vector<bed::ChromDict> dicts(chunks.size());
+            file.arenas.resize(chunks.size());
+
+            bed::parallel_for(chunks.size(), thread_num, [&](std::size_t i)
+            {
+                counts[i] = parse_chunk(chunks[i], file.records.data() + offsets[i], dicts[i], file.arenas[i]);
+            });
+
+            // chunk-local chrom IDs to the shared dictionary, in first-seen order;
+            // empty lines leave holes that are closed on the way
+            std::size_t n = 0;
+            for(std::size_t i = 0; i < chunks.size(); i++)
+            {
+                std::vector<bed::ChromDict::id_type> remap(dicts[i].size());
+                for(bed::ChromDict::id_type id = 0; id < remap.size(); id++)
+                    remap[id] = file.dict.intern(dicts[i].name(id));
+                for(std::size_t k = offsets[i]; k < offsets[i] + counts[i]; k++, n++)
+                {
+                    auto& id = std::get<bed::Col::chrom>(file.records[k]);
+                    id = remap[id];
+                    if(n != k)
+                        file.records[n] = file.records[k];
+                }
+            }
+            file.records.resize(n);
+            return file;
+        }
+
+        static BEDArenaFile load(const std::string& path, std::size_t thread_num = bed::default_thread_num())
+        {
+            BEDMmapReader<TupleType> reader(path);
+            auto file = parse(reader.body_view(), thread_num);
+            file.header = reader.header();
+            return file;
+        }
+
+        BEDHeader header;
+
+      private:
+
+        static std::size_t parse_chunk(std::string_view chunk, record_type* out,
+                                       bed::ChromDict& dict, bed::Arena& arena)
+        {
+            constexpr auto tup_size = std::tuple_size<TupleType>::value;
+            const char* cur  = chunk.data();
+            const char* last = chunk.data() + chunk.size();
+            std::size_t n = 0;
+
+            std::array<std::string_view, tup_size> fields;
+            while(cur != last)
+            {
+                std::string_view line = BEDMmapReader<TupleType>::next_line(cur, last);
+                if(line.empty())
+                    continue;
+                bed::split_fields(line, fields);
+                fill<TupleType, tup_size, true>(out[n++], fields, dict, arena);
+            }
+            return n;
+        }
+
+        /// @brief BEDRecord::fill, with chrom interned and the string and
+        ///        list columns stored in the arena.
+        template<class TUPLETYPE, int i, bool top, class STORED, class FIELDS>
+        static void fill(STORED& t, FIELDS& split_str, bed::ChromDict& dict, bed::Arena& arena)
+        {
+            if constexpr(i == 0)
+                return;
+            else
+            {
+                fill<TUPLETYPE, i-1, top>(t, split_str, dict, arena);
+
+                using element = std::tuple_element_t<i-1, TUPLETYPE>;
+                auto& field = std::get<i-1>(t);
+
+                if constexpr( top && i-1 == bed::Col::chrom )
+                    field = dict.intern(split_str[i-1]);
+                else if constexpr( std::is_same<char, element>::value )
+                    field = split_str[i-1][0];
+                else if constexpr( std::is_integral<element>::value )
+                    field = bed::to_integral<element>(split_str[i-1]);
+                else if constexpr( std::is_same<std::string, element>::value )
+                    field = arena.store(split_str[i-1]);
+                else if constexpr( IsVectorType<element>::value )
+                {
+                    static thread_local element list;
+                    bed::parse_list(split_str[i-1], list);
+                    field = arena.store(list);
+                }
+                else   // tuple type
+                {
+                    static_assert( IsTupleType<element>::value, "ARGUMENT IS NOT A TUPLE");
+                    std::array<std::string_view, std::tuple_size<element>::value> split_str2;
+                    bed::split_list(split_str[i-1], split_str2);
+                    fill<element, std::tuple_size<element>::value, false>(field, split_str2, dict, arena);
+                }
+            }
+        }
+
+        template<std::size_t... Is>
+        void get_impl(const record_type& stored, TupleType& data, std::index_sequence<Is...>) const
+        {
+            (get_column<Is>(std::get<Is>(stored), std::get<Is>(data)), ...);
+        }
+
+        template<std::size_t i, class S, class T>
+        void get_column(const S& stored, T& value) const
+        {
+            if constexpr( i == bed::Col::chrom )
+                value = dict.name(stored);
+            else if constexpr( IsVectorType<T>::value )
+                value.assign(stored.begin(), stored.end());
+            else
+                value = T(stored);
+        }
+
+        std::vector<record_type> records;
+        bed::ChromDict dict;
+        std::vector<bed::Arena> arenas;
+    };
+
+}
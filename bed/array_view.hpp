@@ -0,0 +1,29 @@
+/// @file array_view.hpp
+/// @brief Non-owning view of a contiguous array
+
+#pragma once
+#include <cstddef>
+
+namespace biovoltron::format::bed {
+
+/// @class ArrayView
+/// @brief Pointer and length of a contiguous array owned by someone else
+///        (a mapped file, a column store ...).
+    template<class T>
+    struct ArrayView
+    {
+        using value_type = T;
+        using const_iterator = const T*;
+
+        const T* ptr = nullptr;
+        std::size_t n = 0;
+
+        const T* data() const { return ptr; }
+        std::size_t size() const { return n; }
+        bool empty() const { return n == 0; }
+        const T& operator[](std::size_t i) const { return ptr[i]; }
+        const T* begin() const { return ptr; }
+        const T* end() const { return ptr + n; }
+    };
+
+}
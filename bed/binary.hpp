@@ -0,0 +1,598 @@
+/// @file binary.hpp
+/// @brief Column oriented binary cache of BED records, read through mmap
+///
+/// Layout (native little endian, every section 8 byte aligned):
+///
+///     FileHeader       magic, version, record number, section offsets
+///     schema           text descriptor of TupleType, e.g. "s,u4,u4,s,u2,c,V4"
+///     track line       the bed::Header track line, may be empty
+///     chrom dict       uint32 count, then uint32 length + bytes per name
+///     region index     per chrom ID: first row, last row + 1, max length
+///     column table     uint64 offset of every column block
+///     column blocks    chrom: uint32 IDs; char / integral: T[n];
+///                      std::string, std::vector<T>: uint64 offsets[n + 1] then the bytes / T;
+///                      nested tuple: one T[n] array per element
+///
+/// Rows are grouped by chrom and sorted by chromStart inside a chrom, so a
+/// region query is a binary search on the chromStart column of that chrom.
+
+#pragma once
+#include <Biovoltron/format/bed.hpp>
+#include <Biovoltron/format/bed/array_view.hpp>
+#include <Biovoltron/format/bed/chrom_dict.hpp>
+#include <Biovoltron/format/bed/mapped_file.hpp>
+#include <Biovoltron/format/bed/region.hpp>
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace biovoltron::format{
+
+    namespace bed {
+
+        namespace detail {
+
+            template<class T>
+            struct Schema
+            {
+                static std::string get()
+                {
+                    static_assert( std::is_integral<T>::value, "UNSUPPORTED COLUMN TYPE");
+                    if constexpr( std::is_same<char, T>::value )
+                        return "c";
+                    else
+                        return (std::is_signed<T>::value ? "i" : "u") + std::to_string(sizeof(T));
+                }
+            };
+
+            template<>
+            struct Schema<std::string>
+            {
+                static std::string get() { return "s"; }
+            };
+
+            template<class T>
+            struct Schema<std::vector<T>>
+            {
+                static std::string get() { return "V" + Schema<T>::get(); }
+            };
+
+            template<class... Ts>
+            struct Schema<std::tuple<Ts...>>
+            {
+                static std::string get()
+                {
+                    std::string str;
+                    ((str += Schema<Ts>::get() + ","), ...);
+                    str.pop_back();
+                    return str;
+                }
+            };
+
+            struct FileHeader
+            {
+                char magic[6];
+                uint16_t version;
+                uint32_t byte_order;
+                uint32_t column_num;
+                uint64_t record_num;
+                uint64_t schema_offset, track_offset, dict_offset, index_offset, column_offset;
+            };
+
+            struct IndexEntry
+            {
+                uint64_t row_begin, row_end, max_len;
+            };
+
+            constexpr char magic[6] = { 'B', 'E', 'D', 'B', 'I', 'N' };
+            constexpr uint16_t version = 1;
+            constexpr uint32_t byte_order = 0x01020304;
+
+            inline std::size_t align8(std::size_t n)
+            {
+                return (n + 7) & ~std::size_t(7);
+            }
+        }
+
+        /// @brief Text descriptor of the columns of TupleType stored in a binary file.
+        template<class TupleType>
+        std::string schema_of()
+        {
+            return detail::Schema<TupleType>::get();
+        }
+    }
+
+/// @class BEDBinaryWriter
+/// @brief Converts BED records into the binary cache format (see binary.hpp).
+///
+///     BEDBinaryWriter<TupleType>::write("peaks.bedbin", v_bed, h);
+    template<class TupleType = std::tuple <std::string, uint32_t, uint32_t> >
+    class BEDBinaryWriter
+    {
+      public:
+
+        static_assert( std::is_same<std::string, std::tuple_element_t<bed::Col::chrom, TupleType>>::value,
+                       "CHROM COLUMN MUST BE A STD::STRING");
+
+        static constexpr std::size_t col_num = std::tuple_size<TupleType>::value;
+
+        /// @brief Write records (anything holding TupleType in .data) to path.
+        template<class Records>
+        static void write(const std::string& path, const Records& records, const BEDHeader& header = BEDHeader())
+        {
+            std::vector<const TupleType*> rows;
+            for(auto& bed: records)
+                rows.push_back(&bed.data);
+
+            bed::ChromDict dict;
+            std::vector<uint32_t> ids;
+            ids.reserve(rows.size());
+            for(auto row: rows)
+                ids.push_back(dict.intern(std::get<bed::Col::chrom>(*row)));
+
+            // group by chrom, then chromStart
+            std::vector<std::size_t> order(rows.size());
+            std::iota(order.begin(), order.end(), 0);
+            std::stable_sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b)
+            {
+                if(ids[a] != ids[b])
+                    return ids[a] < ids[b];
+                return std::get<bed::Col::chromStart>(*rows[a]) < std::get<bed::Col::chromStart>(*rows[b]);
+            });
+
+            std::vector<const TupleType*> sorted(rows.size());
+            std::vector<uint32_t> sorted_ids(rows.size());
+            for(std::size_t i = 0; i < order.size(); i++)
+            {
+                sorted[i] = rows[order[i]];
+                sorted_ids[i] = ids[order[i]];
+            }
+
+            std::ofstream ofs(path, std::ios::binary | std::ios::trunc);
+            if(!ofs)
+                throw std::runtime_error("bed: cannot write " + path);
+
+            bed::detail::FileHeader fh{};
+            std::memcpy(fh.magic, bed::detail::magic, sizeof(fh.magic));
+            fh.version    = bed::detail::version;
+            fh.byte_order = bed::detail::byte_order;
+            fh.column_num = col_num;
+            fh.record_num = sorted.size();
+            put(ofs, fh);
+
+            fh.schema_offset = put_string(ofs, bed::schema_of<TupleType>());
+            fh.track_offset  = put_string(ofs, header.track_line);
+
+            fh.dict_offset = align(ofs);
+            put(ofs, static_cast<uint32_t>(dict.size()));
+            for(std::size_t c = 0; c < dict.size(); c++)
+            {
+                put(ofs, static_cast<uint32_t>(dict.name(c).size()));
+                ofs.write(dict.name(c).data(), dict.name(c).size());
+            }
+
+            std::vector<bed::detail::IndexEntry> index(dict.size(), bed::detail::IndexEntry{0, 0, 0});
+            for(std::size_t r = 0; r < sorted.size(); r++)
+            {
+                auto& e = index[sorted_ids[r]];
+                if(e.row_end == 0)
+                    e.row_begin = r;
+                e.row_end = r + 1;
+                uint64_t len = std::get<bed::Col::chromEnd>(*sorted[r]) - std::get<bed::Col::chromStart>(*sorted[r]);
+                e.max_len = std::max(e.max_len, len);
+            }
+            fh.index_offset = align(ofs);
+            ofs.write(reinterpret_cast<const char*>(index.data()), index.size() * sizeof(index[0]));
+
+            std::vector<uint64_t> column_offsets(col_num);
+            fh.column_offset = align(ofs);
+            ofs.write(reinterpret_cast<const char*>(column_offsets.data()), col_num * sizeof(uint64_t));
+
+            write_columns(ofs, sorted, sorted_ids, column_offsets, std::make_index_sequence<col_num>());
+
+            ofs.seekp(fh.column_offset);
+            ofs.write(reinterpret_cast<const char*>(column_offsets.data()), col_num * sizeof(uint64_t));
+            ofs.seekp(0);
+            put(ofs, fh);
+
+            if(!ofs)
+                throw std::runtime_error("bed: error while writing " + path);
+        }
+
+      private:
+
+        template<class T>
+        static void put(std::ofstream& ofs, const T& v)
+        {
+            ofs.write(reinterpret_cast<const char*>(&v), sizeof(T));
+        }
+
+        template<class T>
+        static void put_array(std::ofstream& ofs, const std::vector<T>& v)
+        {
+            ofs.write(reinterpret_cast<const char*>(v.data()), v.size() * sizeof(T));
+        }
+
+        /// @brief Pad the stream to 8 bytes.
+        /// @return the aligned position
+        static uint64_t align(std::ofstream& ofs)
+        {
+            static const char zero[8] = {};
+            std::size_t pos = ofs.tellp();
+            ofs.write(zero, bed::detail::align8(pos) - pos);
+            return bed::detail::align8(pos);
+        }
+
+        static uint64_t put_string(std::ofstream& ofs, const std::string& str)
+        {
+            uint64_t pos = align(ofs);
+            put(ofs, static_cast<uint64_t>(str.size()));
+            ofs.write(str.data(), str.size());
+            return pos;
+        }
+
+        template<std::size_t... Is>
+        static void write_columns(std::ofstream& ofs, const std::vector<const TupleType*>& rows,
+                                  const std::vector<uint32_t>& ids, std::vector<uint64_t>& offsets,
+                                  std::index_sequence<Is...>)
+        {
+            ((offsets[Is] = align(ofs), write_column<Is>(ofs, rows, ids)), ...);
+        }
+
+        template<std::size_t i>
+        static void write_column(std::ofstream& ofs, const std::vector<const TupleType*>& rows,
+                                 const std::vector<uint32_t>& ids)
+        {
+            using T = std::tuple_element_t<i, TupleType>;
+
+            if constexpr( i == bed::Col::chrom )
+            {
+                put_array(ofs, ids);
+            }
+            else if constexpr( std::is_integral<T>::value )
+            {
+                std::vector<T> col;
+                col.reserve(rows.size());
+                for(auto row: rows)
+                    col.push_back(std::get<i>(*row));
+                put_array(ofs, col);
+            }
+            else if constexpr( std::is_same<std::string, T>::value || IsVectorType<T>::value )
+            {
+                std::vector<uint64_t> offsets(1, 0);
+                for(auto row: rows)
+                    offsets.push_back(offsets.back() + std::get<i>(*row).size());
+                put_array(ofs, offsets);
+                for(auto row: rows)
+                    ofs.write(reinterpret_cast<const char*>(std::get<i>(*row).data()),
+                              std::get<i>(*row).size() * sizeof(typename T::value_type));
+            }
+            else   // tuple type
+            {
+                write_tuple_column<i>(ofs, rows, std::make_index_sequence<std::tuple_size<T>::value>());
+            }
+        }
+
+        template<std::size_t i, std::size_t... Js>
+        static void write_tuple_column(std::ofstream& ofs, const std::vector<const TupleType*>& rows,
+                                       std::index_sequence<Js...>)
+        {
+            auto write_element = [&](auto j)
+            {
+                using E = std::tuple_element_t<decltype(j)::value, std::tuple_element_t<i, TupleType>>;
+                static_assert( std::is_integral<E>::value, "UNSUPPORTED NESTED COLUMN TYPE");
+                std::vector<E> col;
+                col.reserve(rows.size());
+                for(auto row: rows)
+                    col.push_back(std::get<decltype(j)::value>(std::get<i>(*row)));
+                align(ofs);
+                put_array(ofs, col);
+            };
+            (write_element(std::integral_constant<std::size_t, Js>()), ...);
+        }
+    };
+
+/// @class BEDBinaryReader
+/// @brief Memory maps a binary cache file and reads columns, rows and
+///        regions in place, without a parse step.
+///
+/// Opening checks the file header and schema, reads the chrom dictionary
+/// and checks that every section lies inside the file, without touching
+/// the rows, so a truncated file throws std::runtime_error. The rows are
+/// read straight from the mapping on access; field() and get() check the
+/// chrom ID and the string / list offsets of the row they read and throw
+/// std::runtime_error on a corrupt one.
+///
+///     BEDBinaryReader<TupleType> reader("peaks.bedbin");
+///     auto starts = reader.column<bed::Col::chromStart>();     // bed::ArrayView<uint32_t>
+///     for(auto row: reader.query("chr1", 1000, 2000))
+///         auto record = reader.get(row);
+    template<class TupleType = std::tuple <std::string, uint32_t, uint32_t> >
+    class BEDBinaryReader
+    {
+      public:
+
+        static constexpr std::size_t col_num = std::tuple_size<TupleType>::value;
+
+        template<std::size_t i>
+        using element_t = std::tuple_element_t<i, TupleType>;
+
+        explicit BEDBinaryReader(const std::string& path)
+            : file(path), path_(path)
+        {
+            if(file.size() < sizeof(bed::detail::FileHeader))
+                throw std::runtime_error("bed: not a binary BED file " + path);
+
+            std::memcpy(&fh, file.data(), sizeof(fh));
+            if(std::memcmp(fh.magic, bed::detail::magic, sizeof(fh.magic)) != 0
+               || fh.version != bed::detail::version
+               || fh.byte_order != bed::detail::byte_order)
+                throw std::runtime_error("bed: not a binary BED file " + path);
+
+            if(fh.column_num != col_num)
+                throw std::runtime_error("bed: schema of " + path + " has " + std::to_string(fh.column_num) +
+                                         " columns, expected " + std::to_string(col_num));
+            if(read_string(fh.schema_offset, path) != bed::schema_of<TupleType>())
+                throw std::runtime_error("bed: schema of " + path + " is " +
+                                         std::string(read_string(fh.schema_offset, path)) +
+                                         ", expected " + bed::schema_of<TupleType>());
+
+            auto track_line = read_string(fh.track_offset, path);
+            if(!track_line.empty())
+            {
+                std::string str(track_line);
+                header_.set(str);
+            }
+
+            uint64_t p = fh.dict_offset;
+            check(p, sizeof(uint32_t), path);
+            uint32_t chrom_num = load<uint32_t>(file.data() + p);
+            p += sizeof(uint32_t);
+            for(uint32_t c = 0; c < chrom_num; c++)
+            {
+                check(p, sizeof(uint32_t), path);
+                uint32_t len = load<uint32_t>(file.data() + p);
+                p += sizeof(uint32_t);
+                check(p, len, path);
+                dict.intern(std::string_view(file.data() + p, len));
+                p += len;
+            }
+
+            // every section must lie inside the mapping: a truncated or
+            // corrupt file throws here instead of being read out of bounds
+            check_array(fh.index_offset, dict.size(), sizeof(bed::detail::IndexEntry), path);
+            index = reinterpret_cast<const bed::detail::IndexEntry*>(file.data() + fh.index_offset);
+            for(std::size_t c = 0; c < dict.size(); c++)
+                if(index[c].row_begin > index[c].row_end || index[c].row_end > fh.record_num)
+                    throw std::runtime_error("bed: corrupt index in binary BED file " + path);
+
+            check_array(fh.column_offset, col_num, sizeof(uint64_t), path);
+            column_offsets = reinterpret_cast<const uint64_t*>(file.data() + fh.column_offset);
+            check_columns(path, std::make_index_sequence<col_num>());
+        }
+
+        std::size_t size() const { return fh.record_num; }
+        const BEDHeader& header() const { return header_; }
+        const bed::ChromDict& chrom_dict() const { return dict; }
+
+        /// @brief Whole fixed width column i (char / integral, or the chrom IDs for column 0).
+        template<std::size_t i>
+        auto column() const
+        {
+            if constexpr( i == bed::Col::chrom )
+                return bed::ArrayView<uint32_t>{ base<uint32_t>(i), size() };
+            else
+            {
+                static_assert( std::is_integral<element_t<i>>::value, "COLUMN IS NOT FIXED WIDTH");
+                return bed::ArrayView<element_t<i>>{ base<element_t<i>>(i), size() };
+            }
+        }
+
+        /// @brief Field i of row, without copy: std::string columns give
+        ///        std::string_view, std::vector<T> columns bed::ArrayView<T>.
+        template<std::size_t i>
+        auto field(std::size_t row) const
+        {
+            using T = element_t<i>;
+
+            if constexpr( i == bed::Col::chrom )
+            {
+                const uint32_t id = base<uint32_t>(i)[row];
+                if(id >= dict.size())
+                    throw std::runtime_error("bed: corrupt chrom ID in row " + std::to_string(row)
+                                             + " of binary BED file " + path_);
+                return std::string_view(dict.name(id));
+            }
+            else if constexpr( std::is_integral<T>::value )
+                return base<T>(i)[row];
+            else if constexpr( std::is_same<std::string, T>::value )
+            {
+                auto [first, last] = span(i, row);
+                return std::string_view(data_of<char>(i) + first, last - first);
+            }
+            else if constexpr( IsVectorType<T>::value )
+            {
+                using V = typename T::value_type;
+                auto [first, last] = span(i, row);
+                return bed::ArrayView<V>{ data_of<V>(i) + first, last - first };
+            }
+            else   // tuple type
+                return tuple_field<i>(row, std::make_index_sequence<std::tuple_size<T>::value>());
+        }
+
+        void get(std::size_t row, BEDRecord<TupleType>& bed) const
+        {
+            get_impl(row, bed.data, std::make_index_sequence<col_num>());
+        }
+
+        BEDRecord<TupleType> get(std::size_t row) const
+        {
+            BEDRecord<TupleType> bed;
+            get(row, bed);
+            return bed;
+        }
+
+        /// @brief Call f(row) for every row overlapping [start, end) on chrom, in chromStart order.
+        template<class Callback>
+        void for_each_overlap(std::string_view chrom, uint32_t start, uint32_t end, Callback&& f) const
+        {
+            auto c = dict.find(chrom);
+            if(c == bed::ChromDict::npos)
+                return;
+
+            auto& e = index[c];
+            auto starts = column<bed::Col::chromStart>();
+            auto ends   = column<bed::Col::chromEnd>();
+
+            // nothing starting before start - max_len can reach start
+            uint64_t from = start > e.max_len ? start - e.max_len : 0;
+            auto first = std::lower_bound(starts.begin() + e.row_begin, starts.begin() + e.row_end, from,
+                                          [](auto s, uint64_t v){ return static_cast<uint64_t>(s) < v; });
+
+            for(std::size_t row = first - starts.begin(); row < e.row_end && starts[row] < end; row++)
+                if(start < ends[row])
+                    f(row);
+        }
+
+        std::vector<std::size_t> query(std::string_view chrom, uint32_t start, uint32_t end) const
+        {
+            std::vector<std::size_t> rows;
+            for_each_overlap(chrom, start, end, [&rows](std::size_t row){ rows.push_back(row); });
+            return rows;
+        }
+
+        std::vector<std::size_t> query(const bed::Region& region) const
+        {
+            return query(region.chrom, region.start, region.end);
+        }
+
+      private:
+
+        template<class T>
+        static T load(const char* p)
+        {
+            T v;
+            std::memcpy(&v, p, sizeof(T));
+            return v;
+        }
+
+        std::string_view read_string(uint64_t offset, const std::string& path) const
+        {
+            check(offset, sizeof(uint64_t), path);
+            uint64_t len = load<uint64_t>(file.data() + offset);
+            check(offset + sizeof(uint64_t), len, path);
+            return std::string_view(file.data() + offset + sizeof(uint64_t), len);
+        }
+
+        /// @brief Throw unless [offset, offset + len) lies inside the mapping.
+        void check(uint64_t offset, uint64_t len, const std::string& path) const
+        {
+            if(offset > file.size() || len > file.size() - offset)
+                throw std::runtime_error("bed: truncated or corrupt binary BED file " + path);
+        }
+
+        void check_array(uint64_t offset, uint64_t n, uint64_t elem_size, const std::string& path) const
+        {
+            if(n > file.size() / elem_size)
+                throw std::runtime_error("bed: truncated or corrupt binary BED file " + path);
+            check(offset, n * elem_size, path);
+        }
+
+        template<std::size_t... Is>
+        void check_columns(const std::string& path, std::index_sequence<Is...>) const
+        {
+            (check_column<Is>(path), ...);
+        }
+
+        template<std::size_t i>
+        void check_column(const std::string& path) const
+        {
+            using T = element_t<i>;
+            const uint64_t n = size();
+            const uint64_t offset = column_offsets[i];
+
+            // constant time: the rows themselves are checked as they are read
+            if constexpr( i == bed::Col::chrom )
+                check_array(offset, n, sizeof(uint32_t), path);
+            else if constexpr( std::is_integral<T>::value )
+                check_array(offset, n, sizeof(T), path);
+            else if constexpr( std::is_same<std::string, T>::value || IsVectorType<T>::value )
+            {
+                check_array(offset, n + 1, sizeof(uint64_t), path);
+                check_array(offset + (n + 1) * sizeof(uint64_t), base<uint64_t>(i)[n],
+                            sizeof(typename T::value_type), path);
+            }
+            else   // tuple type
+            {
+                uint64_t len = 0;
+                std::apply([&](auto... e)
+                {
+                    ((check_array(offset + len, n, sizeof(e), path), len += bed::detail::align8(n * sizeof(e))), ...);
+                }, T());
+            }
+        }
+
+        template<class T>
+        const T* base(std::size_t i) const
+        {
+            return reinterpret_cast<const T*>(file.data() + column_offsets[i]);
+        }
+
+        /// @brief [first, last) element range of a variable length column row;
+        ///        offsets[size()] was checked against the mapping on open.
+        std::pair<uint64_t, uint64_t> span(std::size_t i, std::size_t row) const
+        {
+            auto offsets = base<uint64_t>(i);
+            if(offsets[row] > offsets[row + 1] || offsets[row + 1] > offsets[size()])
+                throw std::runtime_error("bed: corrupt offsets in row " + std::to_string(row)
+                                         + " of binary BED file " + path_);
+            return { offsets[row], offsets[row + 1] };
+        }
+
+        template<class T>
+        const T* data_of(std::size_t i) const
+        {
+            return reinterpret_cast<const T*>(base<uint64_t>(i) + size() + 1);
+        }
+
+        template<std::size_t i, std::size_t... Js>
+        auto tuple_field(std::size_t row, std::index_sequence<Js...>) const
+        {
+            using T = element_t<i>;
+            std::size_t skip[] = { 0, bed::detail::align8(size() * sizeof(std::tuple_element_t<Js, T>))... };
+            std::partial_sum(std::begin(skip), std::end(skip), std::begin(skip));
+
+            const char* p = file.data() + column_offsets[i];
+            return T( reinterpret_cast<const std::tuple_element_t<Js, T>*>(p + skip[Js])[row]... );
+        }
+
+        template<std::size_t... Is>
+        void get_impl(std::size_t row, TupleType& data, std::index_sequence<Is...>) const
+        {
+            (assign(std::get<Is>(data), field<Is>(row)), ...);
+        }
+
+        template<class T, class V>
+        static void assign(T& to, const V& from)
+        {
+            if constexpr( IsVectorType<T>::value )
+                to.assign(from.begin(), from.end());
+            else
+                to = from;
+        }
+
+        bed::MappedFile file;
+        std::string path_;
+        bed::detail::FileHeader fh;
+        BEDHeader header_;
+        bed::ChromDict dict;
+        const bed::detail::IndexEntry* index = nullptr;
+        const uint64_t* column_offsets = nullptr;
+    };
+
+}
@@ -0,0 +1,192 @@
+/// @file block_span.hpp
+/// @brief Flattened (CSR) storage of list columns such as blockSizes / blockStarts
+
+#pragma once
+#include <Biovoltron/format/bed/array_view.hpp>
+#include <Biovoltron/format/bed/tokenizer.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <string_view>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace biovoltron::format::bed {
+
+/// @class BlockSpan
+/// @brief A list column slot viewing a slice of a BlockColumn.
+///
+/// Put it in the tuple instead of std::vector<T> to keep the lists of all
+/// records in one contiguous array:
+///
+///     using BED12Tuple = std::tuple<..., uint16_t,
+///                                   bed::BlockSpan<uint32_t>, bed::BlockSpan<uint32_t>>;
+///
+/// BEDRecord::fill leaves the slot alone; BEDFile owns the storage, fills it
+/// and points the slots at it. The spans are valid as long as the file is.
+/// Every other reader fails to compile for such a TupleType rather than
+/// leave the spans empty.
+    template<class T>
+    struct BlockSpan : ArrayView<T>
+    {};
+
+    template<class T>
+    struct IsBlockSpan
+    {
+        static const bool value = false;
+    };
+
+    template<class T>
+    struct IsBlockSpan<BlockSpan<T>>
+    {
+        static const bool value = true;
+    };
+
+/// @class BlockColumn
+/// @brief The values of one list column for many records, in compressed
+///        sparse row layout: record i owns values[offsets[i], offsets[i+1]).
+    template<class T>
+    struct BlockColumn
+    {
+        std::vector<T> values;
+        std::vector<std::size_t> offsets{ 0 };
+
+        std::size_t size() const { return offsets.size() - 1; }
+
+        /// @brief Parse the list of the next record.
+        void append(std::string_view field)
+        {
+            append_list(field, values);
+            offsets.push_back(values.size());
+        }
+
+        /// @brief Move the records of other after the ones of this column.
+        void append(BlockColumn&& other)
+        {
+            const std::size_t base = values.size();
+            values.insert(values.end(), other.values.begin(), other.values.end());
+            for(std::size_t i = 1; i < other.offsets.size(); i++)
+                offsets.push_back(base + other.offsets[i]);
+            other.clear();
+        }
+
+        BlockSpan<T> span(std::size_t i) const
+        {
+            BlockSpan<T> s;
+            s.ptr = values.data() + offsets[i];
+            s.n = offsets[i + 1] - offsets[i];
+            return s;
+        }
+
+        void clear()
+        {
+            values.clear();
+            offsets.assign(1, 0);
+        }
+    };
+
+    namespace detail {
+
+        template<class T>
+        struct BlockColumnOf
+        {
+            using type = std::tuple<>;   // not a BlockSpan column, nothing stored
+        };
+
+        template<class T>
+        struct BlockColumnOf<BlockSpan<T>>
+        {
+            using type = BlockColumn<T>;
+        };
+
+        template<class TupleType, class Seq>
+        struct BlockColumnsOf;
+
+        template<class TupleType, std::size_t... Is>
+        struct BlockColumnsOf<TupleType, std::index_sequence<Is...>>
+        {
+            using type = std::tuple<typename BlockColumnOf<std::tuple_element_t<Is, TupleType>>::type...>;
+        };
+    }
+
+/// @class BlockStore
+/// @brief One BlockColumn per BlockSpan column of TupleType.
+    template<class TupleType>
+    class BlockStore
+    {
+      public:
+
+        static constexpr std::size_t col_num = std::tuple_size<TupleType>::value;
+
+        template<std::size_t... Is>
+        static constexpr bool any_span(std::index_sequence<Is...>)
+        {
+            return (IsBlockSpan<std::tuple_element_t<Is, TupleType>>::value || ...);
+        }
+
+        /// @brief Whether TupleType has any BlockSpan column at all.
+        static constexpr bool enabled = any_span(std::make_index_sequence<col_num>{});
+
+        /// @brief Parse the BlockSpan columns of one record from its split fields.
+        template<class FIELDS>
+        void append(const FIELDS& fields)
+        {
+            for_each_column([&](auto& column, auto i){ column.append(fields[i]); });
+        }
+
+        /// @brief Move the records of other after the ones of this store.
+        void append(BlockStore&& other)
+        {
+            for_each_column([&](auto& column, auto i){ column.append(std::move(std::get<i>(other.columns))); });
+        }
+
+        /// @brief Point the BlockSpan slots of records (anything holding
+        ///        TupleType in .data, in append order) at the stored lists.
+        template<class Records>
+        void bind(Records& records) const
+        {
+            for_each_column([&](auto& column, auto i)
+            {
+                const std::size_t n = std::min<std::size_t>(records.size(), column.size());
+                for(std::size_t r = 0; r < n; r++)
+                    std::get<i>(records[r].data) = column.span(r);
+            });
+        }
+
+        template<std::size_t i>
+        const auto& column() const { return std::get<i>(columns); }
+
+        void clear()
+        {
+            for_each_column([](auto& column, auto){ column.clear(); });
+        }
+
+      private:
+
+        template<class F>
+        void for_each_column(F&& f)
+        {
+            for_each_column_impl(columns, f, std::make_index_sequence<col_num>{});
+        }
+
+        template<class F>
+        void for_each_column(F&& f) const
+        {
+            for_each_column_impl(columns, f, std::make_index_sequence<col_num>{});
+        }
+
+        template<class Columns, class F, std::size_t... Is>
+        static void for_each_column_impl(Columns& columns, F& f, std::index_sequence<Is...>)
+        {
+            auto call = [&](auto i)
+            {
+                if constexpr( IsBlockSpan<std::tuple_element_t<i, TupleType>>::value )
+                    f(std::get<i>(columns), i);
+            };
+            (call(std::integral_constant<std::size_t, Is>{}), ...);
+        }
+
+        typename detail::BlockColumnsOf<TupleType, std::make_index_sequence<col_num>>::type columns;
+    };
+
+}
@@ -0,0 +1,247 @@
+/// @file blocks.hpp
+/// @brief Exon / intron operations on the block columns of BED12 records
+///
+/// Everything works on the parsed blockSizes / blockStarts columns, whatever
+/// their slot type: std::vector, bed::BlockSpan, bed::Lazy of a list, or a
+/// fixed size nested tuple. An integral blockCount column bounds how many
+/// blocks are used (so padded nested tuples work). Records without block
+/// columns are a single exon [chromStart, chromEnd).
+
+#pragma once
+#include <Biovoltron/format/bed.hpp>
+#include <Biovoltron/format/bed/interval_index.hpp>
+#include <Biovoltron/format/bed/writer.hpp>
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <ostream>
+#include <string>
+#include <tuple>
+
+namespace biovoltron::format{
+
+    namespace bed {
+
+        /// @brief Returned by the coordinate mappings for a position outside every exon.
+        inline constexpr uint32_t no_position = std::numeric_limits<uint32_t>::max();
+
+        namespace detail {
+
+            /// @brief The elements of a list slot, indexable and sized.
+            template<class T>
+            decltype(auto) list_of(const T& slot)
+            {
+                if constexpr(IsLazy<T>::value)
+                    return list_of(slot.get());
+                else if constexpr(IsTupleType<T>::value)
+                    return std::apply([](auto... v){ return std::array<uint64_t, sizeof...(v)>{ uint64_t(v)... }; }, slot);
+                else
+                    return (slot);
+            }
+
+            template<class T>
+            struct IsList
+            {
+                static const bool value = IsVectorType<T>::value || IsBlockSpan<T>::value || IsTupleType<T>::value;
+            };
+
+            template<class T>
+            struct IsList<Lazy<T>> : IsList<T> {};
+
+            template<class TupleType>
+            constexpr bool has_blocks()
+            {
+                if constexpr(std::tuple_size<TupleType>::value > Col::blockStarts)
+                    return IsList<std::tuple_element_t<Col::blockSizes, TupleType>>::value
+                        && IsList<std::tuple_element_t<Col::blockStarts, TupleType>>::value;
+                else
+                    return false;
+            }
+
+            /// @brief Call f(sizes, starts, n) with the block lists of data.
+            template<class TupleType, class F>
+            bool with_blocks(const TupleType& data, F&& f)
+            {
+                if constexpr(has_blocks<TupleType>())
+                {
+                    decltype(auto) sizes  = list_of(std::get<Col::blockSizes>(data));
+                    decltype(auto) starts = list_of(std::get<Col::blockStarts>(data));
+                    std::size_t n = std::min<std::size_t>(sizes.size(), starts.size());
+                    if constexpr(std::is_integral<std::tuple_element_t<Col::blockCount, TupleType>>::value)
+                        n = std::min<std::size_t>(n, std::get<Col::blockCount>(data));
+                    if(n > 0)
+                    {
+                        f(sizes, starts, n);
+                        return true;
+                    }
+                }
+                return false;
+            }
+
+        }
+
+        /// @brief Strand column of a record, '.' when it has none.
+        template<class TupleType>
+        char strand_of(const TupleType& data)
+        {
+            if constexpr(std::tuple_size<TupleType>::value > Col::strand)
+                if constexpr(std::is_same<char, std::tuple_element_t<Col::strand, TupleType>>::value)
+                    return std::get<Col::strand>(data);
+            return '.';
+        }
+
+        /// @brief Number of exons of a record.
+        template<class TupleType>
+        std::size_t exon_count(const TupleType& data)
+        {
+            std::size_t count = 1;
+            detail::with_blocks(data, [&](auto&, auto&, std::size_t n){ count = n; });
+            return count;
+        }
+
+        /// @brief Call f(start, end) for every exon, in genome coordinates and
+        ///        blockStarts order, clipped to chromEnd.
+        template<class TupleType, class F>
+        void for_each_exon(const TupleType& data, F&& f)
+        {
+            const uint32_t start = std::get<Col::chromStart>(data);
+            const uint32_t end = std::get<Col::chromEnd>(data);
+
+            bool done = detail::with_blocks(data, [&](auto& sizes, auto& starts, std::size_t n)
+            {
+                for(std::size_t i = 0; i < n; i++)
+                {
+                    const uint32_t s = start + uint32_t(starts[i]);
+                    f(s, std::min<uint32_t>(end, s + uint32_t(sizes[i])));
+                }
+            });
+            if(!done)
+                f(start, end);
+        }
+
+        /// @brief Call f(start, end) for the gap between every two consecutive exons.
+        template<class TupleType, class F>
+        void for_each_intron(const TupleType& data, F&& f)
+        {
+            bool first = true;
+            uint32_t last_end = 0;
+            for_each_exon(data, [&](uint32_t s, uint32_t e)
+            {
+                if(!first && s > last_end)
+                    f(last_end, s);
+                first = false;
+                last_end = e;
+            });
+        }
+
+        /// @brief Sum of the exon lengths.
+        template<class TupleType>
+        uint64_t spliced_length(const TupleType& data)
+        {
+            uint64_t length = 0;
+            for_each_exon(data, [&](uint32_t s, uint32_t e){ length += e - s; });
+            return length;
+        }
+
+        /// @brief Offset of genome position pos in the spliced transcript,
+        ///        counted from its 5' end ('-' strand records count from chromEnd).
+        ///        no_position when pos is not in an exon.
+        template<class TupleType>
+        uint32_t genome_to_transcript(const TupleType& data, uint32_t pos)
+        {
+            uint64_t before = 0, offset = no_position;
+            for_each_exon(data, [&](uint32_t s, uint32_t e)
+            {
+                if(pos >= s && pos < e)
+                    offset = before + (pos - s);
+                before += e - s;
+            });
+            if(offset == no_position)
+                return no_position;
+            return uint32_t(strand_of(data) == '-' ? before - 1 - offset : offset);
+        }
+
+        /// @brief Genome position of offset pos of the spliced transcript (see
+        ///        genome_to_transcript), no_position past its end.
+        template<class TupleType>
+        uint32_t transcript_to_genome(const TupleType& data, uint32_t pos)
+        {
+            const uint64_t length = spliced_length(data);
+            if(pos >= length)
+                return no_position;
+            uint64_t offset = strand_of(data) == '-' ? length - 1 - pos : pos;
+
+            uint32_t result = no_position;
+            for_each_exon(data, [&](uint32_t s, uint32_t e)
+            {
+                if(result == no_position && offset < e - s)
+                    result = s + uint32_t(offset);
+                else if(result == no_position)
+                    offset -= e - s;
+            });
+            return result;
+        }
+
+        enum class Feature
+        {
+            exon, intron
+        };
+
+        /// @brief Call f(id, number, start, end) for every exon (or intron) of
+        ///        every record, id being the position of the record and number
+        ///        counting from 0 in genome order.
+        template<class Records, class F>
+        void for_each_feature(const Records& records, Feature feature, F&& f)
+        {
+            std::size_t id = 0;
+            for(auto& bed: records)
+            {
+                uint32_t number = 0;
+                auto emit = [&](uint32_t s, uint32_t e){ f(id, number++, s, e); };
+                if(feature == Feature::exon)
+                    for_each_exon(bed.data, emit);
+                else
+                    for_each_intron(bed.data, emit);
+                id++;
+            }
+        }
+
+        /// @brief Write every exon (or intron) as a BED6 line: chrom, start,
+        ///        end, name of the record (or "."), feature number, strand.
+        template<class Records>
+        void write_features(const Records& records, Feature feature, std::ostream& os)
+        {
+            using LineType = std::tuple<std::string, uint32_t, uint32_t, std::string, uint32_t, char>;
+            BEDWriter<LineType> writer(os);
+            LineType line;
+
+            for_each_feature(records, feature, [&](std::size_t id, uint32_t number, uint32_t s, uint32_t e)
+            {
+                auto& data = records[id].data;
+                // assignments reuse the string capacity of line
+                std::get<0>(line) = std::get<Col::chrom>(data);
+                std::get<1>(line) = s;
+                std::get<2>(line) = e;
+                if constexpr(std::tuple_size<std::decay_t<decltype(data)>>::value > Col::name)
+                    std::get<3>(line) = std::get<Col::name>(data);
+                else
+                    std::get<3>(line) = ".";
+                std::get<4>(line) = number;
+                std::get<5>(line) = strand_of(data);
+                writer.write(line);
+            });
+        }
+
+        /// @brief Add every exon (or intron) to index, id being the position of
+        ///        its record. index.build() is left to the caller.
+        template<class Records>
+        void index_features(const Records& records, Feature feature, BEDIntervalIndex& index)
+        {
+            for_each_feature(records, feature, [&](std::size_t id, uint32_t, uint32_t s, uint32_t e)
+            {
+                index.add(std::get<Col::chrom>(records[id].data), s, e, id);
+            });
+        }
+    }
+}
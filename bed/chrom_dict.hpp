@@ -0,0 +1,85 @@
+/// @file chrom_dict.hpp
+/// @brief Dictionary encoding of chromosome names
+
+#pragma once
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace biovoltron::format::bed {
+
+/// @class ChromDict
+/// @brief Maps chromosome names to small dense integer IDs and back.
+///
+/// IDs are given in first-seen order starting from 0. Lookups take a
+/// std::string_view so interning a field of a mapped file does not
+/// allocate once the name is known.
+    class ChromDict
+    {
+      public:
+
+        using id_type = uint32_t;
+
+        static constexpr id_type npos = static_cast<id_type>(-1);
+
+        ChromDict() = default;
+
+        ChromDict(const ChromDict& other)
+        {
+            for(auto& name: other.names)
+                intern(name);
+        }
+
+        ChromDict& operator=(const ChromDict& other)
+        {
+            if(this != &other)
+            {
+                clear();
+                for(auto& name: other.names)
+                    intern(name);
+            }
+            return *this;
+        }
+
+        ChromDict(ChromDict&&) = default;
+        ChromDict& operator=(ChromDict&&) = default;
+
+        /// @brief Get the ID of name, adding it when it is new.
+        id_type intern(std::string_view name)
+        {
+            auto it = ids.find(name);
+            if(it != ids.end())
+                return it->second;
+
+            id_type id = static_cast<id_type>(names.size());
+            names.emplace_back(name);
+            ids.emplace(std::string_view(names.back()), id);
+            return id;
+        }
+
+        /// @brief Get the ID of name, or npos when it is unknown.
+        id_type find(std::string_view name) const
+        {
+            auto it = ids.find(name);
+            return it == ids.end() ? npos : it->second;
+        }
+
+        const std::string& name(id_type id) const { return names[id]; }
+        std::size_t size() const { return names.size(); }
+
+        void clear()
+        {
+            ids.clear();
+            names.clear();
+        }
+
+      private:
+
+        // deque keeps the strings in place, so the map keys can view them
+        std::deque<std::string> names;
+        std::unordered_map<std::string_view, id_type> ids;
+    };
+
+}
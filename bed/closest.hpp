@@ -0,0 +1,376 @@
+/// @file closest.hpp
+/// @brief Nearest feature queries between two sets of BED records
+
+#pragma once
+#include <Biovoltron/format/bed.hpp>
+#include <Biovoltron/format/bed/blocks.hpp>
+#include <Biovoltron/format/bed/chrom_dict.hpp>
+#include <Biovoltron/format/bed/parallel_parser.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+namespace biovoltron::format{
+
+    namespace bed {
+
+        /// @brief Which features a query may be matched with (bedtools closest -s / -S).
+        enum class StrandMode
+        {
+            ignore,     ///< any strand
+            same,       ///< the strand of the query; '.' only matches '.'
+            opposite    ///< '+' matches '-' and back; '.' matches nothing
+        };
+
+        /// @brief What to report when several features are equally close (bedtools closest -t).
+        enum class TieMode
+        {
+            all,        ///< every one of them
+            first,      ///< the one with the smallest id
+            last        ///< the one with the largest id
+        };
+
+        struct ClosestOptions
+        {
+            StrandMode strand = StrandMode::ignore;
+            TieMode ties = TieMode::all;
+            uint32_t max_distance = std::numeric_limits<uint32_t>::max();
+            std::size_t thread_num = 1;
+        };
+    }
+
+/// @class BEDClosest
+/// @brief For every query interval, the closest feature(s) on the same chromosome.
+///
+/// Features are kept per chromosome (and per strand for the strand modes)
+/// in two sorted arrays: by start and by end. The overlapping features of
+/// a query are the ones starting before its end minus the ones ending
+/// before its start; without overlap the candidates are the first feature
+/// to its right (smallest start) and the last one to its left (largest
+/// end). The distance is the number of bases between the two intervals:
+/// 0 for overlapping or book-ended intervals.
+///
+///     BEDClosest genes(v_gene);                       // id = position in v_gene
+///     BEDClosest::Options opts;
+///     opts.strand = bed::StrandMode::same;
+///     auto result = genes.closest(v_peak, opts);      // hits of peak q:
+///     // result.hits[result.offsets[q]] .. result.hits[result.offsets[q+1]]
+///
+/// Batched queries run one chromosome per task. Queries of a chromosome
+/// sorted by chromStart are answered by moving two cursors along the
+/// arrays (a merge-style sweep); otherwise every query binary searches.
+    class BEDClosest
+    {
+      public:
+
+        using id_type = uint32_t;
+
+        using Options = bed::ClosestOptions;
+
+        struct Hit
+        {
+            id_type id;
+            uint32_t distance;
+
+            bool operator==(const Hit& rhs) const { return id == rhs.id && distance == rhs.distance; }
+        };
+
+        /// @brief Hits of query q are hits[offsets[q]] .. hits[offsets[q+1]], by id.
+        struct BatchResult
+        {
+            std::vector<std::size_t> offsets;
+            std::vector<Hit> hits;
+        };
+
+        BEDClosest() = default;
+
+        /// @brief Features from records (anything holding TupleType in .data),
+        ///        the id being the position.
+        template<class Records>
+        explicit BEDClosest(const Records& features)
+        {
+            id_type id = 0;
+            for(auto& bed: features)
+                add(std::get<bed::Col::chrom>(bed.data),
+                    std::get<bed::Col::chromStart>(bed.data),
+                    std::get<bed::Col::chromEnd>(bed.data),
+                    bed::strand_of(bed.data), id++);
+            build();
+        }
+
+        /// @brief Stage a feature; build() must be called before querying.
+        void add(std::string_view chrom, uint32_t start, uint32_t end, char strand, id_type id)
+        {
+            auto c = dict.intern(chrom);
+            if(c == contigs.size())
+                contigs.emplace_back();
+            contigs[c].tracks[0].staged.push_back({ start, end, id });
+            contigs[c].tracks[track_of(strand)].staged.push_back({ start, end, id });
+            built = false;
+        }
+
+        void build()
+        {
+            for(auto& c: contigs)
+                for(auto& t: c.tracks)
+                    t.build();
+            built = true;
+        }
+
+        const bed::ChromDict& chrom_dict() const { return dict; }
+
+        /// @brief Append the closest features of [start, end) on chrom to out.
+        void closest(std::string_view chrom, uint32_t start, uint32_t end, char strand,
+                     const Options& opts, std::vector<Hit>& out) const
+        {
+            check_built();
+            auto c = dict.find(chrom);
+            if(c == bed::ChromDict::npos)
+                return;
+            auto* track = select(contigs[c], strand, opts.strand);
+            if(track)
+            {
+                Cursor cursor;
+                track->closest(start, end, opts, cursor, false, out);
+            }
+        }
+
+        std::vector<Hit> closest(std::string_view chrom, uint32_t start, uint32_t end,
+                                 char strand = '.', const Options& opts = Options()) const
+        {
+            std::vector<Hit> out;
+            closest(chrom, start, end, strand, opts, out);
+            return out;
+        }
+
+        /// @brief The closest features of every record of queries.
+        template<class Records>
+        BatchResult closest(const Records& queries, const Options& opts = Options()) const
+        {
+            check_built();
+
+            // queries grouped by chromosome, keeping their order
+            std::vector<std::vector<uint32_t>> groups(contigs.size());
+            for(uint32_t q = 0; q < queries.size(); q++)
+            {
+                auto c = dict.find(std::get<bed::Col::chrom>(queries[q].data));
+                if(c != bed::ChromDict::npos)
+                    groups[c].push_back(q);
+            }
+
+            std::vector<std::vector<std::pair<uint32_t, Hit>>> found(contigs.size());
+            bed::parallel_for(contigs.size(), opts.thread_num, [&](std::size_t c)
+            {
+                auto& group = groups[c];
+                const bool sorted = std::is_sorted(group.begin(), group.end(), [&](auto a, auto b)
+                {
+                    return std::get<bed::Col::chromStart>(queries[a].data) < std::get<bed::Col::chromStart>(queries[b].data);
+                });
+
+                Cursor cursors[track_num];
+                std::vector<Hit> hits;
+                for(auto q: group)
+                {
+                    auto& data = queries[q].data;
+                    auto* track = select(contigs[c], bed::strand_of(data), opts.strand);
+                    if(!track)
+                        continue;
+
+                    hits.clear();
+                    track->closest(std::get<bed::Col::chromStart>(data), std::get<bed::Col::chromEnd>(data),
+                                   opts, cursors[track - contigs[c].tracks], sorted, hits);
+                    for(auto& hit: hits)
+                        found[c].emplace_back(q, hit);
+                }
+            });
+
+            BatchResult result;
+            result.offsets.assign(queries.size() + 1, 0);
+            for(auto& f: found)
+                for(auto& [q, hit]: f)
+                    result.offsets[q + 1]++;
+            std::partial_sum(result.offsets.begin(), result.offsets.end(), result.offsets.begin());
+
+            result.hits.resize(result.offsets.back());
+            std::vector<std::size_t> next(result.offsets.begin(), result.offsets.end() - 1);
+            for(auto& f: found)
+                for(auto& [q, hit]: f)
+                    result.hits[next[q]++] = hit;
+            return result;
+        }
+
+      private:
+
+        static constexpr std::size_t track_num = 4;   // all, '+', '-', '.'
+
+        static std::size_t track_of(char strand)
+        {
+            return strand == '+' ? 1 : strand == '-' ? 2 : 3;
+        }
+
+        struct Staged
+        {
+            uint32_t start, end;
+            id_type id;
+        };
+
+        /// @brief Positions in the sorted arrays kept between sorted queries.
+        struct Cursor
+        {
+            std::size_t before_end = 0;      // # features with start < query end
+            std::size_t before_start = 0;    // # features with end <= query start
+        };
+
+        struct Track
+        {
+            std::vector<Staged> staged;
+            std::vector<uint32_t> starts, start_ends;   // by start
+            std::vector<id_type> start_ids;
+            std::vector<uint32_t> ends;                  // by end
+            std::vector<id_type> end_ids;
+
+            void build()
+            {
+                if(staged.empty())
+                    return;
+
+                for(std::size_t i = 0; i < starts.size(); i++)
+                    staged.push_back({ starts[i], start_ends[i], start_ids[i] });
+
+                const std::size_t n = staged.size();
+                std::sort(staged.begin(), staged.end(), [](auto& a, auto& b)
+                {
+                    return a.start < b.start || (a.start == b.start && a.id < b.id);
+                });
+                starts.resize(n);
+                start_ends.resize(n);
+                start_ids.resize(n);
+                for(std::size_t i = 0; i < n; i++)
+                {
+                    starts[i] = staged[i].start;
+                    start_ends[i] = staged[i].end;
+                    start_ids[i] = staged[i].id;
+                }
+
+                std::sort(staged.begin(), staged.end(), [](auto& a, auto& b)
+                {
+                    return a.end < b.end || (a.end == b.end && a.id < b.id);
+                });
+                ends.resize(n);
+                end_ids.resize(n);
+                for(std::size_t i = 0; i < n; i++)
+                {
+                    ends[i] = staged[i].end;
+                    end_ids[i] = staged[i].id;
+                }
+                staged.clear();
+                staged.shrink_to_fit();
+            }
+
+            /// @brief Move pos to the number of elements of v satisfying
+            ///        pred (a prefix of v), from pos when sweeping.
+            template<class Pred>
+            static void locate(const std::vector<uint32_t>& v, std::size_t& pos, bool sweep, Pred pred)
+            {
+                if(!sweep)
+                {
+                    pos = std::partition_point(v.begin(), v.end(), pred) - v.begin();
+                    return;
+                }
+                while(pos < v.size() && pred(v[pos]))
+                    pos++;
+                while(pos > 0 && !pred(v[pos - 1]))
+                    pos--;
+            }
+
+            void closest(uint32_t qstart, uint32_t qend, const Options& opts, Cursor& cursor,
+                         bool sweep, std::vector<Hit>& out) const
+            {
+                const std::size_t n = starts.size();
+                if(n == 0)
+                    return;
+
+                // an empty query overlaps what covers its position
+                const uint32_t qlast = std::max(qend, qstart + (qstart < std::numeric_limits<uint32_t>::max()));
+                locate(starts, cursor.before_end, sweep, [=](uint32_t s){ return s < qlast; });
+                locate(ends, cursor.before_start, sweep, [=](uint32_t e){ return e <= qstart; });
+                const std::size_t hi = cursor.before_end, up = cursor.before_start;
+
+                const uint64_t none = std::numeric_limits<uint64_t>::max();
+                const uint64_t left = up > 0 ? qstart - ends[up - 1] : none;
+                const uint64_t right = hi < n ? starts[hi] - qend : none;
+                const uint64_t best = hi > up ? 0 : std::min(left, right);
+                if(best == none || best > opts.max_distance)
+                    return;
+
+                const std::size_t first = out.size();
+                if(hi > up)
+                {
+                    // hi - up features overlap, all of them among the first hi by start
+                    std::size_t rest = hi - up;
+                    for(std::size_t j = hi; j-- > 0 && rest; )
+                        if(start_ends[j] > qstart)
+                        {
+                            out.push_back({ start_ids[j], 0 });
+                            rest--;
+                        }
+                }
+                // the nearest ones on either side (book-ended ones tie with overlaps)
+                if(left == best)
+                    for(std::size_t j = up; j-- > 0 && ends[j] == ends[up - 1]; )
+                        out.push_back({ end_ids[j], uint32_t(best) });
+                if(right == best)
+                    for(std::size_t j = hi; j < n && starts[j] == starts[hi]; j++)
+                        out.push_back({ start_ids[j], uint32_t(best) });
+
+                auto begin = out.begin() + first;
+                std::sort(begin, out.end(), [](auto& a, auto& b){ return a.id < b.id; });
+                if(out.size() - first > 1)
+                {
+                    if(opts.ties == bed::TieMode::first)
+                        out.resize(first + 1);
+                    else if(opts.ties == bed::TieMode::last)
+                    {
+                        out[first] = out.back();
+                        out.resize(first + 1);
+                    }
+                }
+            }
+        };
+
+        struct Contig
+        {
+            Track tracks[track_num];
+        };
+
+        static const Track* select(const Contig& contig, char strand, bed::StrandMode mode)
+        {
+            switch(mode)
+            {
+                case bed::StrandMode::ignore:
+                    return &contig.tracks[0];
+                case bed::StrandMode::same:
+                    return &contig.tracks[track_of(strand)];
+                case bed::StrandMode::opposite:
+                    if(strand == '+' || strand == '-')
+                        return &contig.tracks[track_of(strand == '+' ? '-' : '+')];
+            }
+            return nullptr;
+        }
+
+        void check_built() const
+        {
+            if(!built)
+                throw std::logic_error("bed: BEDClosest queried before build()");
+        }
+
+        bed::ChromDict dict;
+        std::vector<Contig> contigs;
+        bool built = true;
+    };
+
+}
@@ -0,0 +1,164 @@
+/// @file coverage.hpp
+/// @brief Parallel per-chromosome genome coverage as run-length bedGraph
+
+#pragma once
+#include <Biovoltron/format/bed.hpp>
+#include <Biovoltron/format/bed/blocks.hpp>
+#include <Biovoltron/format/bed/chrom_dict.hpp>
+#include <Biovoltron/format/bed/parallel_parser.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace biovoltron::format{
+
+    namespace bed {
+
+        /// @brief Depth over [start, end) of one chromosome.
+        struct CoverageRun
+        {
+            uint32_t start, end, depth;
+
+            bool operator==(const CoverageRun& rhs) const
+            {
+                return start == rhs.start && end == rhs.end && depth == rhs.depth;
+            }
+        };
+    }
+
+/// @class BEDCoverage
+/// @brief Genome coverage of a set of records, like bedtools genomecov -bg
+///        (-split when use_blocks is set).
+///
+/// Records are bucketed per chromosome, then every chromosome is swept on
+/// its own task: the sorted start and end positions of its intervals are
+/// merged into runs of constant depth. Chromosomes are processed thread_num
+/// at a time and handed to the callback in byte order of their names, so
+/// only a batch of event lists is alive at once and memory follows the
+/// number of intervals, never the genome length. Zero-depth runs are not
+/// reported.
+    template<class TupleType>
+    class BEDCoverage
+    {
+      public:
+
+        using Callback = std::function<void(std::string_view chrom, const std::vector<bed::CoverageRun>& runs)>;
+
+        explicit BEDCoverage(std::size_t thread_num = bed::default_thread_num(), bool use_blocks = true)
+            : thread_num(std::max<std::size_t>(thread_num, 1)), use_blocks(use_blocks)
+        {}
+
+        /// @brief Compute the coverage of records (BEDRecord, BED or anything
+        ///        holding TupleType in .data) and call f once per chromosome.
+        template<class Records>
+        void compute(const Records& records, const Callback& f) const
+        {
+            bed::ChromDict dict;
+            std::vector<std::vector<uint32_t>> rows;
+            for(uint32_t i = 0; i < records.size(); i++)
+            {
+                auto id = dict.intern(std::get<bed::Col::chrom>(records[i].data));
+                if(id == rows.size())
+                    rows.emplace_back();
+                rows[id].push_back(i);
+            }
+
+            std::vector<uint32_t> order(dict.size());
+            for(uint32_t id = 0; id < order.size(); id++)
+                order[id] = id;
+            std::sort(order.begin(), order.end(), [&](auto a, auto b){ return dict.name(a) < dict.name(b); });
+
+            std::vector<std::vector<bed::CoverageRun>> runs(thread_num);
+            for(std::size_t batch = 0; batch < order.size(); batch += thread_num)
+            {
+                const std::size_t n = std::min(thread_num, order.size() - batch);
+                bed::parallel_for(n, thread_num, [&](std::size_t t)
+                {
+                    sweep(records, rows[order[batch + t]], runs[t]);
+                });
+                for(std::size_t t = 0; t < n; t++)
+                {
+                    f(dict.name(order[batch + t]), runs[t]);
+                    std::vector<bed::CoverageRun>().swap(runs[t]);
+                }
+                for(auto id = batch; id < batch + n; id++)
+                    std::vector<uint32_t>().swap(rows[order[id]]);
+            }
+        }
+
+        /// @brief Write the coverage of records as bedGraph lines.
+        template<class Records>
+        void write_bedgraph(const Records& records, std::ostream& os) const
+        {
+            BEDWriter<std::tuple<std::string, uint32_t, uint32_t, uint32_t>> writer(os);
+            std::tuple<std::string, uint32_t, uint32_t, uint32_t> line;
+            compute(records, [&](std::string_view chrom, const auto& runs)
+            {
+                std::get<0>(line) = chrom;
+                for(auto& run: runs)
+                {
+                    std::get<1>(line) = run.start;
+                    std::get<2>(line) = run.end;
+                    std::get<3>(line) = run.depth;
+                    writer.write(line);
+                }
+            });
+        }
+
+      private:
+
+        template<class Records>
+        void sweep(const Records& records, const std::vector<uint32_t>& rows, std::vector<bed::CoverageRun>& runs) const
+        {
+            std::vector<uint32_t> starts, ends;
+            starts.reserve(rows.size());
+            ends.reserve(rows.size());
+            auto add = [&](uint32_t s, uint32_t e)
+            {
+                if(s < e)
+                {
+                    starts.push_back(s);
+                    ends.push_back(e);
+                }
+            };
+            for(auto row: rows)
+            {
+                auto& data = records[row].data;
+                if(use_blocks)
+                    bed::for_each_exon(data, add);
+                else
+                    add(std::get<bed::Col::chromStart>(data), std::get<bed::Col::chromEnd>(data));
+            }
+            std::sort(starts.begin(), starts.end());
+            std::sort(ends.begin(), ends.end());
+
+            // every start has its end after it, so ends never run out first
+            uint32_t depth = 0, pos = 0;
+            std::size_t s = 0, e = 0;
+            while(e < ends.size())
+            {
+                const uint32_t next = (s < starts.size()) ? std::min(starts[s], ends[e]) : ends[e];
+                if(depth > 0 && next > pos)
+                {
+                    if(!runs.empty() && runs.back().end == pos && runs.back().depth == depth)
+                        runs.back().end = next;
+                    else
+                        runs.push_back({ pos, next, depth });
+                }
+                pos = next;
+                while(s < starts.size() && starts[s] == pos)
+                    depth++, s++;
+                while(e < ends.size() && ends[e] == pos)
+                    depth--, e++;
+            }
+        }
+
+        std::size_t thread_num;
+        bool use_blocks;
+    };
+
+}
@@ -0,0 +1,172 @@
+/// @file file.hpp
+/// @brief A whole BED file: one header shared by lean records
+
+#pragma once
+#include <Biovoltron/format/bed.hpp>
+#include <Biovoltron/format/bed/parallel_parser.hpp>
+#include <Biovoltron/format/bed/writer.hpp>
+#include <algorithm>
+#include <array>
+#include <istream>
+#include <iterator>
+#include <ostream>
+#include <vector>
+
+namespace biovoltron::format{
+
+/// @class BEDFile
+/// @brief Owns the bed::Header of a file once, plus its records as the
+///        lean BEDRecord<TupleType> (only data, no per record header).
+///
+///     BEDFile<TupleType> file;
+///     ifs >> file;            // header lines, then every data line
+///     oss << file;            // same text back
+///
+/// load() parses a file on disk with BEDParallelParser instead.
+///
+/// When TupleType has bed::BlockSpan columns, their lists are kept in one
+/// flat array per column owned by the file (blocks()), and the slots of
+/// the records view into it. Records appended by hand to records have
+/// empty spans.
+    template<class TupleType = std::tuple <std::string, uint32_t, uint32_t> >
+    class BEDFile
+    {
+      public:
+
+        using record_type = BEDRecord<TupleType>;
+
+        BEDFile() = default;
+        BEDFile(BEDFile&&) = default;
+        BEDFile& operator=(BEDFile&&) = default;
+
+        BEDFile(const BEDFile& other)
+            : header(other.header), records(other.records), blocks_(other.blocks_)
+        {
+            blocks_.bind(records);
+        }
+
+        BEDFile& operator=(const BEDFile& other)
+        {
+            header = other.header;
+            records = other.records;
+            blocks_ = other.blocks_;
+            blocks_.bind(records);
+            return *this;
+        }
+
+        std::size_t size() const { return records.size(); }
+        bool empty() const { return records.empty(); }
+
+        record_type& operator[](std::size_t i) { return records[i]; }
+        const record_type& operator[](std::size_t i) const { return records[i]; }
+
+        auto begin() { return records.begin(); }
+        auto end() { return records.end(); }
+        auto begin() const { return records.begin(); }
+        auto end() const { return records.end(); }
+
+        /// @brief Leading track / browser / # lines set the header (the last
+        ///        track line wins), every following non empty line is a record.
+        ///        Replaces what file held before, like load().
+        friend std::istream& operator>>(std::istream& is, BEDFile& file)
+        {
+            file = BEDFile();
+            std::string str;
+            bool in_header = true;
+
+            while(std::getline(is, str))
+            {
+                if(str.empty())
+                    continue;
+                if(in_header && bed::is_header_line(str))
+                {
+                    if(str.compare(0, 5, "track") == 0)
+                        file.header.set(str);
+                    continue;
+                }
+                in_header = false;
+                file.add_line(str);
+            }
+            file.blocks_.bind(file.records);
+            return is;
+        }
+
+        /// @brief The track line (when there is one), then every record.
+        friend std::ostream& operator<<(std::ostream& os, const BEDFile& file)
+        {
+            BEDWriter<TupleType> writer(os);
+            if(!file.header.track_line.empty())
+                writer.write_header(file.header);
+            for(auto& record: file.records)
+                writer.write(record);
+            return os;
+        }
+
+        static BEDFile load(const std::string& path, std::size_t thread_num = bed::default_thread_num())
+        {
+            BEDFile file;
+            if constexpr( !bed::BlockStore<TupleType>::enabled )
+                file.records = BEDParallelParser<TupleType>(thread_num).load(path, file.header);
+            else
+            {
+                // like BEDParallelParser, with a block store per chunk
+                thread_num = std::max<std::size_t>(thread_num, 1);
+                BEDMmapReader<TupleType> reader(path);
+                file.header = reader.header();
+                auto chunks = bed::split_by_lines(reader.body_view(), thread_num == 1 ? 1 : thread_num * 4);
+                std::vector<BEDFile> parts(chunks.size());
+
+                bed::parallel_for(chunks.size(), thread_num, [&](std::size_t i)
+                {
+                    const char* cur  = chunks[i].data();
+                    const char* last = chunks[i].data() + chunks[i].size();
+                    parts[i].records.reserve(std::count(cur, last, '\n') + 1);
+                    while(cur != last)
+                    {
+                        std::string_view line = BEDMmapReader<TupleType>::next_line(cur, last);
+                        if(!line.empty())
+                            parts[i].add_line(line);
+                    }
+                });
+
+                std::size_t total = 0;
+                for(auto& part: parts)
+                    total += part.records.size();
+                file.records.reserve(total);
+                for(auto& part: parts)
+                {
+                    std::move(part.records.begin(), part.records.end(), std::back_inserter(file.records));
+                    file.blocks_.append(std::move(part.blocks_));
+                }
+                file.blocks_.bind(file.records);
+            }
+            return file;
+        }
+
+        /// @brief The flat storage of the bed::BlockSpan columns.
+        const bed::BlockStore<TupleType>& blocks() const { return blocks_; }
+
+        BEDHeader header;
+        std::vector<record_type> records;
+
+      private:
+
+        void add_line(std::string_view line)
+        {
+            records.emplace_back();
+            if constexpr( !bed::BlockStore<TupleType>::enabled )
+                records.back().set_bed_data(line);
+            else
+            {
+                constexpr auto tup_size = std::tuple_size<TupleType>::value;
+                std::array<std::string_view, tup_size> fields;
+                bed::split_fields(line, fields);
+                records.back().template fill<TupleType, tup_size>(records.back().data, fields);
+                blocks_.append(fields);
+            }
+        }
+
+        bed::BlockStore<TupleType> blocks_;
+    };
+
+}
@@ -0,0 +1,273 @@
+/// @file filter.hpp
+/// @brief Predicate pushdown: filter BED lines on their raw fields before conversion
+
+#pragma once
+#include <Biovoltron/format/bed.hpp>
+#include <Biovoltron/format/bed/mmap_reader.hpp>
+#include <Biovoltron/format/bed/parallel_parser.hpp>
+#include <Biovoltron/format/bed/tokenizer.hpp>
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace biovoltron::format{
+
+    namespace bed {
+
+        /// @brief Conditions a data line must meet, all of them checked on the
+        ///        raw text. A condition left at its default is not checked.
+        ///
+        /// Lines whose checked fields are missing or not numbers do not match.
+        struct Predicate
+        {
+            /// @brief Keep this chromosome only ("" keeps all).
+            std::string chrom;
+            /// @brief Keep records overlapping [start, end).
+            uint32_t start = 0;
+            uint32_t end = std::numeric_limits<uint32_t>::max();
+            /// @brief Keep records with min_score <= score <= max_score.
+            int64_t min_score = std::numeric_limits<int64_t>::min();
+            int64_t max_score = std::numeric_limits<int64_t>::max();
+            /// @brief Keep this strand only (0 keeps all).
+            char strand = 0;
+
+            bool has_region() const
+            {
+                return start != 0 || end != std::numeric_limits<uint32_t>::max();
+            }
+
+            bool has_score() const
+            {
+                return min_score != std::numeric_limits<int64_t>::min()
+                    || max_score != std::numeric_limits<int64_t>::max();
+            }
+
+            /// @brief Number of leading columns the checks look at.
+            std::size_t columns() const
+            {
+                if(strand != 0)
+                    return Col::strand + 1;
+                if(has_score())
+                    return Col::score + 1;
+                if(has_region())
+                    return Col::chromEnd + 1;
+                return chrom.empty() ? 0 : Col::chrom + 1;
+            }
+
+            /// @brief Whether line starts with chrom followed by a blank; no
+            ///        split needed, so it runs first.
+            bool match_chrom(std::string_view line) const
+            {
+                return chrom.empty()
+                    || (line.size() > chrom.size()
+                        && std::memcmp(line.data(), chrom.data(), chrom.size()) == 0
+                        && detail::is_blank(line[chrom.size()]));
+            }
+
+            /// @brief Check the numeric and strand conditions on the first
+            ///        n split fields.
+            template<class FIELDS>
+            bool match_fields(const FIELDS& fields, std::size_t n) const
+            {
+                if(n < columns())
+                    return false;
+                if(has_region())
+                {
+                    uint32_t s, e;
+                    if(!number(fields[Col::chromStart], s) || !number(fields[Col::chromEnd], e))
+                        return false;
+                    if(!(s < end && start < e))
+                        return false;
+                }
+                if(has_score())
+                {
+                    int64_t score;
+                    if(!number(fields[Col::score], score) || score < min_score || score > max_score)
+                        return false;
+                }
+                if(strand != 0 && (fields[Col::strand].size() != 1 || fields[Col::strand][0] != strand))
+                    return false;
+                return true;
+            }
+
+          private:
+
+            template<class T>
+            static bool number(std::string_view field, T& value)
+            {
+                const char* p = field.data();
+                return detail::parse_number(p, field.data() + field.size(), value)
+                    && p == field.data() + field.size();
+            }
+        };
+
+        namespace detail {
+
+            /// @brief The first n slots of a field array, so split_fields
+            ///        stops after n fields.
+            struct FieldRange
+            {
+                std::string_view* first;
+                std::size_t n;
+
+                std::size_t size() const { return n; }
+                std::string_view& operator[](std::size_t i) { return first[i]; }
+            };
+        }
+    }
+
+/// @class BEDFilter
+/// @brief Reads only the BED lines matching a bed::Predicate.
+///
+/// The chromosome is compared on the line prefix, then only the columns the
+/// predicate needs are split and compared as raw bytes / numbers. The rest
+/// of the line is split and converted by fill() only when the line matches,
+/// so discarded lines cost a memcmp or a few field scans.
+///
+///     bed::Predicate pred;
+///     pred.chrom = "chr1";
+///     pred.min_score = 500;
+///     auto v_bed = BEDFilter<TupleType>(pred, 16).load(path);
+    template<class TupleType = std::tuple <std::string, uint32_t, uint32_t> >
+    class BEDFilter
+    {
+      public:
+
+        explicit BEDFilter(bed::Predicate predicate, std::size_t thread_num = 1)
+            : pred(std::move(predicate)), thread_num(std::max<std::size_t>(thread_num, 1))
+        {}
+
+        const bed::Predicate& predicate() const { return pred; }
+
+        /// @brief Convert line into bed when it matches; bed is left
+        ///        untouched and false returned otherwise.
+        bool parse(std::string_view line, BEDRecord<TupleType>& bed) const
+        {
+            static_assert( !bed::BlockStore<TupleType>::enabled, "BLOCKSPAN COLUMNS ARE ONLY FILLED BY BEDFILE");
+
+            if(!pred.match_chrom(line))
+                return false;
+
+            constexpr auto col_num = bed::parsed_columns<TupleType>();
+            std::array<std::string_view, std::max<std::size_t>(col_num, bed::Col::strand + 1)> fields{};
+
+            // split what the predicate looks at, then the rest only on a match
+            const std::size_t checked = pred.columns();
+            std::size_t n = 0;
+            if(checked > 0)
+            {
+                bed::detail::FieldRange head{ fields.data(), checked };
+                n = bed::split_fields(line, head);
+                if(!pred.match_fields(fields, n))
+                    return false;
+            }
+            if(n == 0)
+                bed::split_fields(line, fields);
+            else if(n == checked && col_num > n)
+            {
+                const char* p = fields[n-1].data() + fields[n-1].size();
+                const char* last = line.data() + line.size();
+                if(p != last)
+                {
+                    while(p != last && bed::detail::is_blank(*p))
+                        ++p;
+                    bed::detail::FieldRange tail{ fields.data() + n, col_num - n };
+                    if(p != last)
+                        bed::split_fields(std::string_view(p, last - p), tail);
+                    else
+                        tail[0] = std::string_view();
+                }
+            }
+
+            bed.template fill<TupleType, col_num>(bed.data, fields);
+            return true;
+        }
+
+        /// @brief Read lines from is until one matches and convert it into
+        ///        bed. Header and empty lines are skipped.
+        /// @return false at the end of is
+        bool get_obj(std::istream& is, BEDRecord<TupleType>& bed)
+        {
+            while(std::getline(is, line))
+            {
+                std::string_view view(line);
+                if(!view.empty() && view.back() == '\r')
+                    view.remove_suffix(1);
+                if(view.empty() || bed::is_header_line(view))
+                    continue;
+                if(parse(view, bed))
+                    return true;
+            }
+            return false;
+        }
+
+        /// @brief Call f(record) for every matching data line of data, in
+        ///        order, with a single record reused across lines.
+        template<class Callback>
+        void for_each(std::string_view data, Callback&& f) const
+        {
+            BEDRecord<TupleType> bed;
+            const char* cur  = data.data();
+            const char* last = data.data() + data.size();
+            while(cur != last)
+            {
+                std::string_view line = BEDMmapReader<TupleType>::next_line(cur, last);
+                if(line.empty() || bed::is_header_line(line))
+                    continue;
+                if(parse(line, bed))
+                    f(static_cast<const BEDRecord<TupleType>&>(bed));
+            }
+        }
+
+        /// @brief The matching records of data, in file order, parsed on
+        ///        thread_num threads.
+        std::vector<BEDRecord<TupleType>> select(std::string_view data) const
+        {
+            auto chunks = bed::split_by_lines(data, thread_num == 1 ? 1 : thread_num * 4);
+            std::vector<std::vector<BEDRecord<TupleType>>> results(chunks.size());
+
+            bed::parallel_for(chunks.size(), thread_num, [&](std::size_t i)
+            {
+                for_each(chunks[i], [&](const BEDRecord<TupleType>& bed){ results[i].push_back(bed); });
+            });
+
+            std::size_t total = 0;
+            for(auto& r: results)
+                total += r.size();
+
+            std::vector<BEDRecord<TupleType>> v_bed;
+            v_bed.reserve(total);
+            for(auto& r: results)
+                std::move(r.begin(), r.end(), std::back_inserter(v_bed));
+            return v_bed;
+        }
+
+        /// @brief The matching records of a BED file, its track line goes to header.
+        std::vector<BEDRecord<TupleType>> load(const std::string& path, BEDHeader& header) const
+        {
+            BEDMmapReader<TupleType> reader(path);
+            header = reader.header();
+            return select(reader.body_view());
+        }
+
+        std::vector<BEDRecord<TupleType>> load(const std::string& path) const
+        {
+            BEDHeader header;
+            return load(path, header);
+        }
+
+      private:
+
+        bed::Predicate pred;
+        std::size_t thread_num;
+        // get_obj reuses its line buffer
+        std::string line;
+    };
+
+}
@@ -0,0 +1,100 @@
+/// @file formatter.hpp
+/// @brief Text formatting of BED columns into a caller owned buffer
+
+#pragma once
+#include <Biovoltron/format/bed/is_tuple_type.hpp>
+#include <Biovoltron/format/bed/is_vector_type.hpp>
+#include <Biovoltron/format/bed/block_span.hpp>
+#include <Biovoltron/format/bed/projection.hpp>
+#include <charconv>
+#include <string>
+#include <tuple>
+#include <type_traits>
+
+namespace biovoltron::format::bed {
+
+    /// @brief Append the decimal text of v, same digits as std::to_string(v).
+    template<class T>
+    void append_integral(std::string& str, T v)
+    {
+        char buf[24];
+        // unary + promotes char / bool like std::to_string does
+        auto res = std::to_chars(buf, buf + sizeof(buf), +v);
+        str.append(buf, res.ptr - buf);
+    }
+
+    /// @brief Append "e0,e1,...,en," for a nested tuple column.
+    template<class... Ts>
+    void append_comma_delimited(std::string& str, const std::tuple<Ts...>& t)
+    {
+        std::apply ([&str] (const auto &... elem)
+                    {
+                        ((append_integral(str, elem), str += ','), ...);
+                    },
+                    t);
+    }
+
+    /// @brief Append the first i columns of t, each one followed by a '\t'.
+    ///
+    /// char and std::string columns are copied, integral columns written in
+    /// decimal, std::vector, BlockSpan and nested tuple columns as comma
+    /// separated lists with a trailing comma. Lazy columns keep their raw
+    /// text and Skip columns are written as ".".
+    template<class TUPLETYPE, int i>
+    void append_columns(std::string& str, const TUPLETYPE& t)
+    {
+        if constexpr(i == 0)
+            return;
+        else
+        {
+            append_columns<TUPLETYPE, i-1>(str, t);
+
+            using element = std::tuple_element_t<i-1, TUPLETYPE>;
+
+            if constexpr( std::is_same<char, element>::value )
+            {
+                str += std::get<i-1>(t);
+            }
+            else if constexpr ( std::is_integral<element>::value )
+            {
+                append_integral(str, std::get<i-1>(t));
+            }
+            else if constexpr( std::is_same<std::string, element>::value )
+            {
+                str += std::get<i-1>(t);
+            }
+            else if constexpr( IsVectorType<element>::value || IsBlockSpan<element>::value )
+            {
+                for(auto& v: std::get<i-1>(t))
+                {
+                    append_integral(str, v);
+                    str += ',';
+                }
+            }
+            else if constexpr( std::is_same<Skip, element>::value )
+            {
+                str += '.';
+            }
+            else if constexpr( IsLazy<element>::value )
+            {
+                str += std::get<i-1>(t).raw();
+            }
+            else   // tuple type
+            {
+                static_assert( IsTupleType<element>::value, "ARGUMENT IS NOT A TUPLE");
+                append_comma_delimited(str, std::get<i-1>(t));
+            }
+
+            str += '\t';
+        }
+    }
+
+    /// @brief Append one data line (no line break) of t.
+    template<class TUPLETYPE>
+    void append_record(std::string& str, const TUPLETYPE& t)
+    {
+        append_columns<TUPLETYPE, std::tuple_size<TUPLETYPE>::value>(str, t);
+        str.pop_back();
+    }
+
+}
@@ -0,0 +1,656 @@
+/// @file gzip_reader.hpp
+/// @brief Reading gzip and BGZF compressed BED files (zlib, link with -lz)
+///
+/// Plain gzip (also concatenated members) is streamed through inflate.
+/// BGZF files (bgzip output) are decompressed a batch of independent blocks
+/// at a time on a thread pool, and with a tabix .tbi or .csi index next to
+/// them a region query only decompresses the blocks holding that region.
+
+#pragma once
+#include <Biovoltron/format/bed.hpp>
+#include <Biovoltron/format/bed/parallel_parser.hpp>
+#include <Biovoltron/format/bed/region.hpp>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <zlib.h>
+
+namespace biovoltron::format{
+
+    namespace bed {
+
+/// @class GzipStream
+/// @brief Streaming decompression of a gzip file, concatenated members
+///        included. A file ending inside a member throws std::runtime_error.
+        class GzipStream
+        {
+          public:
+
+            explicit GzipStream(const std::string& path)
+                : path(path), fp(std::fopen(path.c_str(), "rb")), in(1 << 18)
+            {
+                if(fp == nullptr)
+                    throw std::runtime_error("bed: cannot open " + path);
+                std::memset(&zs, 0, sizeof(zs));
+                if(inflateInit2(&zs, 15 + 32) != Z_OK)
+                {
+                    std::fclose(fp);
+                    throw std::runtime_error("bed: inflateInit failed");
+                }
+            }
+
+            GzipStream(const GzipStream&) = delete;
+            GzipStream& operator=(const GzipStream&) = delete;
+
+            ~GzipStream()
+            {
+                inflateEnd(&zs);
+                std::fclose(fp);
+            }
+
+            /// @brief Append up to n decompressed bytes to out.
+            /// @return false once the whole file has been decompressed
+            bool read(std::string& out, std::size_t n)
+            {
+                const std::size_t old_size = out.size();
+                out.resize(old_size + n);
+                zs.next_out  = reinterpret_cast<Bytef*>(&out[old_size]);
+                zs.avail_out = static_cast<uInt>(n);
+
+                while(zs.avail_out != 0 && !finished)
+                {
+                    if(zs.avail_in == 0)
+                    {
+                        zs.avail_in = static_cast<uInt>(std::fread(in.data(), 1, in.size(), fp));
+                        zs.next_in  = in.data();
+                        if(zs.avail_in == 0)
+                        {
+                            if(in_member)
+                                throw std::runtime_error("bed: truncated gzip stream " + path);
+                            finished = true;
+                            break;
+                        }
+                    }
+
+                    int ret = inflate(&zs, Z_NO_FLUSH);
+                    in_member = ret != Z_STREAM_END;
+                    if(ret == Z_STREAM_END)
+                        inflateReset(&zs);   // the next gzip member, if any
+                    else if(ret != Z_OK && ret != Z_BUF_ERROR)
+                        throw std::runtime_error("bed: corrupted gzip data");
+                }
+
+                out.resize(out.size() - zs.avail_out);
+                return out.size() != old_size || !finished;
+            }
+
+          private:
+
+            std::string path;
+            std::FILE* fp;
+            z_stream zs;
+            std::vector<unsigned char> in;
+            bool finished = false;
+            bool in_member = false;   // inflate has started a member it has not finished
+        };
+
+        /// @brief Decompress a whole (possibly BGZF) gzip file into memory.
+        inline std::string gunzip(const std::string& path)
+        {
+            GzipStream gz(path);
+            std::string out;
+            while(gz.read(out, 1 << 20))
+                ;
+            return out;
+        }
+
+/// @class BgzfFile
+/// @brief Block level access to a BGZF file.
+///
+/// A virtual offset is (compressed offset of a block << 16) | offset inside
+/// the decompressed block, the coordinates used by tabix indices. Reading
+/// up to the end of a file that does not end with the empty EOF block
+/// bgzip writes throws std::runtime_error, as the file was cut short.
+        class BgzfFile
+        {
+          public:
+
+            explicit BgzfFile(const std::string& path)
+                : path(path), fd(::open(path.c_str(), O_RDONLY))
+            {
+                if(fd < 0)
+                    throw std::runtime_error("bed: cannot open " + path);
+            }
+
+            BgzfFile(const BgzfFile&) = delete;
+            BgzfFile& operator=(const BgzfFile&) = delete;
+
+            ~BgzfFile()
+            {
+                ::close(fd);
+            }
+
+            /// @brief Whether the file starts with a BGZF block header.
+            static bool is_bgzf(const std::string& path)
+            {
+                int fd = ::open(path.c_str(), O_RDONLY);
+                if(fd < 0)
+                    return false;
+                unsigned char h[18];
+                bool ok = ::pread(fd, h, sizeof(h), 0) == sizeof(h) && block_size(h) != 0;
+                ::close(fd);
+                return ok;
+            }
+
+            void seek(uint64_t coffset) { next = coffset; }
+            uint64_t tell() const { return next; }
+
+            /// @brief Decompress the next block_num blocks on thread_num threads.
+            ///
+            /// The blocks are appended to out in file order; when offsets is
+            /// given, the compressed offset and the position in out of every
+            /// block are appended to it.
+            /// @return number of blocks read, 0 at the end of the file
+            std::size_t read_blocks(std::string& out, std::size_t block_num, std::size_t thread_num = 1,
+                                    std::vector<std::pair<uint64_t, std::size_t>>* offsets = nullptr)
+            {
+                std::vector<std::string> raw;
+                std::vector<uint64_t> coffsets;
+                while(raw.size() < block_num)
+                {
+                    unsigned char h[18];
+                    ssize_t got = ::pread(fd, h, sizeof(h), next);
+                    if(got == 0)
+                    {
+                        check_eof();
+                        break;
+                    }
+                    if(got != sizeof(h))
+                        throw std::runtime_error("bed: truncated BGZF block in " + path);
+                    std::size_t size = block_size(h);
+                    if(size == 0)
+                        throw std::runtime_error("bed: corrupted BGZF block");
+
+                    std::string block(size, '\0');
+                    if(::pread(fd, &block[0], size, next) != static_cast<ssize_t>(size))
+                        throw std::runtime_error("bed: truncated BGZF block");
+                    coffsets.push_back(next);
+                    raw.emplace_back(std::move(block));
+                    next += size;
+                }
+
+                std::vector<std::string> data(raw.size());
+                parallel_for(raw.size(), thread_num, [&](std::size_t i)
+                {
+                    inflate_block(raw[i], data[i]);
+                });
+
+                for(std::size_t i = 0; i < data.size(); i++)
+                {
+                    if(offsets)
+                        offsets->emplace_back(coffsets[i], out.size());
+                    out += data[i];
+                }
+                return raw.size();
+            }
+
+          private:
+
+            /// @brief Throw unless the file ends with the BGZF EOF block.
+            void check_eof() const
+            {
+                static const unsigned char eof[28] = { 31, 139, 8, 4, 0, 0, 0, 0, 0, 255, 6, 0, 'B', 'C', 2, 0,
+                                                       27, 0, 3, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+                unsigned char tail[sizeof(eof)];
+                if(next < sizeof(eof) || ::pread(fd, tail, sizeof(tail), next - sizeof(eof)) != sizeof(tail)
+                   || std::memcmp(tail, eof, sizeof(eof)) != 0)
+                    throw std::runtime_error("bed: truncated BGZF file " + path + ", no EOF block");
+            }
+
+            /// @brief Total size of the block whose 18 byte header is h, 0 if h is not BGZF.
+            static std::size_t block_size(const unsigned char* h)
+            {
+                if(h[0] != 31 || h[1] != 139 || h[2] != 8 || !(h[3] & 4))
+                    return 0;
+                std::size_t xlen = h[10] | (h[11] << 8);
+                if(xlen < 6 || h[12] != 'B' || h[13] != 'C' || (h[14] | (h[15] << 8)) != 2)
+                    return 0;
+                return (h[16] | (h[17] << 8)) + 1;
+            }
+
+            static void inflate_block(const std::string& block, std::string& out)
+            {
+                const unsigned char* p = reinterpret_cast<const unsigned char*>(block.data());
+                const std::size_t n = block.size();
+                const std::size_t xlen = p[10] | (p[11] << 8);
+                const std::size_t isize = p[n - 4] | (p[n - 3] << 8) | (p[n - 2] << 16) | (uint32_t(p[n - 1]) << 24);
+
+                out.resize(isize);
+                if(isize == 0)
+                    return;
+
+                z_stream zs;
+                std::memset(&zs, 0, sizeof(zs));
+                if(inflateInit2(&zs, -15) != Z_OK)
+                    throw std::runtime_error("bed: inflateInit failed");
+                zs.next_in   = const_cast<Bytef*>(p + 12 + xlen);
+                zs.avail_in  = static_cast<uInt>(n - 12 - xlen - 8);
+                zs.next_out  = reinterpret_cast<Bytef*>(&out[0]);
+                zs.avail_out = static_cast<uInt>(isize);
+                int ret = inflate(&zs, Z_FINISH);
+                inflateEnd(&zs);
+                if(ret != Z_STREAM_END || zs.avail_out != 0)
+                    throw std::runtime_error("bed: corrupted BGZF block");
+            }
+
+            std::string path;
+            int fd;
+            uint64_t next = 0;
+        };
+
+/// @class TabixIndex
+/// @brief Binning index of a BGZF file, read from a tabix .tbi or a .csi file.
+        class TabixIndex
+        {
+          public:
+
+            using Chunk = std::pair<uint64_t, uint64_t>;
+
+            explicit TabixIndex(const std::string& path)
+            {
+                std::string data = gunzip(path);
+                const char* p    = data.data();
+                const char* last = data.data() + data.size();
+
+                if(data.compare(0, 4, "TBI\1") == 0)
+                {
+                    p += 4;
+                    int32_t n_ref = get<int32_t>(p, last);
+                    read_conf(p, last);
+                    for(int32_t r = 0; r < n_ref; r++)
+                    {
+                        auto& ref = refs.emplace_back();
+                        read_bins(p, last, ref, false);
+                        int32_t n_intv = get<int32_t>(p, last);
+                        for(int32_t i = 0; i < n_intv; i++)
+                            ref.linear.push_back(get<uint64_t>(p, last));
+                    }
+                }
+                else if(data.compare(0, 4, "CSI\1") == 0)
+                {
+                    p += 4;
+                    min_shift = get<int32_t>(p, last);
+                    depth     = get<int32_t>(p, last);
+                    int32_t l_aux = get<int32_t>(p, last);
+                    const char* aux_end = p + l_aux;
+                    if(l_aux >= 28)
+                        read_conf(p, aux_end);
+                    p = aux_end;
+                    int32_t n_ref = get<int32_t>(p, last);
+                    for(int32_t r = 0; r < n_ref; r++)
+                        read_bins(p, last, refs.emplace_back(), true);
+                }
+                else
+                    throw std::runtime_error("bed: not a tabix / csi index " + path);
+            }
+
+            /// @brief Merged [begin, end) virtual offset ranges holding every
+            ///        record that may overlap [start, end) on chrom.
+            std::vector<Chunk> chunks(std::string_view chrom, uint64_t start, uint64_t end) const
+            {
+                std::vector<Chunk> result;
+                auto it = ref_ids.find(std::string(chrom));
+                if(it == ref_ids.end() || start >= end)
+                    return result;
+                auto& ref = refs[it->second];
+
+                uint64_t min_off = 0;
+                if(!ref.linear.empty())
+                    min_off = ref.linear[std::min<std::size_t>(start >> min_shift, ref.linear.size() - 1)];
+                else
+                {
+                    // csi: loffset of the deepest existing bin holding start
+                    uint32_t bin = ((1u << (depth * 3)) - 1) / 7 + static_cast<uint32_t>(start >> min_shift);
+                    while(true)
+                    {
+                        auto b = ref.bins.find(bin);
+                        if(b != ref.bins.end())
+                        {
+                            min_off = b->second.loffset;
+                            break;
+                        }
+                        if(bin == 0)
+                            break;
+                        bin = (bin - 1) >> 3;
+                    }
+                }
+
+                for(uint32_t bin: reg2bins(start, end))
+                {
+                    auto b = ref.bins.find(bin);
+                    if(b == ref.bins.end())
+                        continue;
+                    for(auto& c: b->second.chunks)
+                        if(c.second > min_off)
+                            result.push_back(c);
+                }
+
+                std::sort(result.begin(), result.end());
+                std::vector<Chunk> merged;
+                for(auto& c: result)
+                {
+                    if(!merged.empty() && c.first <= merged.back().second)
+                        merged.back().second = std::max(merged.back().second, c.second);
+                    else
+                        merged.push_back(c);
+                }
+                return merged;
+            }
+
+            /// @brief Number of header lines (tabix "skip") before the data lines.
+            int32_t skip = 0;
+
+          private:
+
+            struct Bin
+            {
+                uint64_t loffset = 0;
+                std::vector<Chunk> chunks;
+            };
+
+            struct Ref
+            {
+                std::unordered_map<uint32_t, Bin> bins;
+                std::vector<uint64_t> linear;
+            };
+
+            template<class T>
+            static T get(const char*& p, const char* last)
+            {
+                if(last - p < static_cast<std::ptrdiff_t>(sizeof(T)))
+                    throw std::runtime_error("bed: truncated index");
+                T v;
+                std::memcpy(&v, p, sizeof(T));
+                p += sizeof(T);
+                return v;
+            }
+
+            void read_conf(const char*& p, const char* last)
+            {
+                p += 4 * sizeof(int32_t);   // format, col_seq, col_beg, col_end
+                get<int32_t>(p, last);      // meta
+                skip = get<int32_t>(p, last);
+                int32_t l_nm = get<int32_t>(p, last);
+                std::string_view names(p, l_nm);
+                p += l_nm;
+
+                while(!names.empty())
+                {
+                    auto nul = names.find('\0');
+                    ref_ids.emplace(std::string(names.substr(0, nul)), ref_ids.size());
+                    names.remove_prefix(nul == std::string_view::npos ? names.size() : nul + 1);
+                }
+            }
+
+            void read_bins(const char*& p, const char* last, Ref& ref, bool csi)
+            {
+                int32_t n_bin = get<int32_t>(p, last);
+                for(int32_t b = 0; b < n_bin; b++)
+                {
+                    uint32_t bin = get<uint32_t>(p, last);
+                    Bin& entry = ref.bins[bin];
+                    if(csi)
+                        entry.loffset = get<uint64_t>(p, last);
+                    int32_t n_chunk = get<int32_t>(p, last);
+                    for(int32_t c = 0; c < n_chunk; c++)
+                    {
+                        uint64_t beg = get<uint64_t>(p, last);
+                        uint64_t end = get<uint64_t>(p, last);
+                        entry.chunks.emplace_back(beg, end);
+                    }
+                }
+            }
+
+            /// @brief Bins of every level overlapping [beg, end).
+            std::vector<uint32_t> reg2bins(uint64_t beg, uint64_t end) const
+            {
+                std::vector<uint32_t> bins;
+                int s = min_shift + depth * 3;
+                if(end > (uint64_t(1) << s))
+                    end = uint64_t(1) << s;
+                --end;
+                uint32_t t = 0;
+                for(int l = 0; l <= depth; l++, s -= 3, t += 1u << (l * 3 - 3))
+                    for(uint64_t b = t + (beg >> s); b <= t + (end >> s); b++)
+                        bins.push_back(static_cast<uint32_t>(b));
+                return bins;
+            }
+
+            int32_t min_shift = 14;
+            int32_t depth = 5;
+            std::vector<Ref> refs;
+            std::unordered_map<std::string, std::size_t> ref_ids;
+        };
+    }
+
+/// @class BEDGzipReader
+/// @brief Reads BED records from a .bed.gz file, plain gzip or BGZF.
+///
+///     BEDGzipReader<TupleType> reader(path, 8);
+///     BEDRecord<TupleType> bed;
+///     while(reader.read(bed))
+///         ...
+///     for(auto& bed: reader.query(bed::Region::parse("chr1:1000-2000")))    // needs path.tbi or path.csi
+///         ...
+///
+/// Leading header lines are consumed on construction, the track line goes
+/// to header(). With BGZF input, thread_num blocks are inflated in parallel.
+    template<class TupleType = std::tuple <std::string, uint32_t, uint32_t> >
+    class BEDGzipReader
+    {
+      public:
+
+        explicit BEDGzipReader(const std::string& path, std::size_t thread_num = 1)
+            : path(path), thread_num(std::max<std::size_t>(thread_num, 1))
+        {
+            if(bed::BgzfFile::is_bgzf(path))
+                bgzf = std::make_unique<bed::BgzfFile>(path);
+            else
+                gz = std::make_unique<bed::GzipStream>(path);
+
+            std::string_view line;
+            while(next_line(line))
+            {
+                if(line.empty())
+                    continue;
+                if(!bed::is_header_line(line))
+                {
+                    pos = line.data() - buf.data();    // leave the first data line for read()
+                    break;
+                }
+                if(line.substr(0, 5) == "track")
+                {
+                    std::string str(line);
+                    header_.set(str);
+                }
+            }
+        }
+
+        const BEDHeader& header() const { return header_; }
+        bool is_bgzf() const { return bgzf != nullptr; }
+
+        /// @brief Read the next data record.
+        /// @return false at the end of the file
+        bool read(BEDRecord<TupleType>& bed)
+        {
+            std::string_view line;
+            while(next_line(line))
+            {
+                if(line.empty())
+                    continue;
+                bed.set_bed_data(line);
+                return true;
+            }
+            return false;
+        }
+
+        /// @brief Call f(record) for every record overlapping region, using
+        ///        the tabix index path.tbi (or path.csi) to seek to its blocks.
+        ///
+        /// Does not move the sequential read() position.
+        template<class Callback>
+        void for_each_in(const bed::Region& region, Callback&& f)
+        {
+            if(!bgzf)
+                throw std::runtime_error("bed: region query needs a BGZF file, " + path + " is plain gzip");
+            if(!index)
+                load_index();
+
+            bed::BgzfFile file(path);
+            BEDRecord<TupleType> bed;
+            auto emit = [&](std::string_view line)
+            {
+                if(line.empty() || bed::is_header_line(line))
+                    return;
+                bed.set_bed_data(line);
+                if(region.overlaps(std::get<bed::Col::chrom>(bed.data),
+                                   std::get<bed::Col::chromStart>(bed.data),
+                                   std::get<bed::Col::chromEnd>(bed.data)))
+                    f(bed);
+            };
+
+            for(auto [begin, end]: index->chunks(region.chrom, region.start, region.end))
+            {
+                file.seek(begin >> 16);
+                std::size_t offset = begin & 0xffff;
+                std::string carry, block;
+
+                while(true)
+                {
+                    const uint64_t coffset = file.tell();
+                    block.clear();
+                    if(file.read_blocks(block, 1) == 0)
+                        break;
+
+                    std::size_t p = offset;
+                    offset = 0;
+                    if(!carry.empty())
+                    {
+                        auto nl = block.find('\n');
+                        carry.append(block, 0, nl);
+                        if(nl == std::string::npos)
+                            continue;
+                        emit(trim(carry));
+                        carry.clear();
+                        p = nl + 1;
+                    }
+
+                    bool done = false;
+                    while(p < block.size())
+                    {
+                        if(((coffset << 16) | p) >= end)
+                        {
+                            done = true;
+                            break;
+                        }
+                        auto nl = block.find('\n', p);
+                        if(nl == std::string::npos)
+                        {
+                            carry.assign(block, p);
+                            break;
+                        }
+                        emit(trim(std::string_view(block).substr(p, nl - p)));
+                        p = nl + 1;
+                    }
+                    if(done || ((file.tell() << 16) >= end && carry.empty()))
+                        break;
+                }
+                if(!carry.empty())
+                    emit(trim(carry));
+            }
+        }
+
+        std::vector<BEDRecord<TupleType>> query(const bed::Region& region)
+        {
+            std::vector<BEDRecord<TupleType>> v_bed;
+            for_each_in(region, [&v_bed](auto& bed){ v_bed.push_back(bed); });
+            return v_bed;
+        }
+
+      private:
+
+        static std::string_view trim(std::string_view line)
+        {
+            if(!line.empty() && line.back() == '\r')
+                line.remove_suffix(1);
+            return line;
+        }
+
+        /// @brief The next line (without '\n'), valid until the next call.
+        bool next_line(std::string_view& line)
+        {
+            while(true)
+            {
+                auto nl = buf.find('\n', pos);
+                if(nl != std::string::npos)
+                {
+                    line = trim(std::string_view(buf).substr(pos, nl - pos));
+                    pos = nl + 1;
+                    return true;
+                }
+                if(!refill())
+                {
+                    if(pos == buf.size())
+                        return false;
+                    line = trim(std::string_view(buf).substr(pos));
+                    pos = buf.size();
+                    return true;
+                }
+            }
+        }
+
+        /// @brief Drop the consumed bytes and decompress more.
+        /// @return false when nothing is left
+        bool refill()
+        {
+            buf.erase(0, pos);
+            pos = 0;
+            const std::size_t old_size = buf.size();
+            if(bgzf)
+                bgzf->read_blocks(buf, thread_num * 8, thread_num);
+            else
+                gz->read(buf, 1 << 20);
+            return buf.size() != old_size;
+        }
+
+        void load_index()
+        {
+            for(auto ext: { ".tbi", ".csi" })
+                if(::access((path + ext).c_str(), R_OK) == 0)
+                {
+                    index = std::make_unique<bed::TabixIndex>(path + ext);
+                    return;
+                }
+            throw std::runtime_error("bed: no .tbi / .csi index for " + path);
+        }
+
+        std::string path;
+        std::size_t thread_num;
+        std::unique_ptr<bed::GzipStream> gz;
+        std::unique_ptr<bed::BgzfFile> bgzf;
+        std::unique_ptr<bed::TabixIndex> index;
+        std::string buf;
+        std::size_t pos = 0;
+        BEDHeader header_;
+    };
+
+}
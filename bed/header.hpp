@@ -11,6 +11,7 @@
 #include <vector>
 #include <cassert>
 #include <string>
+#include <string_view>
 
 namespace biovoltron::format::bed {
     class Header
@@ -117,6 +118,15 @@ namespace biovoltron::format::bed {
         std::vector<uint8_t> forward_strand_color, reverse_strand_color;
     };
 
+    /// @brief Whether a line belongs to the header part of a BED file
+    ///        ("track", "browser" or "#" comment lines).
+    inline bool is_header_line(std::string_view line)
+    {
+        return line.substr(0, 5) == "track"
+            || line.substr(0, 7) == "browser"
+            || line.substr(0, 1) == "#";
+    }
+
     enum Col
     {
         chrom, chromStart, chromEnd, name, score, strand, thickStart, thickEnd, itemRgb, blockCount, blockSizes, blockStarts
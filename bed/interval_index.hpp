@@ -0,0 +1,297 @@
+/// @file interval_index.hpp
+/// @brief In-memory interval index answering overlap queries on BED records
+
+#pragma once
+#include <Biovoltron/format/bed.hpp>
+#include <Biovoltron/format/bed/chrom_dict.hpp>
+#include <Biovoltron/format/bed/parallel_parser.hpp>
+#include <Biovoltron/format/bed/region.hpp>
+#include <Biovoltron/format/bed/table.hpp>
+#include <algorithm>
+#include <numeric>
+#include <vector>
+
+namespace biovoltron::format{
+
+/// @class BEDIntervalIndex
+/// @brief Implicit interval tree over per chromosome sorted arrays.
+///
+/// Intervals of a chromosome are sorted by start and stored as contiguous
+/// start / end / id arrays. The sorted array itself is the tree (the node
+/// of rank i sits at level = number of trailing 1 bits of i, as in
+/// cgranges), with the max end of every subtree kept in a fourth array, so
+/// no pointers are stored.
+///
+///     BEDIntervalIndex index(v_bed);      // id = position in v_bed
+///     for(auto id: index.query("chr1", 1000, 2000))
+///         v_bed[id] ...
+///
+/// Intervals are half-open: [start, end) overlaps [qstart, qend) iff
+/// start < qend && qstart < end. Ids of a query come in chromStart order.
+    class BEDIntervalIndex
+    {
+      public:
+
+        using id_type = std::size_t;
+
+        /// @brief Result of a batched query: ids of query q are
+        ///        ids[offsets[q]] .. ids[offsets[q+1]].
+        struct BatchResult
+        {
+            std::vector<std::size_t> offsets;
+            std::vector<id_type> ids;
+        };
+
+        BEDIntervalIndex() = default;
+
+        /// @brief Index every record of records (e.g. std::vector<BED<TupleType>>,
+        ///        BEDFile<TupleType>), the id being its position.
+        template<class Records>
+        explicit BEDIntervalIndex(const Records& records)
+        {
+            id_type id = 0;
+            for(auto& bed: records)
+                add(std::get<bed::Col::chrom>(bed.data),
+                    std::get<bed::Col::chromStart>(bed.data),
+                    std::get<bed::Col::chromEnd>(bed.data),
+                    id++);
+            build();
+        }
+
+        template<class TupleType>
+        explicit BEDIntervalIndex(const BEDTable<TupleType>& table)
+        {
+            auto& starts = table.template column<bed::Col::chromStart>();
+            auto& ends   = table.template column<bed::Col::chromEnd>();
+            for(std::size_t i = 0; i < table.size(); i++)
+                add(table.chrom(i), starts[i], ends[i], i);
+            build();
+        }
+
+        /// @brief Stage an interval; build() must be called before querying.
+        void add(std::string_view chrom, uint32_t start, uint32_t end, id_type id)
+        {
+            auto c = dict.intern(chrom);
+            if(c == contigs.size())
+                contigs.emplace_back();
+            contigs[c].staged.push_back({start, end, id});
+            built = false;
+        }
+
+        /// @brief Sort the staged intervals and compute the subtree max ends.
+        void build()
+        {
+            for(auto& c: contigs)
+                c.build();
+            built = true;
+        }
+
+        std::size_t size() const
+        {
+            std::size_t n = 0;
+            for(auto& c: contigs)
+                n += c.starts.size() + c.staged.size();
+            return n;
+        }
+
+        const bed::ChromDict& chrom_dict() const { return dict; }
+
+        /// @brief Call f(id) for every interval overlapping [start, end) on chrom.
+        template<class Callback>
+        void for_each_overlap(std::string_view chrom, uint32_t start, uint32_t end, Callback&& f) const
+        {
+            if(!built)
+                throw std::logic_error("bed: BEDIntervalIndex queried before build()");
+
+            auto c = dict.find(chrom);
+            if(c == bed::ChromDict::npos)
+                return;
+            contigs[c].overlap(start, end, f);
+        }
+
+        /// @brief Append the ids overlapping [start, end) on chrom to out.
+        void query(std::string_view chrom, uint32_t start, uint32_t end, std::vector<id_type>& out) const
+        {
+            for_each_overlap(chrom, start, end, [&out](id_type id){ out.push_back(id); });
+        }
+
+        std::vector<id_type> query(std::string_view chrom, uint32_t start, uint32_t end) const
+        {
+            std::vector<id_type> out;
+            query(chrom, start, end, out);
+            return out;
+        }
+
+        std::vector<id_type> query(const bed::Region& region) const
+        {
+            return query(region.chrom, region.start, region.end);
+        }
+
+        /// @brief Answer many regions at once, split over thread_num threads.
+        BatchResult query(const std::vector<bed::Region>& regions, std::size_t thread_num = 1) const
+        {
+            const std::size_t batch = 4096;
+            const std::size_t batch_num = (regions.size() + batch - 1) / batch;
+            std::vector<std::vector<id_type>> ids(batch_num);
+            std::vector<std::size_t> counts(regions.size());
+
+            bed::parallel_for(batch_num, thread_num, [&](std::size_t b)
+            {
+                const std::size_t last = std::min(regions.size(), (b + 1) * batch);
+                for(std::size_t q = b * batch; q < last; q++)
+                {
+                    auto before = ids[b].size();
+                    query(regions[q].chrom, regions[q].start, regions[q].end, ids[b]);
+                    counts[q] = ids[b].size() - before;
+                }
+            });
+
+            BatchResult result;
+            result.offsets.resize(regions.size() + 1, 0);
+            std::partial_sum(counts.begin(), counts.end(), result.offsets.begin() + 1);
+            result.ids.reserve(result.offsets.back());
+            for(auto& v: ids)
+                result.ids.insert(result.ids.end(), v.begin(), v.end());
+            return result;
+        }
+
+      private:
+
+        struct Staged
+        {
+            uint32_t start, end;
+            id_type id;
+        };
+
+        struct Contig
+        {
+            std::vector<Staged> staged;
+            std::vector<uint32_t> starts, ends, max_ends;
+            std::vector<id_type> ids;
+            int root_level = -1;
+
+            void build()
+            {
+                if(staged.empty())
+                    return;
+
+                auto less = [](const Staged& a, const Staged& b)
+                {
+                    return a.start < b.start || (a.start == b.start && a.id < b.id);
+                };
+                std::sort(staged.begin(), staged.end(), less);
+
+                // merge backwards into what is already indexed: linear in
+                // the index size instead of sorting it again
+                const std::size_t old_n = starts.size();
+                const std::size_t n = old_n + staged.size();
+                starts.resize(n);
+                ends.resize(n);
+                ids.resize(n);
+                max_ends.resize(n);
+
+                std::size_t i = old_n, j = staged.size(), k = n;
+                while(j > 0)
+                {
+                    --k;
+                    if(i == 0 || less(Staged{ starts[i-1], ends[i-1], ids[i-1] }, staged[j-1]))
+                    {
+                        --j;
+                        starts[k] = staged[j].start;
+                        ends[k]   = staged[j].end;
+                        ids[k]    = staged[j].id;
+                    }
+                    else
+                    {
+                        --i;
+                        starts[k] = starts[i];
+                        ends[k]   = ends[i];
+                        ids[k]    = ids[i];
+                    }
+                }
+                staged.clear();
+                staged.shrink_to_fit();
+
+                root_level = index_core();
+            }
+
+            /// @brief Bottom up max end of every implicit subtree.
+            /// @return level of the root
+            int index_core()
+            {
+                const int64_t n = starts.size();
+                int64_t last_i = 0;
+                uint32_t last = 0;
+
+                for(int64_t i = 0; i < n; i += 2)
+                {
+                    last_i = i;
+                    last = max_ends[i] = ends[i];
+                }
+
+                int k = 1;
+                for(; (int64_t(1) << k) <= n; ++k)
+                {
+                    const int64_t x = int64_t(1) << (k - 1);
+                    const int64_t i0 = (x << 1) - 1;
+                    const int64_t step = x << 2;
+                    for(int64_t i = i0; i < n; i += step)
+                    {
+                        uint32_t el = max_ends[i - x];
+                        uint32_t er = i + x < n ? max_ends[i + x] : last;
+                        max_ends[i] = std::max({ ends[i], el, er });
+                    }
+                    last_i = (last_i >> k & 1) ? last_i - x : last_i + x;
+                    if(last_i < n && max_ends[last_i] > last)
+                        last = max_ends[last_i];
+                }
+                return k - 1;
+            }
+
+            template<class Callback>
+            void overlap(uint32_t qstart, uint32_t qend, Callback& f) const
+            {
+                if(root_level < 0)
+                    return;
+
+                struct Node { int64_t x; int k; bool left_done; };
+                Node stack[64];
+                int t = 0;
+                const int64_t n = starts.size();
+
+                stack[t++] = { (int64_t(1) << root_level) - 1, root_level, false };
+                while(t)
+                {
+                    Node z = stack[--t];
+                    if(z.k <= 3)
+                    {
+                        // small subtree: a linear scan is cheaper than descending
+                        int64_t i0 = z.x >> z.k << z.k;
+                        int64_t i1 = std::min(n, i0 + (int64_t(1) << (z.k + 1)) - 1);
+                        for(int64_t i = i0; i < i1 && starts[i] < qend; ++i)
+                            if(qstart < ends[i])
+                                f(ids[i]);
+                    }
+                    else if(!z.left_done)
+                    {
+                        int64_t y = z.x - (int64_t(1) << (z.k - 1));
+                        stack[t++] = { z.x, z.k, true };
+                        if(y >= n || max_ends[y] > qstart)
+                            stack[t++] = { y, z.k - 1, false };
+                    }
+                    else if(z.x < n && starts[z.x] < qend)
+                    {
+                        if(qstart < ends[z.x])
+                            f(ids[z.x]);
+                        stack[t++] = { z.x + (int64_t(1) << (z.k - 1)), z.k - 1, false };
+                    }
+                }
+            }
+        };
+
+        bed::ChromDict dict;
+        std::vector<Contig> contigs;
+        bool built = true;
+    };
+
+}
@@ -0,0 +1,495 @@
+/// @file line_index.hpp
+/// @brief Sidecar line offset index for random access into sorted plain text BED files
+///
+/// The index (path + ".lidx" by default) keeps, for every chromosome, the
+/// byte range of its lines and a sample every sample_lines data lines: the
+/// byte offset and data line number of the sampled line, its chromStart and
+/// the largest chromEnd up to the next sample. A region query reads only
+/// the samples overlapping it, a record lookup only the sample holding it.
+///
+/// File layout (native byte order):
+///
+///     LineIndexHeader  magic, version, sizes
+///     chromosomes      uint32_t name length + name, then a ChromEntry, per chromosome
+///     samples          LineSample[sample_num]
+
+#pragma once
+#include <Biovoltron/format/bed.hpp>
+#include <Biovoltron/format/bed/chrom_dict.hpp>
+#include <Biovoltron/format/bed/mapped_file.hpp>
+#include <Biovoltron/format/bed/mmap_reader.hpp>
+#include <Biovoltron/format/bed/parallel_parser.hpp>
+#include <Biovoltron/format/bed/region.hpp>
+#include <Biovoltron/format/bed/tokenizer.hpp>
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace biovoltron::format{
+
+    namespace bed {
+
+        /// @brief A sampled data line.
+        struct LineSample
+        {
+            uint64_t offset;    ///< byte offset of the line in the BED file
+            uint64_t line;      ///< data line number, from 0
+            uint32_t start;     ///< chromStart of the line
+            uint32_t max_end;   ///< largest chromEnd from the line up to the next sample
+        };
+
+        /// @brief The lines of one chromosome.
+        struct ChromEntry
+        {
+            uint64_t begin, end;                ///< byte range of its lines
+            uint64_t sample_begin, sample_end;  ///< its samples
+        };
+
+        namespace detail {
+
+            struct LineIndexHeader
+            {
+                char magic[6];
+                uint16_t version;
+                uint32_t sample_lines;
+                uint32_t chrom_num;
+                uint64_t file_size;
+                uint64_t line_num;
+                uint64_t sample_num;
+            };
+
+            constexpr char line_index_magic[6] = { 'B', 'E', 'D', 'L', 'I', 'X' };
+            constexpr uint16_t line_index_version = 1;
+        }
+    }
+
+/// @class BEDLineIndex
+/// @brief Line offset index of a plain text BED file sorted by chrom
+///        (grouped) and chromStart.
+///
+///     auto index = BEDLineIndex::build(path, 16);
+///     index.save(BEDLineIndex::default_path(path));
+///
+/// build() maps the file and indexes newline aligned chunks in parallel,
+/// then joins them; unsorted input throws std::runtime_error.
+    class BEDLineIndex
+    {
+      public:
+
+        static std::string default_path(const std::string& bed_path)
+        {
+            return bed_path + ".lidx";
+        }
+
+        BEDLineIndex() = default;
+
+        static BEDLineIndex build(const std::string& path,
+                                  std::size_t thread_num = bed::default_thread_num(),
+                                  uint32_t sample_lines = 1024)
+        {
+            BEDMmapReader<> reader(path);
+            auto body = reader.body_view();
+
+            BEDLineIndex index;
+            index.sample_lines = std::max<uint32_t>(sample_lines, 1);
+            index.file_size = size_of(path);
+            // offsets are counted from the start of the file, header lines included
+            const char* first = body.data() + body.size() - index.file_size;
+
+            auto chunks = bed::split_by_lines(body, std::max<std::size_t>(thread_num, 1) * 4);
+            std::vector<ChunkIndex> results(chunks.size());
+            bed::parallel_for(chunks.size(), thread_num, [&](std::size_t i)
+            {
+                results[i].build(chunks[i], chunks[i].data() - first, index.sample_lines);
+            });
+
+            for(auto& r: results)
+                index.join(r);
+            return index;
+        }
+
+        /// @brief Read an index written by save().
+        static BEDLineIndex load(const std::string& path)
+        {
+            bed::MappedFile file(path);
+            const char* p = file.data();
+            const char* last = file.data() + file.size();
+
+            auto fh = get<bed::detail::LineIndexHeader>(p, last, path);
+            if(std::memcmp(fh.magic, bed::detail::line_index_magic, sizeof(fh.magic)) != 0
+               || fh.version != bed::detail::line_index_version)
+                throw std::runtime_error("bed: not a line index " + path);
+
+            BEDLineIndex index;
+            index.sample_lines = fh.sample_lines;
+            index.file_size = fh.file_size;
+            index.line_num = fh.line_num;
+            for(uint32_t c = 0; c < fh.chrom_num; c++)
+            {
+                auto len = get<uint32_t>(p, last, path);
+                if(last - p < static_cast<std::ptrdiff_t>(len))
+                    throw std::runtime_error("bed: truncated line index " + path);
+                index.dict.intern(std::string_view(p, len));
+                p += len;
+                index.chroms.push_back(get<bed::ChromEntry>(p, last, path));
+            }
+            const std::size_t left = last - p;
+            if(fh.sample_num > left / sizeof(bed::LineSample) || left != fh.sample_num * sizeof(bed::LineSample))
+                throw std::runtime_error("bed: truncated line index " + path);
+            index.samples.resize(fh.sample_num);
+            std::memcpy(index.samples.data(), p, fh.sample_num * sizeof(bed::LineSample));
+
+            // ranges() indexes samples and the BED file with these as they are
+            if(index.dict.size() != index.chroms.size())
+                throw std::runtime_error("bed: truncated line index " + path);
+            for(auto& c: index.chroms)
+                if(c.sample_begin > c.sample_end || c.sample_end > index.samples.size()
+                   || c.begin > c.end || c.end > index.file_size)
+                    throw std::runtime_error("bed: truncated line index " + path);
+            if(!index.chroms.empty())
+                index.data_end = index.chroms.back().end;
+            return index;
+        }
+
+        void save(const std::string& path) const
+        {
+            std::ofstream ofs(path, std::ios::binary | std::ios::trunc);
+            if(!ofs)
+                throw std::runtime_error("bed: cannot write " + path);
+
+            bed::detail::LineIndexHeader fh{};
+            std::memcpy(fh.magic, bed::detail::line_index_magic, sizeof(fh.magic));
+            fh.version = bed::detail::line_index_version;
+            fh.sample_lines = sample_lines;
+            fh.chrom_num = chroms.size();
+            fh.file_size = file_size;
+            fh.line_num = line_num;
+            fh.sample_num = samples.size();
+            put(ofs, fh);
+            for(std::size_t c = 0; c < chroms.size(); c++)
+            {
+                put(ofs, static_cast<uint32_t>(dict.name(c).size()));
+                ofs.write(dict.name(c).data(), dict.name(c).size());
+                put(ofs, chroms[c]);
+            }
+            ofs.write(reinterpret_cast<const char*>(samples.data()), samples.size() * sizeof(bed::LineSample));
+
+            if(!ofs)
+                throw std::runtime_error("bed: error while writing " + path);
+        }
+
+        /// @brief Number of data lines.
+        uint64_t size() const { return line_num; }
+        /// @brief Size of the indexed BED file, to detect a stale index.
+        uint64_t indexed_file_size() const { return file_size; }
+        uint32_t get_sample_lines() const { return sample_lines; }
+
+        const bed::ChromDict& chrom_dict() const { return dict; }
+        const std::vector<bed::ChromEntry>& chrom_entries() const { return chroms; }
+        const std::vector<bed::LineSample>& line_samples() const { return samples; }
+
+        /// @brief Byte range [begin, end) of the lines after sample i.
+        std::pair<uint64_t, uint64_t> sample_range(std::size_t i) const
+        {
+            return { samples[i].offset, i + 1 < samples.size() ? samples[i + 1].offset : data_end };
+        }
+
+        /// @brief Merged byte ranges holding every line overlapping [start, end) on chrom.
+        std::vector<std::pair<uint64_t, uint64_t>> ranges(std::string_view chrom, uint32_t start, uint32_t end) const
+        {
+            std::vector<std::pair<uint64_t, uint64_t>> result;
+            auto c = dict.find(chrom);
+            if(c == bed::ChromDict::npos)
+                return result;
+
+            // lines are sorted by chromStart, so samples past end cannot overlap
+            auto first = samples.begin() + chroms[c].sample_begin;
+            auto last = std::lower_bound(first, samples.begin() + chroms[c].sample_end, end,
+                                         [](const bed::LineSample& s, uint32_t v){ return s.start < v; });
+            for(auto it = first; it != last; ++it)
+            {
+                if(it->max_end <= start)
+                    continue;
+                auto [b, e] = sample_range(it - samples.begin());
+                e = std::min(e, chroms[c].end);
+                if(!result.empty() && result.back().second == b)
+                    result.back().second = e;
+                else
+                    result.emplace_back(b, e);
+            }
+            return result;
+        }
+
+        /// @brief Index of the sample holding data line n.
+        std::size_t sample_of(uint64_t n) const
+        {
+            if(n >= line_num)
+                throw std::out_of_range("bed: line " + std::to_string(n) + " past the end of the index");
+            auto it = std::upper_bound(samples.begin(), samples.end(), n,
+                                       [](uint64_t v, const bed::LineSample& s){ return v < s.line; });
+            return it - samples.begin() - 1;
+        }
+
+      private:
+
+        /// @brief Samples and chromosome ranges of one chunk, line numbers
+        ///        relative to the chunk.
+        struct ChunkIndex
+        {
+            struct Chrom
+            {
+                std::string_view name;
+                uint64_t begin, end;
+                uint32_t first_start, last_start;
+                std::vector<bed::LineSample> samples;
+            };
+
+            void build(std::string_view chunk, uint64_t base, uint32_t sample_lines)
+            {
+                const char* cur  = chunk.data();
+                const char* last = chunk.data() + chunk.size();
+                std::array<std::string_view, 3> fields;
+                uint32_t since_sample = 0;
+
+                while(cur != last)
+                {
+                    const char* line_begin = cur;
+                    std::string_view line = BEDMmapReader<>::next_line(cur, last);
+                    if(line.empty() || bed::is_header_line(line))
+                        continue;
+
+                    if(bed::split_fields(line, fields) < 3)
+                        throw std::runtime_error("bed: line index needs chrom, chromStart and chromEnd on every line");
+                    const auto start = bed::to_integral<uint32_t>(fields[1]);
+                    const auto end   = bed::to_integral<uint32_t>(fields[2]);
+                    const uint64_t offset = base + (line_begin - chunk.data());
+
+                    if(chroms.empty() || chroms.back().name != fields[0])
+                    {
+                        chroms.push_back({ fields[0], offset, 0, start, start, {} });
+                        since_sample = sample_lines;
+                    }
+                    auto& c = chroms.back();
+                    if(start < c.last_start)
+                        throw std::runtime_error("bed: line index needs input sorted by chromStart");
+                    c.last_start = start;
+                    c.end = base + (cur - chunk.data());
+
+                    if(since_sample == sample_lines)
+                    {
+                        c.samples.push_back({ offset, lines, start, end });
+                        since_sample = 0;
+                    }
+                    c.samples.back().max_end = std::max(c.samples.back().max_end, end);
+                    since_sample++;
+                    lines++;
+                }
+            }
+
+            std::vector<Chrom> chroms;
+            uint64_t lines = 0;
+        };
+
+        void join(ChunkIndex& chunk)
+        {
+            for(auto& c: chunk.chroms)
+            {
+                auto id = dict.find(c.name);
+                bool extend = id != bed::ChromDict::npos && id + 1 == chroms.size();
+                if(id != bed::ChromDict::npos && !extend)
+                    throw std::runtime_error("bed: line index needs the lines of " + std::string(c.name) + " grouped together");
+                if(extend && c.first_start < last_start)
+                    throw std::runtime_error("bed: line index needs input sorted by chromStart");
+
+                if(!extend)
+                {
+                    dict.intern(c.name);
+                    chroms.push_back({ c.begin, c.end, samples.size(), samples.size() });
+                }
+                for(auto s: c.samples)
+                {
+                    s.line += line_num;
+                    samples.push_back(s);
+                }
+                chroms.back().end = c.end;
+                chroms.back().sample_end = samples.size();
+                last_start = c.last_start;
+                data_end = c.end;
+            }
+            line_num += chunk.lines;
+        }
+
+        static uint64_t size_of(const std::string& path)
+        {
+            struct stat st;
+            if(::stat(path.c_str(), &st) != 0)
+                throw std::runtime_error("bed: cannot open " + path);
+            return st.st_size;
+        }
+
+        template<class T>
+        static void put(std::ofstream& ofs, const T& v)
+        {
+            ofs.write(reinterpret_cast<const char*>(&v), sizeof(T));
+        }
+
+        template<class T>
+        static T get(const char*& p, const char* last, const std::string& path)
+        {
+            if(last - p < static_cast<std::ptrdiff_t>(sizeof(T)))
+                throw std::runtime_error("bed: truncated line index " + path);
+            T v;
+            std::memcpy(&v, p, sizeof(T));
+            p += sizeof(T);
+            return v;
+        }
+
+        bed::ChromDict dict;
+        std::vector<bed::ChromEntry> chroms;
+        std::vector<bed::LineSample> samples;
+        uint32_t sample_lines = 1024;
+        uint64_t file_size = 0;
+        uint64_t line_num = 0;
+        uint64_t data_end = 0;
+        uint32_t last_start = 0;
+    };
+
+/// @class BEDLineReader
+/// @brief Random access into a sorted plain text BED file through its BEDLineIndex.
+///
+///     BEDLineReader<TupleType> reader(path);     // loads path.lidx
+///     for(auto& bed: reader.query(bed::Region::parse("chr1:1000-2000")))
+///         ...
+///     auto bed = reader.record(123456);
+///
+/// Only the byte ranges the index points to are read, with pread(), and
+/// parsed with BEDRecord::set_bed_data. A reader may be shared by threads.
+    template<class TupleType = std::tuple <std::string, uint32_t, uint32_t> >
+    class BEDLineReader
+    {
+      public:
+
+        BEDLineReader(const std::string& path, BEDLineIndex index)
+            : path(path), index(std::move(index))
+        {
+            fd = ::open(path.c_str(), O_RDONLY);
+            if(fd < 0)
+                throw std::runtime_error("bed: cannot open " + path);
+
+            struct stat st;
+            if(::fstat(fd, &st) != 0 || static_cast<uint64_t>(st.st_size) != this->index.indexed_file_size())
+            {
+                ::close(fd);
+                throw std::runtime_error("bed: line index does not match " + path + ", rebuild it");
+            }
+        }
+
+        explicit BEDLineReader(const std::string& path)
+            : BEDLineReader(path, BEDLineIndex::load(BEDLineIndex::default_path(path)))
+        {}
+
+        BEDLineReader(const BEDLineReader&) = delete;
+        BEDLineReader& operator=(const BEDLineReader&) = delete;
+
+        ~BEDLineReader()
+        {
+            ::close(fd);
+        }
+
+        const BEDLineIndex& line_index() const { return index; }
+        uint64_t size() const { return index.size(); }
+
+        /// @brief Call f(record) for every record overlapping region, in file order.
+        template<class Callback>
+        void for_each_in(const bed::Region& region, Callback&& f) const
+        {
+            std::string buf;
+            BEDRecord<TupleType> bed;
+            for(auto [begin, end]: index.ranges(region.chrom, region.start, region.end))
+            {
+                read(begin, end, buf);
+                for_each_line(buf, [&](std::string_view line)
+                {
+                    bed.set_bed_data(line);
+                    if(region.overlaps(std::get<bed::Col::chrom>(bed.data),
+                                       std::get<bed::Col::chromStart>(bed.data),
+                                       std::get<bed::Col::chromEnd>(bed.data)))
+                        f(bed);
+                    return true;
+                });
+            }
+        }
+
+        std::vector<BEDRecord<TupleType>> query(const bed::Region& region) const
+        {
+            std::vector<BEDRecord<TupleType>> v_bed;
+            for_each_in(region, [&v_bed](auto& bed){ v_bed.push_back(bed); });
+            return v_bed;
+        }
+
+        /// @brief Data line n (from 0, header and empty lines not counted).
+        BEDRecord<TupleType> record(uint64_t n) const
+        {
+            auto s = index.sample_of(n);
+            auto [begin, end] = index.sample_range(s);
+            auto skip = n - index.line_samples()[s].line;
+
+            std::string buf;
+            read(begin, end, buf);
+            BEDRecord<TupleType> bed;
+            for_each_line(buf, [&](std::string_view line)
+            {
+                if(skip-- > 0)
+                    return true;
+                bed.set_bed_data(line);
+                return false;
+            });
+            return bed;
+        }
+
+      private:
+
+        void read(uint64_t begin, uint64_t end, std::string& buf) const
+        {
+            buf.resize(end - begin);
+            std::size_t done = 0;
+            while(done < buf.size())
+            {
+                auto n = ::pread(fd, &buf[done], buf.size() - done, begin + done);
+                if(n <= 0)
+                    throw std::runtime_error("bed: cannot read " + path);
+                done += n;
+            }
+        }
+
+        /// @brief Call f(line) for the data lines of buf while it returns true.
+        template<class F>
+        static void for_each_line(std::string_view buf, F&& f)
+        {
+            const char* cur  = buf.data();
+            const char* last = buf.data() + buf.size();
+            while(cur != last)
+            {
+                std::string_view line = BEDMmapReader<TupleType>::next_line(cur, last);
+                if(line.empty() || bed::is_header_line(line))
+                    continue;
+                if(!f(line))
+                    return;
+            }
+        }
+
+        std::string path;
+        BEDLineIndex index;
+        int fd = -1;
+    };
+
+}
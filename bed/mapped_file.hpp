@@ -0,0 +1,105 @@
+/// @file mapped_file.hpp
+/// @brief Read-only memory mapping of a whole file
+
+#pragma once
+#include <string>
+#include <string_view>
+#include <stdexcept>
+#include <utility>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace biovoltron::format::bed {
+
+/// @class MappedFile
+/// @brief RAII wrapper of a read-only, private mmap of a file.
+///
+/// The mapping lives as long as the object; std::string_view handed out by
+/// view() stay valid until then. An empty file gives an empty view.
+    class MappedFile
+    {
+      public:
+
+        MappedFile() = default;
+
+        explicit MappedFile(const std::string& path)
+        {
+            open(path);
+        }
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        MappedFile(MappedFile&& other) noexcept
+            : addr(std::exchange(other.addr, nullptr)),
+              length(std::exchange(other.length, 0))
+        {}
+
+        MappedFile& operator=(MappedFile&& other) noexcept
+        {
+            if(this != &other)
+            {
+                close();
+                addr   = std::exchange(other.addr, nullptr);
+                length = std::exchange(other.length, 0);
+            }
+            return *this;
+        }
+
+        ~MappedFile()
+        {
+            close();
+        }
+
+        void open(const std::string& path)
+        {
+            close();
+
+            int fd = ::open(path.c_str(), O_RDONLY);
+            if(fd < 0)
+                throw std::runtime_error("bed: cannot open " + path);
+
+            struct stat st;
+            if(::fstat(fd, &st) != 0)
+            {
+                ::close(fd);
+                throw std::runtime_error("bed: cannot stat " + path);
+            }
+
+            length = static_cast<std::size_t>(st.st_size);
+            if(length != 0)
+            {
+                void* p = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+                if(p == MAP_FAILED)
+                {
+                    ::close(fd);
+                    length = 0;
+                    throw std::runtime_error("bed: cannot mmap " + path);
+                }
+                addr = static_cast<const char*>(p);
+                ::madvise(p, length, MADV_SEQUENTIAL);
+            }
+            ::close(fd);
+        }
+
+        void close()
+        {
+            if(addr != nullptr)
+                ::munmap(const_cast<char*>(addr), length);
+            addr = nullptr;
+            length = 0;
+        }
+
+        const char* data() const { return addr; }
+        std::size_t size() const { return length; }
+        std::string_view view() const { return std::string_view(addr, length); }
+
+      private:
+
+        const char* addr = nullptr;
+        std::size_t length = 0;
+    };
+
+}
@@ -0,0 +1,211 @@
+/// @file mmap_reader.hpp
+/// @brief Zero-copy BED reader on top of a memory mapped file
+
+#pragma once
+#include <Biovoltron/format/bed.hpp>
+#include <Biovoltron/format/bed/mapped_file.hpp>
+#include <Biovoltron/format/bed/tokenizer.hpp>
+#include <array>
+#include <cstring>
+#include <iterator>
+#include <string_view>
+
+namespace biovoltron::format{
+
+/// @class BEDRecordView
+/// @brief A data line of a mapped BED file, split into std::string_view fields.
+///
+/// The view does not own anything; it stays valid as long as the
+/// BEDMmapReader it came from. Conversion to BED<TupleType> (or the lean
+/// BEDRecord<TupleType>) only happens on request through to_bed() / to_record().
+    template<class TupleType = std::tuple <std::string, uint32_t, uint32_t> >
+    class BEDRecordView
+    {
+      public:
+
+        static constexpr std::size_t max_fields = 16;
+
+        BEDRecordView() = default;
+
+        explicit BEDRecordView(std::string_view line)
+            : line_(line), field_num(bed::split_fields(line, fields))
+        {}
+
+        std::string_view line() const { return line_; }
+        std::size_t size() const { return field_num; }
+        std::string_view operator[](std::size_t i) const { return fields[i]; }
+
+        void to_bed(BEDRecord<TupleType>& bed) const
+        {
+            constexpr auto tup_size = std::tuple_size<TupleType>::value;
+            static_assert( tup_size <= max_fields, "TOO MANY COLUMNS FOR A RECORD VIEW");
+            static_assert( !bed::BlockStore<TupleType>::enabled, "BLOCKSPAN COLUMNS ARE ONLY FILLED BY BEDFILE");
+
+            bed.template fill<TupleType, tup_size>(bed.data, fields);
+        }
+
+        BED<TupleType> to_bed() const
+        {
+            BED<TupleType> bed;
+            to_bed(bed);
+            return bed;
+        }
+
+        BEDRecord<TupleType> to_record() const
+        {
+            BEDRecord<TupleType> record;
+            to_bed(record);
+            return record;
+        }
+
+      private:
+
+        std::string_view line_;
+        std::array<std::string_view, max_fields> fields{};
+        std::size_t field_num = 0;
+    };
+
+/// @class BEDMmapReader
+/// @brief Memory maps a BED file and iterates its data lines as BEDRecordView.
+///
+/// Leading header lines (track / browser / #) are consumed on construction,
+/// the last track line is parsed into header(). Empty lines are skipped and a
+/// trailing '\r' is dropped from every line.
+///
+///     BEDMmapReader<TupleType> reader(path);
+///     for(auto& view: reader)
+///         auto bed = view.to_bed();
+    template<class TupleType = std::tuple <std::string, uint32_t, uint32_t> >
+    class BEDMmapReader
+    {
+      public:
+
+        using view_type = BEDRecordView<TupleType>;
+
+        class iterator
+        {
+          public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type        = view_type;
+            using difference_type   = std::ptrdiff_t;
+            using pointer           = const view_type*;
+            using reference         = const view_type&;
+
+            iterator() = default;
+
+            iterator(const char* first, const char* last)
+                : next(first), last(last)
+            {
+                advance();
+            }
+
+            reference operator*() const { return view; }
+            pointer operator->() const { return &view; }
+
+            iterator& operator++()
+            {
+                advance();
+                return *this;
+            }
+
+            iterator operator++(int)
+            {
+                iterator tmp = *this;
+                advance();
+                return tmp;
+            }
+
+            friend bool operator==(const iterator& a, const iterator& b)
+            {
+                return a.view.line().data() == b.view.line().data();
+            }
+
+            friend bool operator!=(const iterator& a, const iterator& b)
+            {
+                return !(a == b);
+            }
+
+          private:
+
+            void advance()
+            {
+                while(next != last)
+                {
+                    std::string_view line = next_line(next, last);
+                    if(!line.empty())
+                    {
+                        view = view_type(line);
+                        return;
+                    }
+                }
+                view = view_type();
+            }
+
+            const char* next = nullptr;
+            const char* last = nullptr;
+            view_type view;
+        };
+
+        explicit BEDMmapReader(const std::string& path)
+            : file(path)
+        {
+            const char* first = file.data();
+            const char* last  = file.data() + file.size();
+            const char* cur   = first;
+
+            while(cur != last)
+            {
+                const char* line_begin = cur;
+                std::string_view line = next_line(cur, last);
+                if(line.empty())
+                    continue;
+                if(!bed::is_header_line(line))
+                {
+                    cur = line_begin;
+                    break;
+                }
+                if(line.substr(0, 5) == "track")
+                {
+                    std::string str(line);
+                    header_.set(str);
+                }
+            }
+            body = cur - first;
+        }
+
+        const BEDHeader& header() const { return header_; }
+
+        /// @brief The mapped bytes of the data lines (after the header lines).
+        std::string_view body_view() const { return file.view().substr(body); }
+
+        iterator begin() const
+        {
+            return iterator(file.data() + body, file.data() + file.size());
+        }
+
+        iterator end() const
+        {
+            return iterator();
+        }
+
+        /// @brief Take the line starting at cur and move cur past its '\n'.
+        static std::string_view next_line(const char*& cur, const char* last)
+        {
+            const char* nl = static_cast<const char*>(std::memchr(cur, '\n', last - cur));
+            const char* line_end = nl ? nl : last;
+            std::string_view line(cur, line_end - cur);
+            cur = nl ? nl + 1 : last;
+
+            if(!line.empty() && line.back() == '\r')
+                line.remove_suffix(1);
+            return line;
+        }
+
+      private:
+
+        bed::MappedFile file;
+        BEDHeader header_;
+        std::size_t body = 0;
+    };
+
+}
@@ -0,0 +1,182 @@
+/// @file parallel_parser.hpp
+/// @brief Multi-threaded chunked BED parser
+
+#pragma once
+#include <Biovoltron/format/bed.hpp>
+#include <Biovoltron/format/bed/mmap_reader.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <exception>
+#include <mutex>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace biovoltron::format{
+
+    namespace bed {
+
+        /// @brief Cut data into at most n byte ranges, each ending right after a '\n'
+        ///        (or at the end of data), so no line is split between two ranges.
+        inline std::vector<std::string_view> split_by_lines(std::string_view data, std::size_t n)
+        {
+            std::vector<std::string_view> chunks;
+            if(data.empty())
+                return chunks;
+
+            n = std::max<std::size_t>(n, 1);
+            const std::size_t step = std::max<std::size_t>(data.size() / n, 1);
+
+            std::size_t begin = 0;
+            while(begin < data.size())
+            {
+                std::size_t end = std::min(begin + step, data.size());
+                if(end < data.size())
+                {
+                    std::size_t nl = data.find('\n', end - 1);
+                    end = (nl == std::string_view::npos) ? data.size() : nl + 1;
+                }
+                chunks.emplace_back(data.substr(begin, end - begin));
+                begin = end;
+            }
+            return chunks;
+        }
+
+        /// @brief Run task(i) for i in [0, n) on thread_num threads.
+        ///
+        /// The first exception thrown by a task is rethrown in the caller
+        /// after all threads joined.
+        template<class Task>
+        void parallel_for(std::size_t n, std::size_t thread_num, Task&& task)
+        {
+            thread_num = std::max<std::size_t>(1, std::min(thread_num, n));
+            if(thread_num == 1)
+            {
+                for(std::size_t i = 0; i < n; i++)
+                    task(i);
+                return;
+            }
+
+            std::atomic<std::size_t> next{0};
+            std::exception_ptr error;
+            std::mutex error_mutex;
+
+            auto worker = [&]
+            {
+                for(std::size_t i; (i = next.fetch_add(1)) < n; )
+                {
+                    try
+                    {
+                        task(i);
+                    }
+                    catch(...)
+                    {
+                        std::lock_guard<std::mutex> lock(error_mutex);
+                        if(!error)
+                            error = std::current_exception();
+                        next = n;
+                    }
+                }
+            };
+
+            std::vector<std::thread> threads;
+            for(std::size_t t = 1; t < thread_num; t++)
+                threads.emplace_back(worker);
+            worker();
+            for(auto& th: threads)
+                th.join();
+
+            if(error)
+                std::rethrow_exception(error);
+        }
+
+        inline std::size_t default_thread_num()
+        {
+            return std::max(1u, std::thread::hardware_concurrency());
+        }
+    }
+
+/// @class BEDParallelParser
+/// @brief Parses BED data lines on a pool of threads.
+///
+/// The input is cut into newline aligned byte ranges, each range is parsed
+/// by a worker with the same fill() used by BED::set_bed_data, and the
+/// results are joined back in file order. Records are the lean
+/// BEDRecord<TupleType>, the track line goes to a single BEDHeader.
+///
+///     BEDParallelParser<TupleType> parser(16);
+///     BEDHeader h;
+///     auto v_bed = parser.load(path, h);
+    template<class TupleType = std::tuple <std::string, uint32_t, uint32_t> >
+    class BEDParallelParser
+    {
+      public:
+
+        explicit BEDParallelParser(std::size_t thread_num = bed::default_thread_num())
+            : thread_num(std::max<std::size_t>(thread_num, 1))
+        {}
+
+        void set_thread_num(std::size_t n) { thread_num = std::max<std::size_t>(n, 1); }
+        std::size_t get_thread_num() const { return thread_num; }
+
+        /// @brief Parse data lines (no header lines) held in memory.
+        std::vector<BEDRecord<TupleType>> parse(std::string_view data) const
+        {
+            // a few ranges per thread keeps the workers busy when lines are uneven
+            auto chunks = bed::split_by_lines(data, thread_num == 1 ? 1 : thread_num * 4);
+            std::vector<std::vector<BEDRecord<TupleType>>> results(chunks.size());
+
+            bed::parallel_for(chunks.size(), thread_num, [&](std::size_t i)
+            {
+                parse_chunk(chunks[i], results[i]);
+            });
+
+            std::size_t total = 0;
+            for(auto& r: results)
+                total += r.size();
+
+            std::vector<BEDRecord<TupleType>> v_bed;
+            v_bed.reserve(total);
+            for(auto& r: results)
+                std::move(r.begin(), r.end(), std::back_inserter(v_bed));
+            return v_bed;
+        }
+
+        /// @brief Parse a BED file, its track line goes to header.
+        std::vector<BEDRecord<TupleType>> load(const std::string& path, BEDHeader& header) const
+        {
+            BEDMmapReader<TupleType> reader(path);
+            header = reader.header();
+            return parse(reader.body_view());
+        }
+
+        std::vector<BEDRecord<TupleType>> load(const std::string& path) const
+        {
+            BEDHeader header;
+            return load(path, header);
+        }
+
+      private:
+
+        static void parse_chunk(std::string_view chunk, std::vector<BEDRecord<TupleType>>& v_bed)
+        {
+            const char* cur  = chunk.data();
+            const char* last = chunk.data() + chunk.size();
+            v_bed.reserve(std::count(cur, last, '\n') + 1);
+
+            while(cur != last)
+            {
+                std::string_view line = BEDMmapReader<TupleType>::next_line(cur, last);
+                if(line.empty())
+                    continue;
+                // set_bed_data splits only the columns TupleType converts
+                v_bed.emplace_back();
+                v_bed.back().set_bed_data(line);
+            }
+        }
+
+        std::size_t thread_num;
+    };
+
+}
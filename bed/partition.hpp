@@ -0,0 +1,377 @@
+/// @file partition.hpp
+/// @brief Splitting a BED stream into per-chromosome or genomic bin shards,
+///        and running work over the shards on a thread pool
+
+#pragma once
+#include <Biovoltron/format/bed.hpp>
+#include <Biovoltron/format/bed/mapped_file.hpp>
+#include <Biovoltron/format/bed/mmap_reader.hpp>
+#include <Biovoltron/format/bed/parallel_parser.hpp>
+#include <Biovoltron/format/bed/tokenizer.hpp>
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <istream>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+namespace biovoltron::format{
+
+    namespace bed {
+
+        enum class PartitionMode
+        {
+            chrom,  ///< one shard per chromosome
+            bin     ///< one shard per bin_size bp of every chromosome
+        };
+
+        struct PartitionOptions
+        {
+            PartitionMode mode = PartitionMode::chrom;
+            /// @brief Bin width of PartitionMode::bin; a record goes to the bin of its chromStart.
+            uint32_t bin_size = 10000000;
+            /// @brief Bytes kept per shard before they are appended to its file.
+            std::size_t buffer_size = 1 << 18;
+        };
+
+        /// @brief One shard file, as listed in the manifest.
+        struct Shard
+        {
+            std::string path;
+            std::string chrom;
+            /// @brief Bin [bin_start, bin_end) of the shard, the whole chromosome in chrom mode.
+            uint32_t bin_start = 0;
+            uint32_t bin_end = std::numeric_limits<uint32_t>::max();
+            uint64_t records = 0;
+            /// @brief File size, track line included.
+            uint64_t bytes = 0;
+            /// @brief Span [min_start, max_end) of its records.
+            uint32_t min_start = std::numeric_limits<uint32_t>::max();
+            uint32_t max_end = 0;
+        };
+
+        /// @brief The shards of a partition, in the order their first record
+        ///        appeared in the input.
+        ///
+        /// Saved as a tab separated text file with a "#" column line, so
+        /// cluster scripts can read it too.
+        struct Manifest
+        {
+            std::string track_line;
+            std::vector<Shard> shards;
+
+            uint64_t records() const
+            {
+                uint64_t n = 0;
+                for(auto& s: shards)
+                    n += s.records;
+                return n;
+            }
+
+            void save(const std::string& path) const
+            {
+                std::ofstream ofs(path, std::ios::trunc);
+                if(!ofs)
+                    throw std::runtime_error("bed: cannot write " + path);
+                ofs << "#track\t" << track_line << "\n";
+                ofs << "#path\tchrom\tbin_start\tbin_end\trecords\tbytes\tmin_start\tmax_end\n";
+                for(auto& s: shards)
+                    ofs << s.path << '\t' << s.chrom << '\t' << s.bin_start << '\t' << s.bin_end << '\t'
+                        << s.records << '\t' << s.bytes << '\t' << s.min_start << '\t' << s.max_end << '\n';
+                if(!ofs)
+                    throw std::runtime_error("bed: error while writing " + path);
+            }
+
+            static Manifest load(const std::string& path)
+            {
+                std::ifstream ifs(path);
+                if(!ifs)
+                    throw std::runtime_error("bed: cannot open " + path);
+
+                Manifest manifest;
+                std::string line;
+                while(std::getline(ifs, line))
+                {
+                    if(line.empty())
+                        continue;
+                    if(line.compare(0, 7, "#track\t") == 0)
+                    {
+                        manifest.track_line = line.substr(7);
+                        continue;
+                    }
+                    if(line[0] == '#')
+                        continue;
+
+                    std::array<std::string_view, 8> f;
+                    if(detail::split(line, f, [](const char* p, const char* last)
+                                              {
+                                                  const void* t = std::memchr(p, '\t', last - p);
+                                                  return t ? static_cast<const char*>(t) : last;
+                                              },
+                                     [](char){ return false; }) != f.size())
+                        throw std::runtime_error("bed: malformed manifest line in " + path);
+
+                    Shard s;
+                    s.path      = std::string(f[0]);
+                    s.chrom     = std::string(f[1]);
+                    s.bin_start = to_integral<uint32_t>(f[2]);
+                    s.bin_end   = to_integral<uint32_t>(f[3]);
+                    s.records   = to_integral<uint64_t>(f[4]);
+                    s.bytes     = to_integral<uint64_t>(f[5]);
+                    s.min_start = to_integral<uint32_t>(f[6]);
+                    s.max_end   = to_integral<uint32_t>(f[7]);
+                    manifest.shards.push_back(std::move(s));
+                }
+                return manifest;
+            }
+        };
+
+        /// @brief File name stem of the shards of chrom, which the manifest
+        ///        keeps apart. Bytes other than letters, digits, '_', '-' and
+        ///        a '.' not in front become %XX, so a chrom cannot leave the
+        ///        shard directory, hide its file or share it with another chrom.
+        inline std::string shard_name(std::string_view chrom)
+        {
+            static const char hex[] = "0123456789ABCDEF";
+            std::string name;
+            for(std::size_t i = 0; i < chrom.size(); i++)
+            {
+                const unsigned char c = chrom[i];
+                if((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9')
+                   || c == '_' || c == '-' || (c == '.' && i > 0))
+                    name += c;
+                else
+                {
+                    name += '%';
+                    name += hex[c >> 4];
+                    name += hex[c & 15];
+                }
+            }
+            return name.empty() ? "%" : name;
+        }
+    }
+
+/// @class BEDPartitioner
+/// @brief Splits BED data into shard files in one streaming pass.
+///
+///     bed::PartitionOptions opts;
+///     opts.mode = bed::PartitionMode::bin;
+///     auto manifest = BEDPartitioner(dir, opts).partition_file(path);
+///     manifest.save(dir + "/manifest.tsv");
+///
+/// Lines are copied as they are, only chrom / chromStart / chromEnd are
+/// read. Every shard keeps a buffer that is appended to its file when it
+/// grows past buffer_size, so no file stays open and the number of shards
+/// is not bounded by the open file limit. The track line of the input
+/// starts every shard.
+    class BEDPartitioner
+    {
+      public:
+
+        explicit BEDPartitioner(std::string dir, bed::PartitionOptions options = bed::PartitionOptions())
+            : dir(std::move(dir)), options(options)
+        {
+            if(this->options.bin_size == 0)
+                throw std::invalid_argument("bed: bin_size of a partition must not be 0");
+        }
+
+        bed::Manifest partition(std::istream& is)
+        {
+            start();
+            std::string line;
+            while(std::getline(is, line))
+                add_line(line);
+            return finish();
+        }
+
+        bed::Manifest partition_file(const std::string& path)
+        {
+            bed::MappedFile file(path);
+            const char* cur  = file.data();
+            const char* last = file.data() + file.size();
+
+            start();
+            while(cur != last)
+                add_line(BEDMmapReader<>::next_line(cur, last));
+            return finish();
+        }
+
+      private:
+
+        struct Writer
+        {
+            std::string buf;
+            bool created = false;
+        };
+
+        void start()
+        {
+            manifest = bed::Manifest();
+            writers.clear();
+            lookup.clear();
+            in_header = true;
+        }
+
+        void add_line(std::string_view line)
+        {
+            if(!line.empty() && line.back() == '\r')
+                line.remove_suffix(1);
+            if(line.empty())
+                return;
+            if(bed::is_header_line(line))
+            {
+                // the last track line before the data, like BEDMmapReader
+                if(in_header && line.substr(0, 5) == "track")
+                    manifest.track_line = std::string(line);
+                return;
+            }
+            in_header = false;
+
+            std::array<std::string_view, 3> fields;
+            if(bed::split_fields(line, fields) < 3)
+                throw std::runtime_error("bed: partition needs chrom, chromStart and chromEnd on every line");
+            const auto start = bed::to_integral<uint32_t>(fields[1]);
+            const auto end   = bed::to_integral<uint32_t>(fields[2]);
+
+            const std::size_t s = shard_of(fields[0], start);
+            auto& shard = manifest.shards[s];
+            shard.records++;
+            shard.min_start = std::min(shard.min_start, start);
+            shard.max_end = std::max(shard.max_end, end);
+
+            auto& w = writers[s];
+            w.buf.append(line.data(), line.size());
+            w.buf += '\n';
+            shard.bytes += line.size() + 1;
+            if(w.buf.size() >= options.buffer_size)
+                flush(s);
+        }
+
+        std::size_t shard_of(std::string_view chrom, uint32_t start)
+        {
+            const uint32_t bin = options.mode == bed::PartitionMode::bin ? start / options.bin_size : 0;
+            // sorted or grouped input keeps hitting the shard of the previous line
+            if(!writers.empty() && bin == last_bin && chrom == manifest.shards[last].chrom)
+                return last;
+
+            key.assign(chrom.data(), chrom.size());
+            if(options.mode == bed::PartitionMode::bin)
+            {
+                key += '\t';
+                key += std::to_string(bin);
+            }
+            last_bin = bin;
+
+            auto it = lookup.find(key);
+            if(it != lookup.end())
+                return last = it->second;
+
+            bed::Shard shard;
+            shard.chrom = std::string(chrom);
+            std::string name = bed::shard_name(shard.chrom);
+            if(options.mode == bed::PartitionMode::bin)
+            {
+                shard.bin_start = bin * options.bin_size;
+                shard.bin_end = uint64_t(shard.bin_start) + options.bin_size > std::numeric_limits<uint32_t>::max()
+                              ? std::numeric_limits<uint32_t>::max() : shard.bin_start + options.bin_size;
+                name += "_" + std::to_string(shard.bin_start) + "-" + std::to_string(shard.bin_end);
+            }
+            shard.path = dir + "/" + name + ".bed";
+            if(!manifest.track_line.empty())
+                shard.bytes = manifest.track_line.size() + 1;
+
+            manifest.shards.push_back(std::move(shard));
+            writers.emplace_back();
+            lookup.emplace(key, writers.size() - 1);
+            return last = writers.size() - 1;
+        }
+
+        void flush(std::size_t s)
+        {
+            auto& w = writers[s];
+            auto& path = manifest.shards[s].path;
+            std::ofstream ofs(path, std::ios::binary | (w.created ? std::ios::app : std::ios::trunc));
+            if(!ofs)
+                throw std::runtime_error("bed: cannot write " + path);
+            if(!w.created && !manifest.track_line.empty())
+                ofs << manifest.track_line << '\n';
+            ofs.write(w.buf.data(), w.buf.size());
+            if(!ofs)
+                throw std::runtime_error("bed: error while writing " + path);
+            w.created = true;
+            w.buf.clear();
+        }
+
+        bed::Manifest finish()
+        {
+            for(std::size_t s = 0; s < writers.size(); s++)
+                flush(s);
+            writers.clear();
+            lookup.clear();
+            return std::move(manifest);
+        }
+
+        std::string dir;
+        bed::PartitionOptions options;
+        bed::Manifest manifest;
+        std::vector<Writer> writers;
+        std::unordered_map<std::string, std::size_t> lookup;
+        std::string key;
+        std::size_t last = 0;
+        uint32_t last_bin = 0;
+        bool in_header = true;
+    };
+
+    namespace bed {
+
+        /// @brief Run f(shard, records) for every shard of manifest on
+        ///        thread_num threads, records being the shard parsed as
+        ///        BEDRecord<TupleType>.
+        ///
+        /// Larger shards are started first to even out the workers. The
+        /// results come back in manifest order, so concatenating them gives
+        /// the result of a single process run over the input.
+        template<class TupleType, class F>
+        auto run_shards(const Manifest& manifest, std::size_t thread_num, F&& f)
+        {
+            using R = std::decay_t<decltype(f(std::declval<const Shard&>(),
+                                              std::declval<std::vector<BEDRecord<TupleType>>&>()))>;
+            static_assert(!std::is_void<R>::value, "THE SHARD CALLBACK MUST RETURN A RESULT");
+
+            std::vector<std::size_t> order(manifest.shards.size());
+            std::iota(order.begin(), order.end(), 0);
+            std::stable_sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b)
+            {
+                return manifest.shards[a].bytes > manifest.shards[b].bytes;
+            });
+
+            std::vector<R> results(manifest.shards.size());
+            parallel_for(order.size(), thread_num, [&](std::size_t i)
+            {
+                auto& shard = manifest.shards[order[i]];
+                auto v_bed = BEDParallelParser<TupleType>(1).load(shard.path);
+                results[order[i]] = f(shard, v_bed);
+            });
+            return results;
+        }
+
+        /// @brief run_shards, then fold the results in manifest order with
+        ///        merge(accumulator, result).
+        template<class TupleType, class F, class T, class Merge>
+        T run_shards(const Manifest& manifest, std::size_t thread_num, F&& f, T init, Merge&& merge)
+        {
+            for(auto& r: run_shards<TupleType>(manifest, thread_num, f))
+                merge(init, std::move(r));
+            return init;
+        }
+    }
+
+}
@@ -0,0 +1,102 @@
+/// @file projection.hpp
+/// @brief Column projection: tuple slots that are skipped or parsed on access
+
+#pragma once
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+
+namespace biovoltron::format::bed {
+
+    /// @brief Convert one field to T like BEDRecord::fill does (defined in bed.hpp).
+    template<class T>
+    void convert_field(std::string_view field, T& value);
+
+/// @class Skip
+/// @brief A tuple slot for a column that is never converted.
+///
+/// Columns are only split up to the last slot that is not Skip, so a
+/// projection of the first columns of a wide file stops tokenizing early:
+///
+///     // chrom, chromStart, chromEnd and strand of a BED12 file
+///     using Projection = std::tuple<std::string, uint32_t, uint32_t,
+///                                   bed::Skip, bed::Skip, char>;
+///
+/// Skipped columns are written back as ".".
+    struct Skip
+    {
+        bool operator==(const Skip&) const { return true; }
+        bool operator!=(const Skip&) const { return false; }
+    };
+
+/// @class Lazy
+/// @brief A tuple slot keeping the raw text of a column, converted to T
+///        on the first call of get().
+///
+/// The raw text is copied (short fields stay in the small string buffer),
+/// so the record does not depend on the line it was parsed from. get() is
+/// not safe to call concurrently on the same slot. Lazy columns are written
+/// back as their raw text.
+    template<class T>
+    class Lazy
+    {
+      public:
+
+        using value_type = T;
+
+        void set_raw(std::string_view raw)
+        {
+            raw_ = raw;
+            parsed = false;
+        }
+
+        std::string_view raw() const { return raw_; }
+
+        const T& get() const
+        {
+            if(!parsed)
+            {
+                convert_field(raw_, value);
+                parsed = true;
+            }
+            return value;
+        }
+
+        bool operator==(const Lazy& rhs) const { return raw_ == rhs.raw_; }
+        bool operator!=(const Lazy& rhs) const { return raw_ != rhs.raw_; }
+
+      private:
+
+        std::string raw_;
+        mutable T value{};
+        mutable bool parsed = false;
+    };
+
+    template<class T>
+    struct IsLazy
+    {
+        static const bool value = false;
+    };
+
+    template<class T>
+    struct IsLazy<Lazy<T>>
+    {
+        static const bool value = true;
+    };
+
+    /// @brief Number of leading columns of TupleType that have to be split:
+    ///        everything after the last slot that is not Skip is left alone.
+    template<class TupleType, std::size_t i = std::tuple_size<TupleType>::value>
+    constexpr std::size_t parsed_columns()
+    {
+        if constexpr(i == 0)
+            return 0;
+        else if constexpr(std::is_same<Skip, std::tuple_element_t<i-1, TupleType>>::value)
+            return parsed_columns<TupleType, i-1>();
+        else
+            return i;
+    }
+
+}
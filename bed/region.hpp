@@ -0,0 +1,48 @@
+/// @file region.hpp
+/// @brief Genomic region used by the BED query APIs
+
+#pragma once
+#include <Biovoltron/format/bed/tokenizer.hpp>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+namespace biovoltron::format::bed {
+
+/// @class Region
+/// @brief A half-open interval [start, end) on chrom, same convention as
+///        the chromStart / chromEnd columns.
+    struct Region
+    {
+        std::string chrom;
+        uint32_t start = 0;
+        uint32_t end = std::numeric_limits<uint32_t>::max();
+
+        bool overlaps(std::string_view c, uint32_t s, uint32_t e) const
+        {
+            return c == chrom && s < end && start < e;
+        }
+
+        /// @brief Parse "chr1", "chr1:1000" or "chr1:1000-2000" (0-based, half-open).
+        static Region parse(std::string_view str)
+        {
+            Region region;
+            auto colon = str.rfind(':');
+            region.chrom = std::string(str.substr(0, colon));
+            if(colon == std::string_view::npos)
+                return region;
+
+            auto range = str.substr(colon + 1);
+            auto dash = range.find('-');
+            region.start = to_integral<uint32_t>(range.substr(0, dash));
+            if(dash != std::string_view::npos)
+                region.end = to_integral<uint32_t>(range.substr(dash + 1));
+            if(region.end < region.start)
+                throw std::invalid_argument("bed: region end before start");
+            return region;
+        }
+    };
+
+}
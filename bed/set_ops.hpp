@@ -0,0 +1,449 @@
+/// @file set_ops.hpp
+/// @brief Streaming sweep-line interval set operations on sorted BED streams
+///
+/// Every operator is a pull source: bool next(bed::Interval&) gives the next
+/// output interval, sorted like its input, and keeps only the intervals that
+/// can still overlap what comes next. Operators take their sources by value,
+/// so pipelines compose without materializing anything:
+///
+///     bed::RecordSource<TupleType> peaks(peaks_is), genes(genes_is);
+///     auto merged = bed::merge(std::move(peaks), 100);
+///     auto hits   = bed::intersect(std::move(merged), std::move(genes));
+///     bed::write(hits, os);
+///
+/// Inputs must be sorted by chrom (byte order) then chromStart, the order
+/// BEDSorter produces; RecordSource throws std::runtime_error otherwise.
+
+#pragma once
+#include <Biovoltron/format/bed.hpp>
+#include <Biovoltron/format/bed/region.hpp>
+#include <Biovoltron/format/bed/writer.hpp>
+#include <algorithm>
+#include <deque>
+#include <istream>
+#include <queue>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace biovoltron::format::bed {
+
+    using Interval = Region;
+
+/// @class RecordSource
+/// @brief Intervals of the data lines of a sorted BED std::istream.
+    template<class TupleType = std::tuple <std::string, uint32_t, uint32_t> >
+    class RecordSource
+    {
+      public:
+
+        explicit RecordSource(std::istream& is)
+            : is(&is)
+        {}
+
+        bool next(Interval& iv)
+        {
+            while(std::getline(*is, line))
+            {
+                if(line.empty() || (!started && is_header_line(line)))
+                    continue;
+
+                bed.set_bed_data(line);
+                iv.chrom = std::get<Col::chrom>(bed.data);
+                iv.start = std::get<Col::chromStart>(bed.data);
+                iv.end   = std::get<Col::chromEnd>(bed.data);
+
+                if(started && (iv.chrom < last_chrom || (iv.chrom == last_chrom && iv.start < last_start)))
+                    throw std::runtime_error("bed: input is not sorted at " + line);
+                if(!started || iv.chrom != last_chrom)
+                    last_chrom = iv.chrom;
+                last_start = iv.start;
+                started = true;
+                return true;
+            }
+            return false;
+        }
+
+        /// @brief The record of the last interval returned by next().
+        const BEDRecord<TupleType>& record() const { return bed; }
+
+      private:
+
+        std::istream* is;
+        std::string line, last_chrom;
+        uint32_t last_start = 0;
+        bool started = false;
+        BEDRecord<TupleType> bed;
+    };
+
+/// @class RangeSource
+/// @brief Intervals of an iterator range of sorted records (anything holding
+///        chrom / chromStart / chromEnd in .data).
+    template<class Iterator>
+    class RangeSource
+    {
+      public:
+
+        RangeSource(Iterator first, Iterator last)
+            : cur(first), last(last)
+        {}
+
+        bool next(Interval& iv)
+        {
+            if(cur == last)
+                return false;
+            iv.chrom = std::get<Col::chrom>(cur->data);
+            iv.start = std::get<Col::chromStart>(cur->data);
+            iv.end   = std::get<Col::chromEnd>(cur->data);
+            ++cur;
+            return true;
+        }
+
+      private:
+
+        Iterator cur, last;
+    };
+
+    template<class Records>
+    auto range_source(const Records& records)
+    {
+        return RangeSource<decltype(records.begin())>(records.begin(), records.end());
+    }
+
+/// @class Merge
+/// @brief Joins intervals that overlap or are at most distance bases apart.
+    template<class Source>
+    class Merge
+    {
+      public:
+
+        Merge(Source src, uint32_t distance = 0)
+            : src(std::move(src)), distance(distance)
+        {
+            has_next = this->src.next(ahead);
+        }
+
+        bool next(Interval& iv)
+        {
+            if(!has_next)
+                return false;
+
+            iv = ahead;
+            while((has_next = src.next(ahead)))
+            {
+                if(ahead.chrom != iv.chrom || ahead.start > uint64_t(iv.end) + distance)
+                    break;
+                iv.end = std::max(iv.end, ahead.end);
+            }
+            return true;
+        }
+
+      private:
+
+        Source src;
+        uint32_t distance;
+        Interval ahead;
+        bool has_next;
+    };
+
+    namespace detail {
+
+/// @class Sweep
+/// @brief Keeps the intervals of a sorted source that may overlap an
+///        interval of another sorted stream (O(active intervals) memory).
+        template<class Source>
+        class Sweep
+        {
+          public:
+
+            explicit Sweep(Source src)
+                : src(std::move(src))
+            {
+                has_next = this->src.next(ahead);
+            }
+
+            /// @brief Advance to query iv; active() then holds, in start order,
+            ///        every interval that starts before iv.end and may reach iv.start.
+            ///        Queries must come sorted like the source.
+            const std::deque<Interval>& advance(const Interval& iv)
+            {
+                if(iv.chrom < chrom || (iv.chrom == chrom && iv.start < last_start))
+                    throw std::runtime_error("bed: queries of a sweep are not sorted at "
+                                             + iv.chrom + ":" + std::to_string(iv.start));
+                last_start = iv.start;
+                if(iv.chrom != chrom)
+                {
+                    chrom = iv.chrom;
+                    window.clear();
+                }
+                // skip chroms sorted before the query chrom
+                while(has_next && ahead.chrom < iv.chrom)
+                    has_next = src.next(ahead);
+                while(has_next && ahead.chrom == iv.chrom && ahead.start < iv.end)
+                {
+                    window.push_back(ahead);
+                    has_next = src.next(ahead);
+                }
+
+                // later queries start at or after iv.start
+                while(!window.empty() && window.front().end <= iv.start)
+                    window.pop_front();
+                if(window.size() > 64 && ++calls % 64 == 0)
+                    window.erase(std::remove_if(window.begin(), window.end(),
+                                 [&](auto& b){ return b.end <= iv.start; }), window.end());
+                return window;
+            }
+
+          private:
+
+            Source src;
+            Interval ahead;
+            bool has_next;
+            std::string chrom;
+            uint32_t last_start = 0;
+            std::deque<Interval> window;
+            std::size_t calls = 0;
+        };
+
+/// @class Pending
+/// @brief Output intervals of the A intervals read so far, handed out in
+///        start order.
+///
+/// An output interval starts at or after the start of its A interval, so
+/// the pending ones that start before the next A interval are final even
+/// when A intervals overlap.
+        class Pending
+        {
+          public:
+
+            void push(Interval iv)
+            {
+                heap.push(std::move(iv));
+            }
+
+            /// @brief Whether the first pending interval can go out before the
+            ///        A interval next (nullptr when A is exhausted) is read.
+            bool ready(const Interval* next) const
+            {
+                return !heap.empty() && (!next || next->chrom != heap.top().chrom
+                                               || heap.top().start < next->start);
+            }
+
+            Interval pop()
+            {
+                Interval iv = heap.top();
+                heap.pop();
+                return iv;
+            }
+
+          private:
+
+            struct Later
+            {
+                bool operator()(const Interval& x, const Interval& y) const
+                {
+                    return x.start != y.start ? x.start > y.start : x.end > y.end;
+                }
+            };
+
+            std::priority_queue<Interval, std::vector<Interval>, Later> heap;
+        };
+    }
+
+/// @class Intersect
+/// @brief For every interval of A, the parts overlapping each interval of B
+///        (like bedtools intersect -a A -b B).
+    template<class SourceA, class SourceB>
+    class Intersect
+    {
+      public:
+
+        Intersect(SourceA a, SourceB b)
+            : a(std::move(a)), b(std::move(b))
+        {
+            has_next = this->a.next(cur);
+        }
+
+        bool next(Interval& iv)
+        {
+            while(!out.ready(has_next ? &cur : nullptr))
+            {
+                if(!has_next)
+                    return false;
+                for(auto& x: b.advance(cur))
+                    if(x.start < cur.end && cur.start < x.end)
+                        out.push({ cur.chrom, std::max(cur.start, x.start), std::min(cur.end, x.end) });
+                has_next = a.next(cur);
+            }
+            iv = out.pop();
+            return true;
+        }
+
+      private:
+
+        SourceA a;
+        detail::Sweep<SourceB> b;
+        Interval cur;
+        bool has_next;
+        detail::Pending out;
+    };
+
+/// @class Subtract
+/// @brief The parts of every interval of A not covered by any interval of B
+///        (like bedtools subtract -a A -b B).
+    template<class SourceA, class SourceB>
+    class Subtract
+    {
+      public:
+
+        Subtract(SourceA a, SourceB b)
+            : a(std::move(a)), b(std::move(b))
+        {
+            has_next = this->a.next(cur);
+        }
+
+        bool next(Interval& iv)
+        {
+            while(!out.ready(has_next ? &cur : nullptr))
+            {
+                if(!has_next)
+                    return false;
+
+                uint32_t pos = cur.start;
+                for(auto& x: b.advance(cur))
+                {
+                    if(x.end <= pos || x.start >= cur.end)
+                        continue;
+                    if(x.start > pos)
+                        out.push({ cur.chrom, pos, x.start });
+                    pos = std::max(pos, x.end);
+                    if(pos >= cur.end)
+                        break;
+                }
+                if(pos < cur.end)
+                    out.push({ cur.chrom, pos, cur.end });
+                has_next = a.next(cur);
+            }
+            iv = out.pop();
+            return true;
+        }
+
+      private:
+
+        SourceA a;
+        detail::Sweep<SourceB> b;
+        Interval cur;
+        bool has_next;
+        detail::Pending out;
+    };
+
+/// @class Complement
+/// @brief The parts of every chromosome in chrom_sizes not covered by the
+///        source (like bedtools complement). Chromosomes are visited in byte
+///        order, the ones absent from the source come out whole.
+    template<class Source>
+    class Complement
+    {
+      public:
+
+        Complement(Source src, std::vector<std::pair<std::string, uint32_t>> chrom_sizes)
+            : src(std::move(src)), sizes(std::move(chrom_sizes))
+        {
+            std::sort(sizes.begin(), sizes.end());
+            has_next = this->src.next(ahead);
+        }
+
+        bool next(Interval& iv)
+        {
+            while(c < sizes.size())
+            {
+                auto& [chrom, size] = sizes[c];
+                if(has_next && ahead.chrom < chrom)
+                    throw std::runtime_error("bed: chrom " + ahead.chrom + " is not in the chrom sizes");
+
+                if(has_next && ahead.chrom == chrom)
+                {
+                    Interval x = ahead;
+                    has_next = src.next(ahead);
+                    // records may reach past the end of the chromosome
+                    const uint32_t gap_end = std::min(x.start, size);
+                    bool gap = pos < gap_end;
+                    if(gap)
+                        iv = { chrom, pos, gap_end };
+                    pos = std::min(std::max(pos, x.end), size);
+                    if(gap)
+                        return true;
+                    continue;
+                }
+
+                bool tail = pos < size;
+                if(tail)
+                    iv = { chrom, pos, size };
+                ++c;
+                pos = 0;
+                if(tail)
+                    return true;
+            }
+            if(has_next)
+                throw std::runtime_error("bed: chrom " + ahead.chrom + " is not in the chrom sizes");
+            return false;
+        }
+
+      private:
+
+        Source src;
+        std::vector<std::pair<std::string, uint32_t>> sizes;
+        std::size_t c = 0;
+        uint32_t pos = 0;
+        Interval ahead;
+        bool has_next;
+    };
+
+    template<class Source>
+    Merge<Source> merge(Source src, uint32_t distance = 0)
+    {
+        return Merge<Source>(std::move(src), distance);
+    }
+
+    template<class SourceA, class SourceB>
+    Intersect<SourceA, SourceB> intersect(SourceA a, SourceB b)
+    {
+        return Intersect<SourceA, SourceB>(std::move(a), std::move(b));
+    }
+
+    template<class SourceA, class SourceB>
+    Subtract<SourceA, SourceB> subtract(SourceA a, SourceB b)
+    {
+        return Subtract<SourceA, SourceB>(std::move(a), std::move(b));
+    }
+
+    template<class Source>
+    Complement<Source> complement(Source src, std::vector<std::pair<std::string, uint32_t>> chrom_sizes)
+    {
+        return Complement<Source>(std::move(src), std::move(chrom_sizes));
+    }
+
+    /// @brief Drain src, calling f(interval) for every output interval.
+    template<class Source, class Callback>
+    void for_each(Source& src, Callback&& f)
+    {
+        Interval iv;
+        while(src.next(iv))
+            f(iv);
+    }
+
+    /// @brief Drain src into os as BED3 lines.
+    template<class Source>
+    void write(Source& src, std::ostream& os)
+    {
+        BEDWriter<std::tuple<std::string, uint32_t, uint32_t>> writer(os);
+        std::tuple<std::string, uint32_t, uint32_t> data;
+        for_each(src, [&](const Interval& iv)
+        {
+            data = std::tie(iv.chrom, iv.start, iv.end);
+            writer.write(data);
+        });
+    }
+
+}
@@ -0,0 +1,391 @@
+/// @file sorter.hpp
+/// @brief External (out-of-core) sort of BED files by chrom, chromStart, chromEnd
+
+#pragma once
+#include <Biovoltron/format/bed.hpp>
+#include <Biovoltron/format/bed/chrom_dict.hpp>
+#include <Biovoltron/format/bed/parallel_parser.hpp>
+#include <Biovoltron/format/bed/tokenizer.hpp>
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <fstream>
+#include <istream>
+#include <memory>
+#include <numeric>
+#include <ostream>
+#include <queue>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+namespace biovoltron::format{
+
+    namespace bed {
+
+        /// @brief Sort key of one line: chrom rank (in byte order of the
+        ///        names), chromStart, chromEnd, and the position of the line.
+        struct SortKey
+        {
+            uint64_t chrom_start;   // rank << 32 | chromStart
+            uint32_t end;
+            uint32_t pos;
+        };
+
+        /// @brief Stable LSD radix sort of keys by (chrom_start, end), one
+        ///        byte per pass, histograms and scatter split over thread_num
+        ///        threads. Passes where every key has the same byte are skipped.
+        inline void radix_sort(std::vector<SortKey>& keys, std::size_t thread_num = 1)
+        {
+            const std::size_t n = keys.size();
+            if(n < 2)
+                return;
+
+            std::vector<SortKey> tmp(n);
+            const std::size_t parts = std::max<std::size_t>(1, std::min(thread_num, n / 65536 + 1));
+            const std::size_t step = (n + parts - 1) / parts;
+            std::vector<std::array<std::size_t, 256>> counts(parts);
+
+            // bytes 0..3 of end, then bytes 0..7 of chrom_start
+            for(int pass = 0; pass < 12; pass++)
+            {
+                auto digit = [pass](const SortKey& k) -> unsigned
+                {
+                    return pass < 4 ? (k.end >> (8 * pass)) & 0xff
+                                    : (k.chrom_start >> (8 * (pass - 4))) & 0xff;
+                };
+
+                parallel_for(parts, parts, [&](std::size_t p)
+                {
+                    counts[p].fill(0);
+                    for(std::size_t i = p * step; i < std::min(n, (p + 1) * step); i++)
+                        counts[p][digit(keys[i])]++;
+                });
+
+                std::size_t same = 0;
+                for(std::size_t p = 0; p < parts; p++)
+                    same += counts[p][digit(keys[0])];
+                if(same == n)
+                    continue;
+
+                // exclusive prefix sums, digit major then part, keep it stable
+                std::size_t sum = 0;
+                for(unsigned d = 0; d < 256; d++)
+                    for(std::size_t p = 0; p < parts; p++)
+                    {
+                        std::size_t c = counts[p][d];
+                        counts[p][d] = sum;
+                        sum += c;
+                    }
+
+                parallel_for(parts, parts, [&](std::size_t p)
+                {
+                    auto& offset = counts[p];
+                    for(std::size_t i = p * step; i < std::min(n, (p + 1) * step); i++)
+                        tmp[offset[digit(keys[i])]++] = keys[i];
+                });
+                keys.swap(tmp);
+            }
+        }
+
+        /// @brief chrom, chromStart and chromEnd fields of a data line.
+        inline void parse_key(std::string_view line, std::string_view& chrom, uint32_t& start, uint32_t& end)
+        {
+            std::array<std::string_view, 3> fields;
+            split_fields(line, fields);
+            chrom = fields[0];
+            start = to_integral<uint32_t>(fields[1]);
+            end   = to_integral<uint32_t>(fields[2]);
+        }
+    }
+
+/// @class BEDSorter
+/// @brief Sorts BED text by chrom (byte order, like LC_ALL=C sort -k1,1),
+///        then chromStart and chromEnd numerically, within a memory budget.
+///
+/// Lines are collected into runs of at most memory_budget bytes. Every run
+/// is sorted by a parallel radix sort on (chrom rank, chromStart, chromEnd)
+/// keys parsed once per line, and spilled to a temporary file when more
+/// input follows. The runs are then k-way merged into the output. Leading
+/// header lines are written first, unchanged. The sort is stable.
+///
+///     BEDSorter<TupleType> sorter({ 4ul << 30, 16, "/scratch" });
+///     sorter.sort("in.bed", "out.bed");
+    template<class TupleType = std::tuple <std::string, uint32_t, uint32_t> >
+    class BEDSorter
+    {
+      public:
+
+        struct Options
+        {
+            std::size_t memory_budget = std::size_t(1) << 30;
+            std::size_t thread_num = bed::default_thread_num();
+            std::string temp_dir = "/tmp";
+        };
+
+        BEDSorter() = default;
+
+        explicit BEDSorter(Options options)
+            : options(std::move(options))
+        {}
+
+        void sort(const std::string& in_path, const std::string& out_path) const
+        {
+            std::ifstream ifs(in_path);
+            if(!ifs)
+                throw std::runtime_error("bed: cannot open " + in_path);
+            std::ofstream ofs(out_path);
+            if(!ofs)
+                throw std::runtime_error("bed: cannot write " + out_path);
+            sort(ifs, ofs);
+        }
+
+        void sort(std::istream& is, std::ostream& os) const
+        {
+            std::string line;
+            bool pending = false;
+            while(std::getline(is, line))
+            {
+                if(!bed::is_header_line(line))
+                {
+                    pending = true;
+                    break;
+                }
+                os << line << '\n';
+            }
+
+            std::vector<std::string> runs;
+            Run run;
+            try
+            {
+                while(pending)
+                {
+                    if(!line.empty())
+                        run.add(line);
+                    pending = static_cast<bool>(std::getline(is, line));
+
+                    if(run.bytes() >= options.memory_budget && pending)
+                    {
+                        runs.push_back(spill(run));
+                        run.clear();
+                    }
+                }
+
+                if(runs.empty())
+                {
+                    run.sort(options.thread_num);
+                    run.write(os);
+                }
+                else
+                {
+                    if(run.size() != 0)
+                        runs.push_back(spill(run));
+                    run.clear();
+                    merge(runs, os);
+                }
+            }
+            catch(...)
+            {
+                remove_runs(runs);
+                throw;
+            }
+            remove_runs(runs);
+        }
+
+        /// @brief Sort records in memory with the same order.
+        void sort(std::vector<BEDRecord<TupleType>>& records) const
+        {
+            std::vector<bed::SortKey> keys(records.size());
+            bed::ChromDict dict;
+            std::vector<uint32_t> ids(records.size());
+
+            for(std::size_t i = 0; i < records.size(); i++)
+                ids[i] = dict.intern(std::get<bed::Col::chrom>(records[i].data));
+            auto rank = chrom_ranks(dict);
+            for(std::size_t i = 0; i < records.size(); i++)
+                keys[i] = { uint64_t(rank[ids[i]]) << 32 | std::get<bed::Col::chromStart>(records[i].data),
+                            static_cast<uint32_t>(std::get<bed::Col::chromEnd>(records[i].data)),
+                            static_cast<uint32_t>(i) };
+
+            bed::radix_sort(keys, options.thread_num);
+
+            std::vector<BEDRecord<TupleType>> sorted;
+            sorted.reserve(records.size());
+            for(auto& k: keys)
+                sorted.push_back(std::move(records[k.pos]));
+            records.swap(sorted);
+        }
+
+      private:
+
+        /// @brief Rank of every chrom ID in byte order of the names.
+        static std::vector<uint32_t> chrom_ranks(const bed::ChromDict& dict)
+        {
+            std::vector<uint32_t> ids(dict.size()), rank(dict.size());
+            std::iota(ids.begin(), ids.end(), 0);
+            std::sort(ids.begin(), ids.end(), [&](auto a, auto b){ return dict.name(a) < dict.name(b); });
+            for(uint32_t r = 0; r < ids.size(); r++)
+                rank[ids[r]] = r;
+            return rank;
+        }
+
+        /// @brief Lines of one run, stored back to back in a single buffer.
+        class Run
+        {
+          public:
+
+            void add(const std::string& line)
+            {
+                std::string_view chrom;
+                uint32_t start, end;
+                bed::parse_key(line, chrom, start, end);
+
+                keys.push_back({ uint64_t(dict.intern(chrom)) << 32 | start, end,
+                                 static_cast<uint32_t>(offsets.size()) });
+                offsets.push_back(text.size());
+                text += line;
+                text += '\n';
+            }
+
+            std::size_t size() const { return keys.size(); }
+
+            std::size_t bytes() const
+            {
+                return text.size() + keys.size() * (sizeof(bed::SortKey) * 2 + sizeof(std::size_t));
+            }
+
+            void sort(std::size_t thread_num)
+            {
+                auto rank = chrom_ranks(dict);
+                for(auto& k: keys)
+                    k.chrom_start = uint64_t(rank[k.chrom_start >> 32]) << 32 | (k.chrom_start & 0xffffffff);
+                bed::radix_sort(keys, thread_num);
+            }
+
+            void write(std::ostream& os) const
+            {
+                std::string buffer;
+                for(auto& k: keys)
+                {
+                    std::size_t begin = offsets[k.pos];
+                    std::size_t end = k.pos + 1 < offsets.size() ? offsets[k.pos + 1] : text.size();
+                    buffer.append(text, begin, end - begin);
+                    if(buffer.size() >= (1 << 22))
+                    {
+                        os.write(buffer.data(), buffer.size());
+                        buffer.clear();
+                    }
+                }
+                os.write(buffer.data(), buffer.size());
+            }
+
+            void clear()
+            {
+                text.clear();
+                offsets.clear();
+                keys.clear();
+                dict.clear();
+            }
+
+          private:
+
+            std::string text;
+            std::vector<std::size_t> offsets;
+            std::vector<bed::SortKey> keys;
+            bed::ChromDict dict;
+        };
+
+        std::string spill(Run& run) const
+        {
+            std::string path = options.temp_dir + "/bed_sort_XXXXXX";
+            int fd = ::mkstemp(&path[0]);
+            if(fd < 0)
+                throw std::runtime_error("bed: cannot create a temporary file in " + options.temp_dir);
+            ::close(fd);
+
+            // the caller only cleans up the runs it got back
+            try
+            {
+                run.sort(options.thread_num);
+                std::ofstream ofs(path, std::ios::binary);
+                run.write(ofs);
+                if(!ofs)
+                    throw std::runtime_error("bed: cannot write " + path);
+            }
+            catch(...)
+            {
+                std::remove(path.c_str());
+                throw;
+            }
+            return path;
+        }
+
+        struct Head
+        {
+            std::string line;
+            std::string_view chrom;
+            uint32_t start, end;
+            std::size_t run;
+
+            bool operator>(const Head& other) const
+            {
+                if(int c = chrom.compare(other.chrom); c != 0)
+                    return c > 0;
+                if(start != other.start)
+                    return start > other.start;
+                if(end != other.end)
+                    return end > other.end;
+                return run > other.run;   // keep the input order of equal keys
+            }
+        };
+
+        void merge(const std::vector<std::string>& runs, std::ostream& os) const
+        {
+            std::vector<std::unique_ptr<std::ifstream>> inputs;
+            auto cmp = [](const Head* a, const Head* b){ return *a > *b; };
+            std::priority_queue<Head*, std::vector<Head*>, decltype(cmp)> heap(cmp);
+            std::vector<Head> heads(runs.size());
+
+            auto advance = [&](std::size_t r)
+            {
+                if(!std::getline(*inputs[r], heads[r].line))
+                    return;
+                bed::parse_key(heads[r].line, heads[r].chrom, heads[r].start, heads[r].end);
+                heads[r].run = r;
+                heap.push(&heads[r]);
+            };
+
+            for(std::size_t r = 0; r < runs.size(); r++)
+            {
+                inputs.emplace_back(std::make_unique<std::ifstream>(runs[r]));
+                advance(r);
+            }
+
+            std::string buffer;
+            while(!heap.empty())
+            {
+                Head* h = heap.top();
+                heap.pop();
+                buffer += h->line;
+                buffer += '\n';
+                if(buffer.size() >= (1 << 22))
+                {
+                    os.write(buffer.data(), buffer.size());
+                    buffer.clear();
+                }
+                advance(h->run);
+            }
+            os.write(buffer.data(), buffer.size());
+        }
+
+        static void remove_runs(const std::vector<std::string>& runs)
+        {
+            for(auto& path: runs)
+                std::remove(path.c_str());
+        }
+
+        Options options;
+    };
+
+}
@@ -0,0 +1,208 @@
+/// @file stats.hpp
+/// @brief Optional instrumentation of the reader and writer hot paths
+///
+/// Build with -DBED_ENABLE_STATS=1 to collect counters and stage timings in
+/// bed::stats(); without it every hook compiles to nothing.
+///
+///     bed::stats().reset();
+///     auto file = BEDFile<TupleType>::load(path);
+///     std::cerr << bed::stats().to_json() << '\n';
+
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+#ifndef BED_ENABLE_STATS
+#define BED_ENABLE_STATS 0
+#endif
+
+namespace biovoltron::format::bed {
+
+    inline constexpr bool stats_enabled = BED_ENABLE_STATS;
+
+    enum class Stage
+    {
+        read,       ///< getting lines from the input stream
+        tokenize,   ///< splitting lines into fields
+        convert,    ///< converting fields to column values (fill)
+        format,     ///< formatting column values to text
+        write       ///< handing formatted text to the output stream
+    };
+
+    inline constexpr std::size_t stage_num = 5;
+    inline constexpr std::size_t max_columns = 16;
+
+/// @class ParseStats
+/// @brief Counters shared by all threads; updates are relaxed atomics.
+    class ParseStats
+    {
+      public:
+
+        uint64_t bytes_read() const { return load(bytes_read_); }
+        uint64_t lines_read() const { return load(lines_read_); }
+        uint64_t bytes_formatted() const { return load(bytes_formatted_); }
+        uint64_t lines_formatted() const { return load(lines_formatted_); }
+        uint64_t bytes_written() const { return load(bytes_written_); }
+
+        /// @brief Times a string or list column had to grow its heap storage.
+        uint64_t allocations() const { return load(allocations_); }
+
+        uint64_t stage_ns(Stage s) const { return load(stage_ns_[std::size_t(s)]); }
+        uint64_t stage_calls(Stage s) const { return load(stage_calls_[std::size_t(s)]); }
+
+        /// @brief Fields of column col that failed to convert.
+        uint64_t column_errors(std::size_t col) const { return col < max_columns ? load(column_errors_[col]) : 0; }
+
+        void add_read(uint64_t bytes, uint64_t lines = 1) { add(bytes_read_, bytes); add(lines_read_, lines); }
+        void add_formatted(uint64_t bytes, uint64_t lines = 1) { add(bytes_formatted_, bytes); add(lines_formatted_, lines); }
+        void add_written(uint64_t bytes) { add(bytes_written_, bytes); }
+        void add_allocation() { add(allocations_, 1); }
+
+        void add_time(Stage s, uint64_t ns)
+        {
+            add(stage_ns_[std::size_t(s)], ns);
+            add(stage_calls_[std::size_t(s)], 1);
+        }
+
+        void add_column_error(std::size_t col)
+        {
+            if(col < max_columns)
+                add(column_errors_[col], 1);
+        }
+
+        void reset()
+        {
+            for(auto* c: { &bytes_read_, &lines_read_, &bytes_formatted_, &lines_formatted_, &bytes_written_, &allocations_ })
+                c->store(0, std::memory_order_relaxed);
+            for(auto& c: stage_ns_)
+                c.store(0, std::memory_order_relaxed);
+            for(auto& c: stage_calls_)
+                c.store(0, std::memory_order_relaxed);
+            for(auto& c: column_errors_)
+                c.store(0, std::memory_order_relaxed);
+        }
+
+        std::string to_json() const
+        {
+            static const char* stage_names[stage_num] = { "read", "tokenize", "convert", "format", "write" };
+
+            std::string json = "{\"enabled\":";
+            json += stats_enabled ? "true" : "false";
+            auto field = [&](const char* name, uint64_t v)
+            {
+                json += ",\"";
+                json += name;
+                json += "\":";
+                json += std::to_string(v);
+            };
+            field("bytes_read", bytes_read());
+            field("lines_read", lines_read());
+            field("bytes_formatted", bytes_formatted());
+            field("lines_formatted", lines_formatted());
+            field("bytes_written", bytes_written());
+            field("allocations", allocations());
+
+            json += ",\"stages\":{";
+            for(std::size_t s = 0; s < stage_num; s++)
+            {
+                if(s)
+                    json += ',';
+                json += '"';
+                json += stage_names[s];
+                json += "\":{\"ns\":" + std::to_string(stage_ns(Stage(s)))
+                      + ",\"calls\":" + std::to_string(stage_calls(Stage(s))) + '}';
+            }
+            json += "},\"column_errors\":[";
+            for(std::size_t c = 0; c < max_columns; c++)
+            {
+                if(c)
+                    json += ',';
+                json += std::to_string(column_errors(c));
+            }
+            json += "]}";
+            return json;
+        }
+
+      private:
+
+        using counter = std::atomic<uint64_t>;
+
+        static uint64_t load(const counter& c) { return c.load(std::memory_order_relaxed); }
+        static void add(counter& c, uint64_t v) { c.fetch_add(v, std::memory_order_relaxed); }
+
+        counter bytes_read_{0}, lines_read_{0}, bytes_formatted_{0}, lines_formatted_{0}, bytes_written_{0};
+        counter allocations_{0};
+        std::array<counter, stage_num> stage_ns_{}, stage_calls_{};
+        std::array<counter, max_columns> column_errors_{};
+    };
+
+    /// @brief The process wide statistics.
+    inline ParseStats& stats()
+    {
+        static ParseStats s;
+        return s;
+    }
+
+/// @class StageTimer
+/// @brief Adds the time until its destruction to a stage; empty when
+///        stats are disabled.
+    class StageTimer
+    {
+      public:
+
+        explicit StageTimer(Stage stage)
+            : stage(stage)
+        {
+            if constexpr(stats_enabled)
+                start = std::chrono::steady_clock::now();
+        }
+
+        StageTimer(const StageTimer&) = delete;
+        StageTimer& operator=(const StageTimer&) = delete;
+
+        ~StageTimer()
+        {
+            if constexpr(stats_enabled)
+                stats().add_time(stage, std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                            std::chrono::steady_clock::now() - start).count());
+        }
+
+      private:
+
+        Stage stage;
+        std::chrono::steady_clock::time_point start;
+    };
+
+    /// @brief Run f, counting an exception it throws against column col.
+    template<class F>
+    void convert_column(std::size_t col, F&& f)
+    {
+        if constexpr(stats_enabled)
+        {
+            try
+            {
+                f();
+            }
+            catch(...)
+            {
+                stats().add_column_error(col);
+                throw;
+            }
+        }
+        else
+            f();
+    }
+
+    /// @brief Count a heap allocation when the capacity of a column changed.
+    template<class Container>
+    void count_growth(const Container& c, std::size_t old_capacity)
+    {
+        if constexpr(stats_enabled)
+            if(c.capacity() != old_capacity)
+                stats().add_allocation();
+    }
+
+}
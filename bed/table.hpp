@@ -0,0 +1,180 @@
+/// @file table.hpp
+/// @brief Columnar (struct of arrays) container of BED records
+
+#pragma once
+#include <Biovoltron/format/bed.hpp>
+#include <Biovoltron/format/bed/chrom_dict.hpp>
+#include <Biovoltron/format/bed/mmap_reader.hpp>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace biovoltron::format{
+
+    namespace bed {
+
+        /// @brief Storage type of column I: the chrom column is kept as a
+        ///        ChromDict ID, every other column as its own type.
+        template<class T, std::size_t I>
+        struct ColumnStorage
+        {
+            using type = T;
+        };
+
+        template<>
+        struct ColumnStorage<std::string, Col::chrom>
+        {
+            using type = ChromDict::id_type;
+        };
+
+        template<class TupleType, class Seq>
+        struct ColumnsOf;
+
+        template<class TupleType, std::size_t... Is>
+        struct ColumnsOf<TupleType, std::index_sequence<Is...>>
+        {
+            using type = std::tuple< std::vector<
+                            typename ColumnStorage<std::tuple_element_t<Is, TupleType>, Is>::type
+                         >... >;
+        };
+    }
+
+/// @class BEDTable
+/// @brief Struct of arrays table of BED records sharing one BEDHeader.
+///
+/// Every column of TupleType is stored in its own contiguous std::vector,
+/// so a scan over chromStart / chromEnd only touches those arrays:
+///
+///     auto& starts = table.column<bed::Col::chromStart>();
+///     auto& ends   = table.column<bed::Col::chromEnd>();
+///
+/// A std::string chrom column is dictionary encoded: column<bed::Col::chrom>()
+/// holds IDs into chrom_dict(). Rows convert back to BEDRecord<TupleType> with get().
+    template<class TupleType = std::tuple <std::string, uint32_t, uint32_t> >
+    class BEDTable
+    {
+      public:
+
+        static_assert( IsTupleType<TupleType>::value, "ARGUMENT IS NOT A TUPLE");
+
+        static constexpr std::size_t col_num = std::tuple_size<TupleType>::value;
+
+        using columns_type = typename bed::ColumnsOf<TupleType, std::make_index_sequence<col_num>>::type;
+
+        template<std::size_t i>
+        using column_t = std::tuple_element_t<i, columns_type>;
+
+        static constexpr bool chrom_encoded =
+            std::is_same<std::string, std::tuple_element_t<bed::Col::chrom, TupleType>>::value;
+
+        template<std::size_t i>
+        column_t<i>& column() { return std::get<i>(columns); }
+
+        template<std::size_t i>
+        const column_t<i>& column() const { return std::get<i>(columns); }
+
+        std::size_t size() const { return std::get<0>(columns).size(); }
+        bool empty() const { return size() == 0; }
+
+        void reserve(std::size_t n)
+        {
+            std::apply([n](auto&... col){ (col.reserve(n), ...); }, columns);
+        }
+
+        void clear()
+        {
+            std::apply([](auto&... col){ (col.clear(), ...); }, columns);
+            dict.clear();
+        }
+
+        const bed::ChromDict& chrom_dict() const { return dict; }
+
+        /// @brief The chrom name of row i.
+        std::string_view chrom(std::size_t i) const
+        {
+            if constexpr( chrom_encoded )
+                return dict.name(column<bed::Col::chrom>()[i]);
+            else
+                return column<bed::Col::chrom>()[i];
+        }
+
+        void push_back(const TupleType& data)
+        {
+            push_back_impl(data, std::make_index_sequence<col_num>());
+        }
+
+        void push_back(const BEDRecord<TupleType>& bed)
+        {
+            push_back(bed.data);
+        }
+
+        void push_back(const BEDRecordView<TupleType>& view)
+        {
+            view.to_bed(scratch);
+            push_back(scratch.data);
+        }
+
+        /// @brief Materialize row i as a record.
+        void get(std::size_t i, BEDRecord<TupleType>& bed) const
+        {
+            get_impl(i, bed.data, std::make_index_sequence<col_num>());
+        }
+
+        BEDRecord<TupleType> get(std::size_t i) const
+        {
+            BEDRecord<TupleType> bed;
+            get(i, bed);
+            return bed;
+        }
+
+        /// @brief Load every data line of a BED file, keeping its track line in header.
+        static BEDTable load(const std::string& path)
+        {
+            BEDTable table;
+            BEDMmapReader<TupleType> reader(path);
+            table.header = reader.header();
+            for(auto& view: reader)
+                table.push_back(view);
+            return table;
+        }
+
+        BEDHeader header;
+
+      private:
+
+        template<std::size_t... Is>
+        void push_back_impl(const TupleType& data, std::index_sequence<Is...>)
+        {
+            (push_column<Is>(std::get<Is>(data)), ...);
+        }
+
+        template<std::size_t i, class T>
+        void push_column(const T& value)
+        {
+            if constexpr( i == bed::Col::chrom && chrom_encoded )
+                std::get<i>(columns).push_back(dict.intern(value));
+            else
+                std::get<i>(columns).push_back(value);
+        }
+
+        template<std::size_t... Is>
+        void get_impl(std::size_t row, TupleType& data, std::index_sequence<Is...>) const
+        {
+            ((std::get<Is>(data) = get_column<Is>(row)), ...);
+        }
+
+        template<std::size_t i>
+        decltype(auto) get_column(std::size_t row) const
+        {
+            if constexpr( i == bed::Col::chrom && chrom_encoded )
+                return dict.name(std::get<i>(columns)[row]);
+            else
+                return std::get<i>(columns)[row];
+        }
+
+        columns_type columns;
+        bed::ChromDict dict;
+        BEDRecord<TupleType> scratch;
+    };
+
+}
@@ -0,0 +1,219 @@
+/// @file tail_reader.hpp
+/// @brief Incremental reading of a BED file that keeps growing
+
+#pragma once
+#include <Biovoltron/format/bed.hpp>
+#include <Biovoltron/format/bed/interval_index.hpp>
+#include <Biovoltron/format/bed/mmap_reader.hpp>
+#include <Biovoltron/format/bed/table.hpp>
+#include <Biovoltron/format/bed/tokenizer.hpp>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace biovoltron::format{
+
+    namespace bed {
+
+        /// @brief How far a BEDTailReader got in its file.
+        ///
+        /// Saved as a small text file, replaced atomically (written next to
+        /// it, then renamed), so a crash leaves the previous checkpoint.
+        struct Checkpoint
+        {
+            /// @brief Bytes consumed: the end of the last complete line read.
+            uint64_t offset = 0;
+            /// @brief Data lines delivered so far, the line number of the next one.
+            uint64_t lines = 0;
+            /// @brief Track line of the file, so header() survives a restart.
+            std::string track_line;
+
+            void save(const std::string& path) const
+            {
+                const std::string tmp = path + ".tmp";
+                {
+                    std::ofstream ofs(tmp, std::ios::trunc);
+                    if(!ofs)
+                        throw std::runtime_error("bed: cannot write " + tmp);
+                    ofs << "offset\t" << offset << "\nlines\t" << lines << "\ntrack\t" << track_line << "\n";
+                    if(!ofs.flush())
+                        throw std::runtime_error("bed: error while writing " + tmp);
+                }
+                if(std::rename(tmp.c_str(), path.c_str()) != 0)
+                    throw std::runtime_error("bed: cannot replace " + path);
+            }
+
+            static Checkpoint load(const std::string& path)
+            {
+                std::ifstream ifs(path);
+                if(!ifs)
+                    throw std::runtime_error("bed: cannot open " + path);
+
+                Checkpoint cp;
+                std::string line;
+                bool has_offset = false, has_lines = false;
+                while(std::getline(ifs, line))
+                {
+                    auto tab = line.find('\t');
+                    std::string_view key(line.data(), std::min(tab, line.size()));
+                    std::string_view value = tab == std::string::npos ? std::string_view()
+                                                                      : std::string_view(line).substr(tab + 1);
+                    if(key == "offset")
+                        cp.offset = to_integral<uint64_t>(value), has_offset = true;
+                    else if(key == "lines")
+                        cp.lines = to_integral<uint64_t>(value), has_lines = true;
+                    else if(key == "track")
+                        cp.track_line = std::string(value);
+                }
+                if(!has_offset || !has_lines)
+                    throw std::runtime_error("bed: not a checkpoint file " + path);
+                return cp;
+            }
+        };
+    }
+
+/// @class BEDTailReader
+/// @brief Follows a BED file that is being appended to.
+///
+///     BEDTailReader<TupleType> reader(path, bed::Checkpoint::load(cp_path));
+///     BEDIntervalIndex index;
+///     while(running)
+///     {
+///         reader.poll(index);                  // adds the new lines, id = line number
+///         reader.checkpoint().save(cp_path);
+///         ...
+///     }
+///
+/// Every poll() reads from the checkpoint offset to the current end of the
+/// file and hands out the complete lines only; a trailing line without its
+/// '\n' (still being written) is left for the next poll(). Header lines
+/// before the first data line set header(). A file shorter than the
+/// checkpoint (truncated or replaced) throws std::runtime_error.
+    template<class TupleType = std::tuple <std::string, uint32_t, uint32_t> >
+    class BEDTailReader
+    {
+      public:
+
+        explicit BEDTailReader(const std::string& path, bed::Checkpoint checkpoint = bed::Checkpoint(),
+                               std::size_t read_size = 1 << 20)
+            : path(path), cp(std::move(checkpoint)), read_size(std::max<std::size_t>(read_size, 1))
+        {
+            fd = ::open(path.c_str(), O_RDONLY);
+            if(fd < 0)
+                throw std::runtime_error("bed: cannot open " + path);
+            if(!cp.track_line.empty())
+                header_.set(cp.track_line);
+        }
+
+        BEDTailReader(const BEDTailReader&) = delete;
+        BEDTailReader& operator=(const BEDTailReader&) = delete;
+
+        ~BEDTailReader()
+        {
+            ::close(fd);
+        }
+
+        const bed::Checkpoint& checkpoint() const { return cp; }
+        const BEDHeader& header() const { return header_; }
+
+        /// @brief Call f(record, line) for every complete line appended since
+        ///        the last poll, line being its data line number from 0.
+        /// @return number of records delivered
+        template<class Callback>
+        std::size_t poll(Callback&& f)
+        {
+            struct stat st;
+            if(::fstat(fd, &st) != 0)
+                throw std::runtime_error("bed: cannot stat " + path);
+            const uint64_t size = st.st_size;
+            if(size < cp.offset)
+                throw std::runtime_error("bed: " + path + " is shorter than its checkpoint");
+
+            std::size_t count = 0;
+            uint64_t pos = cp.offset;
+            buf.clear();
+            while(pos < size)
+            {
+                // buf holds the bytes from cp.offset that are not consumed yet
+                const std::size_t old_size = buf.size();
+                const std::size_t n = std::min<uint64_t>(read_size, size - pos);
+                buf.resize(old_size + n);
+                const auto got = ::pread(fd, &buf[old_size], n, pos);
+                if(got <= 0)
+                    throw std::runtime_error("bed: cannot read " + path);
+                buf.resize(old_size + got);
+                pos += got;
+
+                const char* cur  = buf.data();
+                const char* last = buf.data() + buf.size();
+                while(const char* nl = static_cast<const char*>(std::memchr(cur, '\n', last - cur)))
+                {
+                    const char* line_begin = cur;
+                    std::string_view line = BEDMmapReader<TupleType>::next_line(cur, nl + 1);
+                    if(!line.empty())
+                        count += take(line, f);
+                    cp.offset += cur - line_begin;
+                }
+                buf.erase(0, cur - buf.data());
+            }
+            return count;
+        }
+
+        /// @brief Add the new records to index (id = line number) and build it;
+        ///        build() merges them into what is already indexed.
+        std::size_t poll(BEDIntervalIndex& index)
+        {
+            auto count = poll([&](const BEDRecord<TupleType>& bed, uint64_t line)
+            {
+                index.add(std::get<bed::Col::chrom>(bed.data),
+                          std::get<bed::Col::chromStart>(bed.data),
+                          std::get<bed::Col::chromEnd>(bed.data), line);
+            });
+            if(count > 0)
+                index.build();
+            return count;
+        }
+
+        /// @brief Append the new records to table; its rows are the line
+        ///        numbers when the table follows the file from its start.
+        std::size_t poll(BEDTable<TupleType>& table)
+        {
+            return poll([&](const BEDRecord<TupleType>& bed, uint64_t){ table.push_back(bed); });
+        }
+
+      private:
+
+        template<class Callback>
+        std::size_t take(std::string_view line, Callback& f)
+        {
+            if(bed::is_header_line(line))
+            {
+                if(cp.lines == 0 && line.substr(0, 5) == "track")
+                {
+                    cp.track_line = std::string(line);
+                    header_.set(cp.track_line);
+                }
+                return 0;
+            }
+            record.set_bed_data(line);
+            f(static_cast<const BEDRecord<TupleType>&>(record), cp.lines++);
+            return 1;
+        }
+
+        std::string path;
+        bed::Checkpoint cp;
+        std::size_t read_size;
+        int fd = -1;
+        std::string buf;
+        BEDRecord<TupleType> record;
+        BEDHeader header_;
+    };
+
+}
@@ -0,0 +1,274 @@
+/// @file tokenizer.hpp
+/// @brief Field tokenizer and numeric conversion shared by the BED parsers
+///
+/// Delimiters are searched 32 (AVX2) or 16 (SSE2) bytes at a time when the
+/// target supports it, with a scalar fallback. Integers are converted with a
+/// SWAR eight digits at a time path and std::from_chars for the rest.
+/// Nothing here allocates.
+
+#pragma once
+#include <string_view>
+#include <charconv>
+#include <stdexcept>
+#include <type_traits>
+#include <limits>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace biovoltron::format::bed {
+
+    namespace detail {
+
+        inline bool is_blank(char c)
+        {
+            return c == ' ' || c == '\t';
+        }
+
+        /// @brief First ' ' or '\t' in [p, last), or last.
+        inline const char* find_blank(const char* p, const char* last)
+        {
+#if defined(__AVX2__)
+            const __m256i space = _mm256_set1_epi8(' ');
+            const __m256i tab   = _mm256_set1_epi8('\t');
+            for(; last - p >= 32; p += 32)
+            {
+                __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+                uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(
+                                    _mm256_or_si256(_mm256_cmpeq_epi8(chunk, space),
+                                                    _mm256_cmpeq_epi8(chunk, tab))));
+                if(mask != 0)
+                    return p + __builtin_ctz(mask);
+            }
+#endif
+#if defined(__SSE2__)
+            const __m128i space16 = _mm_set1_epi8(' ');
+            const __m128i tab16   = _mm_set1_epi8('\t');
+            for(; last - p >= 16; p += 16)
+            {
+                __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+                uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(
+                                    _mm_or_si128(_mm_cmpeq_epi8(chunk, space16),
+                                                 _mm_cmpeq_epi8(chunk, tab16))));
+                if(mask != 0)
+                    return p + __builtin_ctz(mask);
+            }
+#endif
+            for(; p != last; ++p)
+                if(is_blank(*p))
+                    return p;
+            return last;
+        }
+
+        inline const char* find_comma(const char* p, const char* last)
+        {
+            const void* c = std::memchr(p, ',', last - p);
+            return c ? static_cast<const char*>(c) : last;
+        }
+
+        /// @brief Split on runs of delimiters, keeping the boost::split
+        ///        token_compress_on semantic (leading / trailing runs give
+        ///        an empty field).
+        template<class FIELDS, class FindDelim, class IsDelim>
+        std::size_t split(std::string_view str, FIELDS& fields, FindDelim find_delim, IsDelim is_delim)
+        {
+            std::size_t n = 0;
+            const std::size_t cap = fields.size();
+            const char* p    = str.data();
+            const char* last = str.data() + str.size();
+
+            while(n < cap)
+            {
+                const char* delim = find_delim(p, last);
+                fields[n++] = std::string_view(p, delim - p);
+                if(delim == last)
+                    break;
+
+                p = delim + 1;
+                while(p != last && is_delim(*p))
+                    ++p;
+                if(p == last)
+                {
+                    if(n < cap)
+                        fields[n++] = std::string_view();
+                    break;
+                }
+            }
+            return n;
+        }
+
+        /// @brief Whether the 8 bytes of v are all ASCII digits.
+        inline bool is_eight_digits(uint64_t v)
+        {
+            return (((v & 0xF0F0F0F0F0F0F0F0ULL) |
+                    (((v + 0x0606060606060606ULL) & 0xF0F0F0F0F0F0F0F0ULL) >> 4)) ==
+                    0x3333333333333333ULL);
+        }
+
+        /// @brief Value of the 8 ASCII digits in v (first digit in the lowest byte).
+        inline uint32_t parse_eight_digits(uint64_t v)
+        {
+            const uint64_t mask = 0x000000FF000000FFULL;
+            const uint64_t mul1 = 0x000F424000000064ULL;  // 100 + (1000000 << 32)
+            const uint64_t mul2 = 0x0000271000000001ULL;  // 1 + (10000 << 32)
+            v -= 0x3030303030303030ULL;
+            v = (v * 10) + (v >> 8);
+            v = (((v & mask) * mul1) + (((v >> 16) & mask) * mul2)) >> 32;
+            return static_cast<uint32_t>(v);
+        }
+
+        /// @brief Parse the unsigned decimal number at p, moving p past it.
+        /// @return false when there is no digit or the value overflows T
+        template<class T>
+        bool parse_digits(const char*& p, const char* last, T& value)
+        {
+            const char* first = p;
+            uint64_t v = 0;
+            constexpr int max_digits = std::numeric_limits<uint64_t>::digits10;
+
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+            while(last - p >= 8 && p - first + 8 <= max_digits)
+            {
+                uint64_t chunk;
+                std::memcpy(&chunk, p, 8);
+                if(!is_eight_digits(chunk))
+                    break;
+                v = v * 100000000ULL + parse_eight_digits(chunk);
+                p += 8;
+            }
+#endif
+            for(; p != last && static_cast<unsigned char>(*p - '0') < 10 && p - first < max_digits; ++p)
+                v = v * 10 + static_cast<uint64_t>(*p - '0');
+
+            if(p == first)
+                return false;
+            if(p != last && static_cast<unsigned char>(*p - '0') < 10)
+            {
+                // longer than uint64_t can hold exactly, leave it to from_chars
+                p = first;
+                auto [ptr, ec] = std::from_chars(first, last, value);
+                p = ptr;
+                return ec == std::errc();
+            }
+            if(v > static_cast<uint64_t>(std::numeric_limits<T>::max()))
+                return false;
+
+            value = static_cast<T>(v);
+            return true;
+        }
+
+        /// @brief Parse an optionally signed decimal number at p, moving p past it.
+        ///
+        /// A negative number stored into an unsigned T wraps like the
+        /// int to unsigned conversion of the former stoi based parser.
+        template<class T>
+        bool parse_number(const char*& p, const char* last, T& value)
+        {
+            if(p != last && *p == '+')
+                ++p;
+
+            if(p != last && *p == '-')
+            {
+                long long v = 0;
+                auto [ptr, ec] = std::from_chars(p, last, v);
+                if(ec != std::errc())
+                    return false;
+                p = ptr;
+                value = static_cast<T>(v);
+                return true;
+            }
+
+            using U = std::make_unsigned_t<T>;
+            U u = 0;
+            if(!parse_digits(p, last, u))
+                return false;
+            if(u > static_cast<U>(std::numeric_limits<T>::max()))
+                return false;
+            value = static_cast<T>(u);
+            return true;
+        }
+    }
+
+    /// @brief Split a line into fields on runs of ' ' and '\t'.
+    ///
+    /// Same semantic as boost::split( ..., boost::is_any_of( " \t" ), boost::token_compress_on ),
+    /// but the fields are std::string_view into str and nothing is allocated.
+    /// At most fields.size() fields are stored, the rest of the line is not scanned.
+    /// @return number of fields stored
+    template<class FIELDS>
+    std::size_t split_fields(std::string_view str, FIELDS& fields)
+    {
+        return detail::split(str, fields, detail::find_blank, detail::is_blank);
+    }
+
+    /// @brief Split a comma separated list, same semantic as split_fields.
+    template<class FIELDS>
+    std::size_t split_list(std::string_view str, FIELDS& fields)
+    {
+        return detail::split(str, fields, detail::find_comma, [](char c){ return c == ','; });
+    }
+
+    /// @brief Convert a field to an integral type.
+    ///
+    /// Like std::stoi the conversion stops at the first non digit character
+    /// (e.g. "255,0,0" gives 255). std::invalid_argument is thrown when
+    /// the field does not start with a number, std::out_of_range when the
+    /// number does not fit in T.
+    template<class T>
+    T to_integral(std::string_view field)
+    {
+        static_assert( std::is_integral<T>::value, "ARGUMENT IS NOT AN INTEGRAL TYPE");
+
+        const char* p    = field.data();
+        const char* last = field.data() + field.size();
+        T v = 0;
+        if(!detail::parse_number(p, last, v))
+        {
+            std::size_t sign = !field.empty() && (field[0] == '+' || field[0] == '-');
+            if(field.size() > sign && static_cast<unsigned char>(field[sign] - '0') < 10)
+                throw std::out_of_range("bed: integer field out of range");
+            throw std::invalid_argument("bed: invalid integer field");
+        }
+        return v;
+    }
+
+    /// @brief Parse a comma separated list of integers (e.g. "354,109,1189,")
+    ///        and push its elements to the back of list.
+    ///
+    /// Parsing stops at the first element that is not a number, so a
+    /// trailing comma is accepted. Returns the number of elements added.
+    template<class LIST>
+    std::size_t append_list(std::string_view field, LIST& list)
+    {
+        using value_type = typename LIST::value_type;
+
+        const std::size_t old_size = list.size();
+        const char* p    = field.data();
+        const char* last = field.data() + field.size();
+
+        while(p != last)
+        {
+            value_type v{};
+            if(!detail::parse_number(p, last, v))
+                break;
+            list.push_back(v);
+            if(p == last || *p != ',')
+                break;
+            ++p;
+        }
+        return list.size() - old_size;
+    }
+
+    /// @brief Parse a comma separated list of integers into list, reusing
+    ///        its storage (see append_list).
+    template<class LIST>
+    void parse_list(std::string_view field, LIST& list)
+    {
+        list.clear();
+        append_list(field, list);
+    }
+
+}
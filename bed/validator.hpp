@@ -0,0 +1,260 @@
+/// @file validator.hpp
+/// @brief Validation-only scan of BED text, without building records
+
+#pragma once
+#include <Biovoltron/format/bed/header.hpp>
+#include <Biovoltron/format/bed/mapped_file.hpp>
+#include <Biovoltron/format/bed/mmap_reader.hpp>
+#include <Biovoltron/format/bed/parallel_parser.hpp>
+#include <Biovoltron/format/bed/tokenizer.hpp>
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace biovoltron::format{
+
+    namespace bed {
+
+        enum class Rule
+        {
+            too_few_columns,    ///< fewer than 3 columns
+            too_many_columns,   ///< more than 12 columns
+            column_count,       ///< not the column count of the first data line
+            invalid_number,     ///< a numeric column is not an unsigned integer
+            start_after_end,    ///< chromStart > chromEnd
+            score_range,        ///< score not in [0, 1000]
+            strand,             ///< strand not one of + - .
+            block_count,        ///< blockSizes / blockStarts length differs from blockCount
+            misplaced_header    ///< track / browser / # line after the first data line
+        };
+
+        inline const char* rule_name(Rule rule)
+        {
+            static const char* names[] = { "too_few_columns", "too_many_columns", "column_count", "invalid_number",
+                                           "start_after_end", "score_range", "strand", "block_count", "misplaced_header" };
+            return names[std::size_t(rule)];
+        }
+
+        /// @brief One broken rule: line is 1-based, offset is the byte offset
+        ///        of the start of the line, column is 0-based (-1 for the whole line).
+        struct Violation
+        {
+            Rule rule;
+            uint64_t line;
+            uint64_t offset;
+            int column;
+
+            std::string to_string() const
+            {
+                return "line " + std::to_string(line) + " (byte " + std::to_string(offset) + ")"
+                     + (column >= 0 ? ", column " + std::to_string(column + 1) : std::string())
+                     + ": " + rule_name(rule);
+            }
+        };
+    }
+
+/// @class BEDValidator
+/// @brief Checks the rules of the BED format over raw bytes.
+///
+/// Lines are only split into std::string_view fields and the numeric ones
+/// checked digit by digit; nothing is allocated per line. The leading header
+/// lines and the column count of the first data line are found first, then
+/// the rest of the data is cut at line boundaries and checked on
+/// thread_num threads. Every violation is reported, ordered by line.
+///
+///     auto violations = BEDValidator().validate_file(path);
+///     for(auto& v: violations)
+///         std::cerr << v.to_string() << '\n';
+    class BEDValidator
+    {
+      public:
+
+        explicit BEDValidator(std::size_t thread_num = bed::default_thread_num())
+            : thread_num(std::max<std::size_t>(thread_num, 1))
+        {}
+
+        std::vector<bed::Violation> validate_file(const std::string& path) const
+        {
+            bed::MappedFile file(path);
+            return validate(file.view());
+        }
+
+        std::vector<bed::Violation> validate(std::string_view data) const
+        {
+            // leading header and empty lines, and the first data line
+            const char* first = data.data();
+            const char* last  = data.data() + data.size();
+            const char* cur   = first;
+            uint64_t header_lines = 0;
+            std::size_t col_num = 0;
+            while(cur != last)
+            {
+                const char* line_begin = cur;
+                std::string_view line = BEDMmapReader<>::next_line(cur, last);
+                if(!line.empty() && !bed::is_header_line(line))
+                {
+                    std::array<std::string_view, max_columns + 1> fields;
+                    col_num = bed::split_fields(line, fields);
+                    cur = line_begin;
+                    break;
+                }
+                header_lines++;
+            }
+
+            const std::string_view body = data.substr(cur - first);
+            auto chunks = bed::split_by_lines(body, thread_num == 1 ? 1 : thread_num * 4);
+            std::vector<std::vector<bed::Violation>> found(chunks.size());
+            std::vector<uint64_t> lines(chunks.size());
+
+            bed::parallel_for(chunks.size(), thread_num, [&](std::size_t i)
+            {
+                lines[i] = check_chunk(chunks[i], chunks[i].data() - first, col_num, found[i]);
+            });
+
+            // chunk-local line numbers to file line numbers
+            std::vector<bed::Violation> violations;
+            uint64_t line_base = header_lines;
+            for(std::size_t i = 0; i < chunks.size(); i++)
+            {
+                for(auto& v: found[i])
+                {
+                    v.line += line_base;
+                    violations.push_back(v);
+                }
+                line_base += lines[i];
+            }
+            return violations;
+        }
+
+      private:
+
+        static constexpr std::size_t max_columns = 12;
+
+        /// @brief Whether field is all digits and fits 32 bits.
+        static bool parse_uint(std::string_view field, uint64_t& v)
+        {
+            if(field.empty() || field.size() > 10)
+                return false;
+            v = 0;
+            for(char c: field)
+            {
+                if(static_cast<unsigned char>(c - '0') > 9)
+                    return false;
+                v = v * 10 + (c - '0');
+            }
+            return v <= UINT32_MAX;
+        }
+
+        /// @brief Number of elements of a comma separated list, a trailing
+        ///        comma allowed; -1 when an element is not a number.
+        static long list_size(std::string_view field)
+        {
+            if(!field.empty() && field.back() == ',')
+                field.remove_suffix(1);
+            if(field.empty())
+                return 0;
+
+            long n = 0;
+            uint64_t v;
+            for(std::size_t begin = 0; begin <= field.size(); n++)
+            {
+                std::size_t comma = std::min(field.find(',', begin), field.size());
+                if(!parse_uint(field.substr(begin, comma - begin), v))
+                    return -1;
+                begin = comma + 1;
+            }
+            return n;
+        }
+
+        /// @brief Check the lines of chunk, line numbers in found are 1-based
+        ///        within the chunk. Returns the number of lines of chunk.
+        static uint64_t check_chunk(std::string_view chunk, uint64_t base_offset, std::size_t col_num,
+                                    std::vector<bed::Violation>& found)
+        {
+            const char* first = chunk.data();
+            const char* last  = chunk.data() + chunk.size();
+            const char* cur   = first;
+            uint64_t line_no = 0;
+            std::array<std::string_view, max_columns + 1> fields;
+
+            while(cur != last)
+            {
+                const char* line_begin = cur;
+                std::string_view line = BEDMmapReader<>::next_line(cur, last);
+                line_no++;
+                if(line.empty())
+                    continue;
+
+                const uint64_t offset = base_offset + (line_begin - first);
+                auto report = [&](bed::Rule rule, int column)
+                {
+                    found.push_back({ rule, line_no, offset, column });
+                };
+
+                if(bed::is_header_line(line))
+                {
+                    report(bed::Rule::misplaced_header, -1);
+                    continue;
+                }
+
+                const std::size_t n = bed::split_fields(line, fields);
+                if(n < 3)
+                {
+                    report(bed::Rule::too_few_columns, -1);
+                    continue;
+                }
+                if(n > max_columns)
+                    report(bed::Rule::too_many_columns, -1);
+                else if(n != col_num)
+                    report(bed::Rule::column_count, -1);
+
+                uint64_t v[max_columns] = {};
+                auto number = [&](std::size_t col)
+                {
+                    if(col >= n)
+                        return false;
+                    if(parse_uint(fields[col], v[col]))
+                        return true;
+                    report(bed::Rule::invalid_number, int(col));
+                    return false;
+                };
+
+                if(number(bed::Col::chromStart) & number(bed::Col::chromEnd)
+                   && v[bed::Col::chromStart] > v[bed::Col::chromEnd])
+                    report(bed::Rule::start_after_end, bed::Col::chromStart);
+
+                if(number(bed::Col::score) && v[bed::Col::score] > 1000)
+                    report(bed::Rule::score_range, bed::Col::score);
+
+                if(n > bed::Col::strand)
+                {
+                    auto strand = fields[bed::Col::strand];
+                    if(strand.size() != 1 || (strand[0] != '+' && strand[0] != '-' && strand[0] != '.'))
+                        report(bed::Rule::strand, bed::Col::strand);
+                }
+
+                number(bed::Col::thickStart);
+                number(bed::Col::thickEnd);
+
+                if(number(bed::Col::blockCount))
+                    for(std::size_t col: { bed::Col::blockSizes, bed::Col::blockStarts })
+                    {
+                        if(col >= n)
+                            break;
+                        long size = list_size(fields[col]);
+                        if(size < 0)
+                            report(bed::Rule::invalid_number, int(col));
+                        else if(uint64_t(size) != v[bed::Col::blockCount])
+                            report(bed::Rule::block_count, int(col));
+                    }
+            }
+            return line_no;
+        }
+
+        std::size_t thread_num;
+    };
+
+}
@@ -0,0 +1,197 @@
+/// @file writer.hpp
+/// @brief Buffered BED writer
+
+#pragma once
+#include <Biovoltron/format/bed/header.hpp>
+#include <Biovoltron/format/bed/formatter.hpp>
+#include <Biovoltron/format/bed/stats.hpp>
+#include <condition_variable>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <tuple>
+
+namespace biovoltron::format{
+
+/// @class BEDWriter
+/// @brief Formats BED records into a large reusable buffer and writes it
+///        to an std::ostream in big blocks.
+///
+/// The text of a record is byte identical to BED::to_string() followed by
+/// "\n". With background set, a full buffer is handed to a flusher thread
+/// while formatting continues in a second buffer.
+///
+///     BEDWriter<TupleType> writer(os);
+///     writer.write_header(h);
+///     for(auto& bed: v_bed)
+///         writer.write(bed);
+///
+/// Everything is flushed when the writer is destroyed.
+    template<class TupleType = std::tuple <std::string, uint32_t, uint32_t> >
+    class BEDWriter
+    {
+      public:
+
+        static constexpr std::size_t default_buffer_size = std::size_t(1) << 22;
+
+        explicit BEDWriter(std::ostream& os,
+                           std::size_t buffer_size = default_buffer_size,
+                           bool background = false)
+            : os(os), buffer_size(buffer_size)
+        {
+            buffer.reserve(buffer_size + 256);
+            if(background)
+            {
+                pending.reserve(buffer_size + 256);
+                flusher = std::thread([this]{ flush_loop(); });
+            }
+        }
+
+        BEDWriter(const BEDWriter&) = delete;
+        BEDWriter& operator=(const BEDWriter&) = delete;
+
+        ~BEDWriter()
+        {
+            flush();
+            if(flusher.joinable())
+            {
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    done = true;
+                }
+                cv.notify_all();
+                flusher.join();
+            }
+        }
+
+        void write_header(const bed::Header& header)
+        {
+            buffer += header.track_line;
+            buffer += '\n';
+            flush_if_full();
+        }
+
+        void write(const TupleType& data)
+        {
+            {
+                bed::StageTimer timer(bed::Stage::format);
+                const auto size = buffer.size();
+                bed::append_record(buffer, data);
+                buffer += '\n';
+                if constexpr(bed::stats_enabled)
+                    bed::stats().add_formatted(buffer.size() - size);
+            }
+            flush_if_full();
+        }
+
+        /// @brief Write a record type holding its columns in .data (e.g. BED<TupleType>).
+        template<class BEDType>
+        void write(const BEDType& bed)
+        {
+            write(bed.data);
+        }
+
+        /// @brief Same output as BED::dump: the header of the first record, then every record.
+        template<class BEDType>
+        void dump(const std::vector<BEDType>& v_bed)
+        {
+            if(v_bed.size() == 0)
+                return;
+
+            write_header(v_bed[0].header);
+            for(auto& bed: v_bed)
+                write(bed);
+        }
+
+        template<class BEDType>
+        BEDWriter& operator<<(const BEDType& bed)
+        {
+            write(bed);
+            return *this;
+        }
+
+        /// @brief Write out everything buffered so far and flush the stream.
+        void flush()
+        {
+            if(flusher.joinable())
+            {
+                submit();
+                std::unique_lock<std::mutex> lock(mutex);
+                cv.wait(lock, [this]{ return !has_pending; });
+            }
+            else
+                write_out(buffer);
+
+            buffer.clear();
+            os.flush();
+        }
+
+      private:
+
+        void write_out(const std::string& text)
+        {
+            bed::StageTimer timer(bed::Stage::write);
+            os.write(text.data(), text.size());
+            if constexpr(bed::stats_enabled)
+                bed::stats().add_written(text.size());
+        }
+
+        void flush_if_full()
+        {
+            if(buffer.size() < buffer_size)
+                return;
+
+            if(flusher.joinable())
+                submit();
+            else
+            {
+                write_out(buffer);
+                buffer.clear();
+            }
+        }
+
+        /// @brief Swap the full buffer with the (drained) pending one.
+        void submit()
+        {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                cv.wait(lock, [this]{ return !has_pending; });
+                buffer.swap(pending);
+                has_pending = true;
+            }
+            cv.notify_all();
+        }
+
+        void flush_loop()
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            while(true)
+            {
+                cv.wait(lock, [this]{ return has_pending || done; });
+                if(has_pending)
+                {
+                    lock.unlock();
+                    write_out(pending);
+                    pending.clear();
+                    lock.lock();
+                    has_pending = false;
+                    cv.notify_all();
+                }
+                else if(done)
+                    return;
+            }
+        }
+
+        std::ostream& os;
+        std::size_t buffer_size;
+        std::string buffer, pending;
+
+        std::thread flusher;
+        std::mutex mutex;
+        std::condition_variable cv;
+        bool has_pending = false;
+        bool done = false;
+    };
+
+}
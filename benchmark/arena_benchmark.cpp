@@ -0,0 +1,72 @@
+// Loads the same BED6 file through BEDParallelParser (a std::string per
+// chrom and name field) and BEDArenaFile, reporting load time and the peak
+// RSS of each run. Peak RSS is reset through /proc/self/clear_refs, so the
+// counter is only meaningful on Linux.
+#include <benchmark/benchmark.h>
+#include <Biovoltron/format/bed/arena.hpp>
+#include <Biovoltron/format/bed/parallel_parser.hpp>
+#include <fstream>
+#include <string>
+#include "bed_generator.hpp"
+using namespace biovoltron::format;
+
+using BED6Tuple = std::tuple <std::string, uint32_t, uint32_t, std::string, uint16_t, char>;
+
+struct Input
+{
+    bed::bench::TempBedFile file{"bed_arena_benchmark"};
+
+    Input()
+    {
+        std::ofstream(file.path()) << bed::bench::generate(bed::bench::Kind::BED6, 5000000);
+    }
+};
+
+static const Input& input()
+{
+    static const Input in;
+    return in;
+}
+
+static void reset_peak_rss()
+{
+    std::ofstream("/proc/self/clear_refs") << "5";
+}
+
+static double peak_rss_mib()
+{
+    std::ifstream status("/proc/self/status");
+    for(std::string line; std::getline(status, line); )
+        if(line.compare(0, 6, "VmHWM:") == 0)
+            return std::stod(line.substr(6)) / 1024;
+    return 0;
+}
+
+static void BM_load_records(benchmark::State& state)
+{
+    input();
+    reset_peak_rss();
+    for(auto _: state)
+    {
+        auto v_bed = BEDParallelParser<BED6Tuple>(state.range(0)).load(input().file.path());
+        benchmark::DoNotOptimize(v_bed.data());
+    }
+    state.counters["peak_rss_MiB"] = peak_rss_mib();
+}
+
+static void BM_load_arena(benchmark::State& state)
+{
+    input();
+    reset_peak_rss();
+    for(auto _: state)
+    {
+        auto file = BEDArenaFile<BED6Tuple>::load(input().file.path(), state.range(0));
+        benchmark::DoNotOptimize(file.size());
+    }
+    state.counters["peak_rss_MiB"] = peak_rss_mib();
+}
+
+BENCHMARK(BM_load_records)->Arg(1)->Arg(8)->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_load_arena)->Arg(1)->Arg(8)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
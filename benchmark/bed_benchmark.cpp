@@ -0,0 +1,163 @@
+// Throughput of the core BED API on synthetic data, in bytes/s and records/s.
+//
+// Machine readable results for regression tracking:
+//     ./bed_benchmark --benchmark_format=json > bed_benchmark.json
+// The record count is BED_BENCH_RECORDS (default 200000); the chromosome
+// layout follows BED_BENCH_DISTRIBUTION=uniform|genome.
+#include <benchmark/benchmark.h>
+#include <Biovoltron/format/bed.hpp>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include "bed_generator.hpp"
+using namespace biovoltron::format;
+
+using BED3Tuple = std::tuple <std::string, uint32_t, uint32_t>;
+using BED6Tuple = std::tuple <std::string, uint32_t, uint32_t, std::string, uint16_t, char>;
+using BED12Tuple = std::tuple <std::string, uint32_t, uint32_t, std::string, uint16_t, char, uint32_t, uint32_t,
+                              uint32_t, uint16_t, std::vector<uint32_t>, std::vector<uint32_t> >;
+
+template<class TupleType>
+static const std::string& data()
+{
+    static const std::string d = []
+    {
+        bed::bench::Options opts;
+        constexpr auto col_num = std::tuple_size<TupleType>::value;
+        opts.kind = col_num == 3 ? bed::bench::Kind::BED3 : col_num == 6 ? bed::bench::Kind::BED6 : bed::bench::Kind::BED12;
+
+        const char* n = std::getenv("BED_BENCH_RECORDS");
+        opts.n = n ? std::strtoull(n, nullptr, 10) : 200000;
+        const char* distribution = std::getenv("BED_BENCH_DISTRIBUTION");
+        if(distribution && std::strcmp(distribution, "genome") == 0)
+            opts.distribution = bed::bench::Distribution::Genome;
+        return bed::bench::generate(opts);
+    }();
+    return d;
+}
+
+template<class TupleType>
+static const std::vector<std::string>& lines()
+{
+    static const std::vector<std::string> v = []
+    {
+        std::vector<std::string> out;
+        std::istringstream iss(data<TupleType>());
+        for(std::string line; std::getline(iss, line); )
+            out.push_back(line);
+        return out;
+    }();
+    return v;
+}
+
+template<class TupleType>
+static std::vector<BED<TupleType>>& records()
+{
+    static std::vector<BED<TupleType>> v = []
+    {
+        std::vector<BED<TupleType>> out(lines<TupleType>().size());
+        for(std::size_t i = 0; i < out.size(); i++)
+            out[i].set_bed_data(lines<TupleType>()[i]);
+        return out;
+    }();
+    return v;
+}
+
+template<class TupleType>
+static void report(benchmark::State& state)
+{
+    state.SetItemsProcessed(state.iterations() * lines<TupleType>().size());
+    state.SetBytesProcessed(state.iterations() * data<TupleType>().size());
+}
+
+template<class TupleType>
+static void BM_set_bed_data(benchmark::State& state)
+{
+    auto& v_line = lines<TupleType>();
+    BED<TupleType> bed;
+
+    for(auto _: state)
+        for(auto& line: v_line)
+        {
+            bed.set_bed_data(line);
+            benchmark::DoNotOptimize(bed.data);
+        }
+    report<TupleType>(state);
+}
+
+template<class TupleType>
+static void BM_get_obj(benchmark::State& state)
+{
+    BED<TupleType> bed;
+    lines<TupleType>();
+
+    for(auto _: state)
+    {
+        std::istringstream iss(data<TupleType>());
+        while(BED<TupleType>::get_obj(iss, bed))
+            benchmark::DoNotOptimize(bed.data);
+    }
+    report<TupleType>(state);
+}
+
+template<class TupleType>
+static void BM_to_string(benchmark::State& state)
+{
+    auto& v_bed = records<TupleType>();
+
+    for(auto _: state)
+        for(auto& bed: v_bed)
+        {
+            auto str = bed.to_string();
+            benchmark::DoNotOptimize(str.data());
+        }
+    report<TupleType>(state);
+}
+
+template<class TupleType>
+static void BM_dump(benchmark::State& state)
+{
+    auto& v_bed = records<TupleType>();
+
+    for(auto _: state)
+    {
+        std::ostringstream oss;
+        BED<TupleType>::dump(oss, v_bed);
+        benchmark::DoNotOptimize(oss.tellp());
+    }
+    report<TupleType>(state);
+}
+
+static void BM_header_set(benchmark::State& state)
+{
+    std::vector<std::string> track_lines;
+    std::size_t bytes = 0;
+    for(std::size_t i = 0; i < 1000; i++)
+    {
+        track_lines.push_back(bed::bench::track_line(i));
+        bytes += track_lines.back().size();
+    }
+
+    for(auto _: state)
+        for(auto& line: track_lines)
+        {
+            BEDHeader header;
+            header.set(line);
+            benchmark::DoNotOptimize(header);
+        }
+    state.SetItemsProcessed(state.iterations() * track_lines.size());
+    state.SetBytesProcessed(state.iterations() * bytes);
+}
+
+#define BED_BENCHMARK(name)                                                  \
+    BENCHMARK_TEMPLATE(name, BED3Tuple)->Unit(benchmark::kMillisecond);      \
+    BENCHMARK_TEMPLATE(name, BED6Tuple)->Unit(benchmark::kMillisecond);      \
+    BENCHMARK_TEMPLATE(name, BED12Tuple)->Unit(benchmark::kMillisecond);
+
+BED_BENCHMARK(BM_set_bed_data)
+BED_BENCHMARK(BM_get_obj)
+BED_BENCHMARK(BM_to_string)
+BED_BENCHMARK(BM_dump)
+BENCHMARK(BM_header_set);
+
+BENCHMARK_MAIN();
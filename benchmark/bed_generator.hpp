@@ -0,0 +1,187 @@
+/// @file bed_generator.hpp
+/// @brief Deterministic synthetic BED data for benchmarks
+
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+namespace biovoltron::format::bed::bench {
+
+    enum class Kind
+    {
+        BED3, BED6, BED12
+    };
+
+    enum class Distribution
+    {
+        Uniform,    ///< the same number of records on every chromosome
+        Genome      ///< records in proportion to the GRCh38 chromosome lengths
+    };
+
+    /// @brief What to generate; the defaults give the data of generate(kind, n, seed).
+    struct Options
+    {
+        Kind kind = Kind::BED3;
+        std::size_t n = 0;
+        uint32_t seed = 1;
+        std::size_t chrom_num = 24;                   ///< chr1 ... chr<chrom_num>
+        Distribution distribution = Distribution::Uniform;
+        uint32_t max_gap = 2000;                      ///< chromStart steps are in [0, max_gap)
+    };
+
+    /// @brief Number of records per chromosome for opts.
+    inline std::vector<std::size_t> records_per_chrom(const Options& opts)
+    {
+        // GRCh38 chr1 ... chr22, chrX, chrY in Mb
+        static const double lengths[] = { 248, 242, 198, 190, 181, 171, 159, 145, 138, 134, 135, 133,
+                                          114, 107, 102, 90, 83, 80, 59, 64, 47, 51, 156, 57 };
+        const std::size_t chrom_num = std::max<std::size_t>(opts.chrom_num, 1);
+        std::vector<std::size_t> counts(chrom_num, 0);
+
+        if(opts.distribution == Distribution::Uniform)
+        {
+            const std::size_t per_chrom = (opts.n + chrom_num - 1) / chrom_num;
+            std::size_t left = opts.n;
+            for(auto& count: counts)
+            {
+                count = std::min(per_chrom, left);
+                left -= count;
+            }
+            return counts;
+        }
+
+        double total = 0;
+        for(std::size_t c = 0; c < chrom_num; c++)
+            total += lengths[c % 24];
+        std::size_t given = 0;
+        for(std::size_t c = 0; c < chrom_num; c++)
+            given += counts[c] = static_cast<std::size_t>(opts.n * lengths[c % 24] / total);
+        counts[0] += opts.n - given;
+        return counts;
+    }
+
+    /// @brief Generate opts.n data lines sorted by chromStart within every
+    ///        chromosome. The same options give the same bytes.
+    inline std::string generate(const Options& opts)
+    {
+        const Kind kind = opts.kind;
+        const std::size_t n = opts.n;
+        const auto counts = records_per_chrom(opts);
+
+        // raw engine output only: std distributions differ between libraries
+        std::mt19937 rng(opts.seed);
+        std::string out;
+        out.reserve(n * (kind == Kind::BED12 ? 96 : 32));
+
+        std::size_t chrom = 0, left = counts[0];
+        uint32_t start = 0;
+
+        for(std::size_t i = 0; i < n; i++)
+        {
+            while(left == 0)
+            {
+                left = counts[++chrom];
+                start = 0;
+            }
+            left--;
+
+            start += rng() % opts.max_gap;
+            uint32_t len = 100 + rng() % 5000;
+
+            out += "chr";
+            out += std::to_string(chrom + 1);
+            out += '\t';
+            out += std::to_string(start);
+            out += '\t';
+            out += std::to_string(start + len);
+
+            if(kind != Kind::BED3)
+            {
+                out += "\tpeak";
+                out += std::to_string(i);
+                out += '\t';
+                out += std::to_string(rng() % 1001);
+                out += '\t';
+                out += "+-."[rng() % 3];
+            }
+
+            if(kind == Kind::BED12)
+            {
+                uint32_t block_num = 1 + rng() % 4;
+                uint32_t block_len = len / (2 * block_num);
+
+                out += '\t';
+                out += std::to_string(start);
+                out += '\t';
+                out += std::to_string(start + len);
+                out += "\t0\t";
+                out += std::to_string(block_num);
+                out += '\t';
+                for(uint32_t b = 0; b + 1 < block_num; b++)
+                    out += std::to_string(block_len) + ",";
+                out += std::to_string(len - (block_num - 1) * 2 * block_len) + ",";
+                out += '\t';
+                for(uint32_t b = 0; b < block_num; b++)
+                    out += std::to_string(b * 2 * block_len) + ",";
+            }
+            out += '\n';
+        }
+        return out;
+    }
+
+    /// @brief Generate n data lines of the given kind over 24 chromosomes.
+    inline std::string generate(Kind kind, std::size_t n, uint32_t seed = 1)
+    {
+        Options opts;
+        opts.kind = kind;
+        opts.n = n;
+        opts.seed = seed;
+        return generate(opts);
+    }
+
+    /// @brief An empty file with a unique name under the system temp
+    ///        directory, removed with the object, so benchmark runs at the
+    ///        same time do not overwrite each other's inputs.
+    class TempBedFile
+    {
+      public:
+
+        explicit TempBedFile(const std::string& prefix = "bed_benchmark")
+        {
+            path_ = (std::filesystem::temp_directory_path() / (prefix + "_XXXXXX")).string();
+            int fd = ::mkstemp(&path_[0]);
+            if(fd < 0)
+                throw std::runtime_error("bed: cannot create a temporary file " + path_);
+            ::close(fd);
+        }
+
+        TempBedFile(const TempBedFile&) = delete;
+        TempBedFile& operator=(const TempBedFile&) = delete;
+
+        ~TempBedFile()
+        {
+            std::remove(path_.c_str());
+        }
+
+        const std::string& path() const { return path_; }
+
+      private:
+
+        std::string path_;
+    };
+
+    /// @brief A track line using the attributes Header::set understands.
+    inline std::string track_line(std::size_t i)
+    {
+        return "track name=\"track " + std::to_string(i) + "\" description=\"synthetic track number "
+             + std::to_string(i) + "\" visibility=2 itemRgb=\"On\" useScore=1 colorByStrand=\"255,0,0 0,0,255\"";
+    }
+
+}
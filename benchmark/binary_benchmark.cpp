@@ -0,0 +1,84 @@
+#include <benchmark/benchmark.h>
+#include <Biovoltron/format/bed/binary.hpp>
+#include <Biovoltron/format/bed/file.hpp>
+#include <fstream>
+#include "bed_generator.hpp"
+using namespace biovoltron::format;
+
+using BED6Tuple = std::tuple <std::string, uint32_t, uint32_t, std::string, uint16_t, char>;
+
+// one text and one binary copy of the same records, removed at exit
+struct Files
+{
+    bed::bench::TempBedFile text_file{"bed_binary_benchmark"};
+    bed::bench::TempBedFile binary_file{"bed_binary_benchmark_bin"};
+    std::string text = text_file.path();
+    std::string binary = binary_file.path();
+
+    Files()
+    {
+        std::ofstream(text) << bed::bench::generate(bed::bench::Kind::BED6, 2000000);
+        auto file = BEDFile<BED6Tuple>::load(text);
+        BEDBinaryWriter<BED6Tuple>::write(binary, file.records, file.header);
+    }
+};
+
+static const Files& files()
+{
+    static const Files f;
+    return f;
+}
+
+static void BM_text_load(benchmark::State& state)
+{
+    files();
+    for(auto _: state)
+    {
+        auto file = BEDFile<BED6Tuple>::load(files().text, 1);
+        benchmark::DoNotOptimize(file.records.data());
+    }
+}
+
+static void BM_binary_open(benchmark::State& state)
+{
+    files();
+    for(auto _: state)
+    {
+        BEDBinaryReader<BED6Tuple> reader(files().binary);
+        benchmark::DoNotOptimize(reader.size());
+    }
+}
+
+static void BM_binary_scan_starts(benchmark::State& state)
+{
+    BEDBinaryReader<BED6Tuple> reader(files().binary);
+    for(auto _: state)
+    {
+        uint64_t sum = 0;
+        for(auto s: reader.column<bed::Col::chromStart>())
+            sum += s;
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * reader.size());
+}
+
+static void BM_binary_region_query(benchmark::State& state)
+{
+    BEDBinaryReader<BED6Tuple> reader(files().binary);
+    std::mt19937 rng(5);
+    std::size_t hits = 0;
+    for(auto _: state)
+    {
+        uint32_t start = rng() % 80000000;
+        hits += reader.query("chr" + std::to_string(1 + rng() % 24), start, start + 10000).size();
+    }
+    benchmark::DoNotOptimize(hits);
+    state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(BM_text_load)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_binary_open)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_binary_scan_starts)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_binary_region_query);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,47 @@
+// BED12 loading with std::vector block columns (two heap lists per record)
+// vs bed::BlockSpan columns stored flat in the BEDFile.
+#include <benchmark/benchmark.h>
+#include <Biovoltron/format/bed/file.hpp>
+#include <fstream>
+#include "bed_generator.hpp"
+using namespace biovoltron::format;
+
+using VectorTuple = std::tuple <std::string, uint32_t, uint32_t, std::string, uint16_t, char, uint32_t, uint32_t,
+                                uint32_t, uint16_t, std::vector<uint32_t>, std::vector<uint32_t> >;
+using SpanTuple = std::tuple <std::string, uint32_t, uint32_t, std::string, uint16_t, char, uint32_t, uint32_t,
+                              uint32_t, uint16_t, bed::BlockSpan<uint32_t>, bed::BlockSpan<uint32_t> >;
+
+struct Input
+{
+    bed::bench::TempBedFile file{"bed_block_span_benchmark"};
+    std::size_t bytes = 0;
+
+    Input()
+    {
+        std::string data = bed::bench::generate(bed::bench::Kind::BED12, 1000000);
+        std::ofstream(file.path()) << data;
+        bytes = data.size();
+    }
+};
+
+static const Input& input()
+{
+    static const Input in;
+    return in;
+}
+
+template<class TupleType>
+static void BM_load_BED12(benchmark::State& state)
+{
+    input();
+    for(auto _: state)
+    {
+        auto file = BEDFile<TupleType>::load(input().file.path(), state.range(0));
+        benchmark::DoNotOptimize(file.size());
+    }
+    state.SetBytesProcessed(state.iterations() * input().bytes);
+}
+BENCHMARK_TEMPLATE(BM_load_BED12, VectorTuple)->Arg(1)->Arg(8)->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_load_BED12, SpanTuple)->Arg(1)->Arg(8)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,89 @@
+#include <benchmark/benchmark.h>
+#include <Biovoltron/format/bed/blocks.hpp>
+#include <Biovoltron/format/bed/parallel_parser.hpp>
+#include "bed_generator.hpp"
+#include <sstream>
+using namespace biovoltron::format;
+
+using BED12Tuple = std::tuple <std::string, uint32_t, uint32_t, std::string, uint16_t, char, uint32_t, uint32_t,
+                              uint32_t, uint16_t, std::vector<uint32_t>, std::vector<uint32_t> >;
+using BED6Tuple = std::tuple <std::string, uint32_t, uint32_t, std::string, uint32_t, char>;
+
+static const std::vector<BEDRecord<BED12Tuple>>& records()
+{
+    static const auto v_bed = BEDParallelParser<BED12Tuple>(1).parse(
+                                  bed::bench::generate(bed::bench::Kind::BED12, 200000));
+    return v_bed;
+}
+
+// one BED per exon, then dump, the way it is done by hand
+static void BM_exons_materialized(benchmark::State& state)
+{
+    auto& v_bed = records();
+    for(auto _: state)
+    {
+        std::ostringstream oss;
+        std::vector<BED<BED6Tuple>> exons;
+        for(auto& bed: v_bed)
+        {
+            auto& d = bed.data;
+            auto& sizes = std::get<bed::Col::blockSizes>(d);
+            auto& starts = std::get<bed::Col::blockStarts>(d);
+            for(std::size_t i = 0; i < sizes.size(); i++)
+            {
+                BED<BED6Tuple> exon;
+                uint32_t s = std::get<bed::Col::chromStart>(d) + starts[i];
+                exon.data = { std::get<bed::Col::chrom>(d), s, s + sizes[i],
+                              std::get<bed::Col::name>(d), uint32_t(i), std::get<bed::Col::strand>(d) };
+                exons.push_back(std::move(exon));
+            }
+        }
+        BED<BED6Tuple>::dump(oss, exons);
+        benchmark::DoNotOptimize(oss.str().size());
+    }
+    state.SetItemsProcessed(state.iterations() * v_bed.size());
+}
+BENCHMARK(BM_exons_materialized)->Unit(benchmark::kMillisecond);
+
+static void BM_exons_streamed(benchmark::State& state)
+{
+    auto& v_bed = records();
+    for(auto _: state)
+    {
+        std::ostringstream oss;
+        bed::write_features(v_bed, bed::Feature::exon, oss);
+        benchmark::DoNotOptimize(oss.str().size());
+    }
+    state.SetItemsProcessed(state.iterations() * v_bed.size());
+}
+BENCHMARK(BM_exons_streamed)->Unit(benchmark::kMillisecond);
+
+static void BM_spliced_length(benchmark::State& state)
+{
+    auto& v_bed = records();
+    for(auto _: state)
+    {
+        uint64_t total = 0;
+        for(auto& bed: v_bed)
+            total += bed::spliced_length(bed.data);
+        benchmark::DoNotOptimize(total);
+    }
+    state.SetItemsProcessed(state.iterations() * v_bed.size());
+}
+BENCHMARK(BM_spliced_length)->Unit(benchmark::kMillisecond);
+
+static void BM_index_introns(benchmark::State& state)
+{
+    auto& v_bed = records();
+    for(auto _: state)
+    {
+        BEDIntervalIndex index;
+        bed::index_features(v_bed, bed::Feature::intron, index);
+        index.build();
+        benchmark::DoNotOptimize(index.size());
+    }
+    state.SetItemsProcessed(state.iterations() * v_bed.size());
+}
+BENCHMARK(BM_index_introns)->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
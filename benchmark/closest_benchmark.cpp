@@ -0,0 +1,58 @@
+// Nearest gene of every peak: sorted peaks (cursor sweep) vs shuffled
+// peaks (binary search), over a few thread counts.
+#include <benchmark/benchmark.h>
+#include <Biovoltron/format/bed/closest.hpp>
+#include <Biovoltron/format/bed/parallel_parser.hpp>
+#include <algorithm>
+#include <random>
+#include "bed_generator.hpp"
+using namespace biovoltron::format;
+
+using BED6Tuple = std::tuple <std::string, uint32_t, uint32_t, std::string, uint16_t, char>;
+
+static const std::vector<BEDRecord<BED6Tuple>>& genes()
+{
+    static const auto v_bed = []
+    {
+        bed::bench::Options opts;
+        opts.kind = bed::bench::Kind::BED6;
+        opts.n = 20000;
+        opts.seed = 2;
+        opts.max_gap = 100000;
+        return BEDParallelParser<BED6Tuple>(1).parse(bed::bench::generate(opts));
+    }();
+    return v_bed;
+}
+
+static const std::vector<BEDRecord<BED6Tuple>>& peaks(bool sorted)
+{
+    static const auto v_sorted = BEDParallelParser<BED6Tuple>(1).parse(
+                                     bed::bench::generate(bed::bench::Kind::BED6, 1000000));
+    static const auto v_shuffled = [&]
+    {
+        auto v = v_sorted;
+        std::shuffle(v.begin(), v.end(), std::mt19937(1));
+        return v;
+    }();
+    return sorted ? v_sorted : v_shuffled;
+}
+
+// { sorted, threads }
+static void BM_closest(benchmark::State& state)
+{
+    BEDClosest index(genes());
+    auto& queries = peaks(state.range(0));
+    BEDClosest::Options opts;
+    opts.thread_num = state.range(1);
+
+    for(auto _: state)
+    {
+        auto result = index.closest(queries, opts);
+        benchmark::DoNotOptimize(result.hits.data());
+    }
+    state.SetItemsProcessed(state.iterations() * queries.size());
+}
+BENCHMARK(BM_closest)->Args({ 1, 1 })->Args({ 0, 1 })->Args({ 1, 8 })->Args({ 0, 8 })
+    ->UseRealTime()->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,33 @@
+#include <benchmark/benchmark.h>
+#include <Biovoltron/format/bed/coverage.hpp>
+#include <Biovoltron/format/bed/parallel_parser.hpp>
+#include "bed_generator.hpp"
+using namespace biovoltron::format;
+
+using BED12Tuple = std::tuple <std::string, uint32_t, uint32_t, std::string, uint16_t, char, uint32_t, uint32_t,
+                              uint32_t, uint16_t, std::vector<uint32_t>, std::vector<uint32_t> >;
+
+static const std::vector<BEDRecord<BED12Tuple>>& records()
+{
+    static const auto v_bed = BEDParallelParser<BED12Tuple>(1).parse(
+                                  bed::bench::generate(bed::bench::Kind::BED12, 1000000));
+    return v_bed;
+}
+
+// { threads, use_blocks }
+static void BM_coverage(benchmark::State& state)
+{
+    auto& v_bed = records();
+    BEDCoverage<BED12Tuple> coverage(state.range(0), state.range(1));
+    std::size_t runs = 0;
+
+    for(auto _: state)
+        coverage.compute(v_bed, [&](std::string_view, const auto& r){ runs += r.size(); });
+
+    benchmark::DoNotOptimize(runs);
+    state.SetItemsProcessed(state.iterations() * v_bed.size());
+}
+BENCHMARK(BM_coverage)->Args({ 1, 0 })->Args({ 1, 1 })->Args({ 4, 1 })->Args({ 8, 1 })
+    ->UseRealTime()->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,81 @@
+#include <benchmark/benchmark.h>
+#include <Biovoltron/format/bed/filter.hpp>
+#include <Biovoltron/format/bed/parallel_parser.hpp>
+#include "bed_generator.hpp"
+using namespace biovoltron::format;
+
+using BED12Tuple = std::tuple <std::string, uint32_t, uint32_t, std::string, uint16_t, char, uint32_t, uint32_t,
+                              uint32_t, uint16_t, std::vector<uint32_t>, std::vector<uint32_t> >;
+
+static const std::string& data()
+{
+    static const auto text = bed::bench::generate(bed::bench::Kind::BED12, 1000000);
+    return text;
+}
+
+enum Filter { chrom, region, score, strand_score };
+
+static bed::Predicate predicate(int filter)
+{
+    bed::Predicate pred;
+    switch(filter)
+    {
+        case chrom:         // ~1/24 of the records
+            pred.chrom = "chr7";
+            break;
+        case region:        // a few Mb of chr1
+            pred.chrom = "chr1";
+            pred.start = 10000000;
+            pred.end = 15000000;
+            break;
+        case score:         // ~10% of the records
+            pred.min_score = 900;
+            break;
+        case strand_score:  // ~3%
+            pred.strand = '+';
+            pred.min_score = 900;
+            break;
+    }
+    return pred;
+}
+
+static bool match(const bed::Predicate& pred, const BED12Tuple& d)
+{
+    return (pred.chrom.empty() || std::get<bed::Col::chrom>(d) == pred.chrom)
+        && std::get<bed::Col::chromStart>(d) < pred.end && pred.start < std::get<bed::Col::chromEnd>(d)
+        && std::get<bed::Col::score>(d) >= pred.min_score && std::get<bed::Col::score>(d) <= pred.max_score
+        && (pred.strand == 0 || std::get<bed::Col::strand>(d) == pred.strand);
+}
+
+// parse every line, then keep the matching records
+static void BM_parse_then_filter(benchmark::State& state)
+{
+    auto& text = data();
+    auto pred = predicate(state.range(0));
+    std::size_t kept = 0;
+    for(auto _: state)
+    {
+        auto v_bed = BEDParallelParser<BED12Tuple>(1).parse(text);
+        v_bed.erase(std::remove_if(v_bed.begin(), v_bed.end(),
+                                   [&](const auto& bed){ return !match(pred, bed.data); }), v_bed.end());
+        kept = v_bed.size();
+    }
+    state.counters["kept"] = kept;
+    state.SetBytesProcessed(state.iterations() * text.size());
+}
+BENCHMARK(BM_parse_then_filter)->DenseRange(chrom, strand_score)->Unit(benchmark::kMillisecond);
+
+static void BM_filter(benchmark::State& state)
+{
+    auto& text = data();
+    BEDFilter<BED12Tuple> filter(predicate(state.range(0)), state.range(1));
+    std::size_t kept = 0;
+    for(auto _: state)
+        kept = filter.select(text).size();
+    state.counters["kept"] = kept;
+    state.SetBytesProcessed(state.iterations() * text.size());
+}
+BENCHMARK(BM_filter)->ArgsProduct({ { chrom, region, score, strand_score }, { 1, 4 } })
+    ->UseRealTime()->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,98 @@
+#include <benchmark/benchmark.h>
+#include <Biovoltron/format/bed/interval_index.hpp>
+#include <Biovoltron/format/bed/parallel_parser.hpp>
+#include "bed_generator.hpp"
+using namespace biovoltron::format;
+
+using BED3Tuple = std::tuple <std::string, uint32_t, uint32_t>;
+
+static const std::vector<BEDRecord<BED3Tuple>>& records()
+{
+    static const auto v_bed = BEDParallelParser<BED3Tuple>(1).parse(
+                                  bed::bench::generate(bed::bench::Kind::BED3, 1000000));
+    return v_bed;
+}
+
+static std::vector<bed::Region> regions(std::size_t n)
+{
+    auto& v_bed = records();
+    std::mt19937 rng(3);
+    std::vector<bed::Region> out;
+    for(std::size_t i = 0; i < n; i++)
+    {
+        auto& [ chrom, start, end ] = v_bed[rng() % v_bed.size()].data;
+        out.push_back({ chrom, start, static_cast<uint32_t>(start + 1 + rng() % 10000) });
+    }
+    return out;
+}
+
+static void BM_linear_scan(benchmark::State& state)
+{
+    auto& v_bed = records();
+    const auto queries = regions(64);
+    std::size_t hits = 0, n = 0;
+
+    for(auto _: state)
+    {
+        auto& q = queries[n++ % queries.size()];
+        for(std::size_t i = 0; i < v_bed.size(); i++)
+        {
+            auto& [ chrom, start, end ] = v_bed[i].data;
+            if(q.overlaps(chrom, start, end))
+                hits++;
+        }
+    }
+
+    benchmark::DoNotOptimize(hits);
+    state.SetItemsProcessed(state.iterations());
+}
+
+static void BM_index_query(benchmark::State& state)
+{
+    static const BEDIntervalIndex index(records());
+    const auto queries = regions(100000);
+    std::vector<std::size_t> ids;
+    std::size_t n = 0;
+
+    for(auto _: state)
+    {
+        auto& q = queries[n++ % queries.size()];
+        ids.clear();
+        index.query(q.chrom, q.start, q.end, ids);
+        benchmark::DoNotOptimize(ids.data());
+    }
+
+    state.SetItemsProcessed(state.iterations());
+}
+
+static void BM_index_batch(benchmark::State& state)
+{
+    static const BEDIntervalIndex index(records());
+    const auto queries = regions(100000);
+
+    for(auto _: state)
+    {
+        auto result = index.query(queries, state.range(0));
+        benchmark::DoNotOptimize(result.ids.data());
+    }
+
+    state.SetItemsProcessed(state.iterations() * queries.size());
+}
+
+static void BM_index_build(benchmark::State& state)
+{
+    for(auto _: state)
+    {
+        BEDIntervalIndex index(records());
+        benchmark::DoNotOptimize(index);
+    }
+
+    state.SetItemsProcessed(state.iterations() * records().size());
+}
+
+BENCHMARK(BM_linear_scan)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_index_query);
+BENCHMARK(BM_index_batch)->Arg(1)->Arg(4)->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_index_build)->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,100 @@
+// Region queries and record lookups on a plain text BED6 file: a
+// std::getline scan from the start of the file against BEDLineReader
+// reading only the slices its sidecar index points to.
+#include <benchmark/benchmark.h>
+#include <Biovoltron/format/bed/line_index.hpp>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <string>
+#include "bed_generator.hpp"
+using namespace biovoltron::format;
+
+using BED6Tuple = std::tuple <std::string, uint32_t, uint32_t, std::string, uint16_t, char>;
+
+struct Input
+{
+    bed::bench::TempBedFile file{"bed_line_index_benchmark"};
+    std::string path = file.path();
+
+    Input()
+    {
+        bed::bench::Options opts;
+        opts.kind = bed::bench::Kind::BED6;
+        opts.n = 5000000;
+        opts.distribution = bed::bench::Distribution::Genome;
+        std::ofstream(path) << bed::bench::generate(opts);
+        BEDLineIndex::build(path).save(BEDLineIndex::default_path(path));
+    }
+
+    ~Input()
+    {
+        std::remove(BEDLineIndex::default_path(path).c_str());
+    }
+};
+
+static const Input& input()
+{
+    static const Input in;
+    return in;
+}
+
+// 10 kb regions on chr12, near the middle of the file
+static bed::Region region(std::mt19937& rng)
+{
+    bed::Region r;
+    r.chrom = "chr12";
+    r.start = rng() % 100000000;
+    r.end = r.start + 10000;
+    return r;
+}
+
+static void BM_getline_query(benchmark::State& state)
+{
+    auto& in = input();
+    std::mt19937 rng(1);
+    std::size_t hits = 0;
+    for(auto _: state)
+    {
+        auto r = region(rng);
+        std::ifstream ifs(in.path);
+        BED<BED6Tuple> bed;
+        while(BED<BED6Tuple>::get_obj(ifs, bed))
+            if(r.overlaps(std::get<0>(bed.data), std::get<1>(bed.data), std::get<2>(bed.data)))
+                hits++;
+    }
+    benchmark::DoNotOptimize(hits);
+}
+BENCHMARK(BM_getline_query)->Unit(benchmark::kMillisecond);
+
+static void BM_index_build(benchmark::State& state)
+{
+    auto& in = input();
+    for(auto _: state)
+        benchmark::DoNotOptimize(BEDLineIndex::build(in.path, state.range(0)).size());
+}
+BENCHMARK(BM_index_build)->Arg(1)->Arg(4)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+static void BM_index_query(benchmark::State& state)
+{
+    auto& in = input();
+    BEDLineReader<BED6Tuple> reader(in.path);
+    std::mt19937 rng(1);
+    std::size_t hits = 0;
+    for(auto _: state)
+        reader.for_each_in(region(rng), [&](auto&){ hits++; });
+    benchmark::DoNotOptimize(hits);
+}
+BENCHMARK(BM_index_query)->Unit(benchmark::kMicrosecond);
+
+static void BM_index_record(benchmark::State& state)
+{
+    auto& in = input();
+    BEDLineReader<BED6Tuple> reader(in.path);
+    std::mt19937 rng(1);
+    for(auto _: state)
+        benchmark::DoNotOptimize(reader.record(rng() % reader.size()));
+}
+BENCHMARK(BM_index_record)->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_MAIN();
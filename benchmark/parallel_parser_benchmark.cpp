@@ -0,0 +1,35 @@
+#include <benchmark/benchmark.h>
+#include <Biovoltron/format/bed/parallel_parser.hpp>
+#include "bed_generator.hpp"
+using namespace biovoltron::format;
+
+using BED3Tuple  = std::tuple <std::string, uint32_t, uint32_t>;
+using BED12Tuple = std::tuple <std::string, uint32_t, uint32_t, std::string, uint16_t, char, uint32_t, uint32_t,
+                              uint32_t, uint16_t, std::vector<uint32_t>, std::vector<uint32_t> >;
+
+template<class TupleType>
+static void BM_parallel_parse(benchmark::State& state)
+{
+    constexpr auto kind = std::tuple_size<TupleType>::value == 3 ? bed::bench::Kind::BED3 : bed::bench::Kind::BED12;
+    static const std::string data = bed::bench::generate(kind, 1000000);
+    BEDParallelParser<TupleType> parser(state.range(0));
+
+    std::size_t records = 0;
+    for(auto _: state)
+    {
+        auto v_bed = parser.parse(data);
+        records += v_bed.size();
+        benchmark::DoNotOptimize(v_bed.data());
+    }
+
+    state.SetItemsProcessed(records);
+    state.SetBytesProcessed(state.iterations() * data.size());
+}
+
+// wall time: the work is spread over threads
+BENCHMARK_TEMPLATE(BM_parallel_parse, BED3Tuple)
+    ->RangeMultiplier(2)->Range(1, 64)->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_parallel_parse, BED12Tuple)
+    ->RangeMultiplier(2)->Range(1, 64)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,76 @@
+// Splits a BED6 file into per-chromosome and 10 Mb bin shards, then runs a
+// per-shard parse over the shards on a thread pool.
+#include <benchmark/benchmark.h>
+#include <Biovoltron/format/bed/partition.hpp>
+#include <boost/filesystem.hpp>
+#include <fstream>
+#include <string>
+#include "bed_generator.hpp"
+using namespace biovoltron::format;
+
+using BED6Tuple = std::tuple <std::string, uint32_t, uint32_t, std::string, uint16_t, char>;
+
+struct Input
+{
+    bed::bench::TempBedFile file{"bed_partition_benchmark"};
+    std::string path = file.path();
+    std::string dir = path + ".shards";     // unique as long as path is
+
+    Input()
+    {
+        bed::bench::Options opts;
+        opts.kind = bed::bench::Kind::BED6;
+        opts.n = 5000000;
+        opts.distribution = bed::bench::Distribution::Genome;
+        opts.max_gap = 1200;
+        std::ofstream(path) << "track name=partition\n" << bed::bench::generate(opts);
+        boost::filesystem::create_directories(dir);
+    }
+
+    ~Input()
+    {
+        boost::filesystem::remove_all(dir);
+    }
+};
+
+static const Input& input()
+{
+    static const Input in;
+    return in;
+}
+
+// { mode }
+static void BM_partition(benchmark::State& state)
+{
+    auto& in = input();
+    bed::PartitionOptions opts;
+    opts.mode = static_cast<bed::PartitionMode>(state.range(0));
+    std::size_t shards = 0;
+    for(auto _: state)
+        shards = BEDPartitioner(in.dir, opts).partition_file(in.path).shards.size();
+    state.counters["shards"] = shards;
+    state.SetBytesProcessed(state.iterations() * boost::filesystem::file_size(in.path));
+}
+BENCHMARK(BM_partition)->Arg(int(bed::PartitionMode::chrom))->Arg(int(bed::PartitionMode::bin))
+    ->Unit(benchmark::kMillisecond);
+
+// { threads }
+static void BM_run_shards(benchmark::State& state)
+{
+    auto& in = input();
+    bed::PartitionOptions opts;
+    opts.mode = bed::PartitionMode::bin;
+    auto manifest = BEDPartitioner(in.dir, opts).partition_file(in.path);
+
+    for(auto _: state)
+    {
+        auto total = bed::run_shards<BED6Tuple>(manifest, state.range(0),
+            [](const bed::Shard&, auto& v_bed){ return v_bed.size(); },
+            std::size_t(0), [](std::size_t& sum, std::size_t n){ sum += n; });
+        benchmark::DoNotOptimize(total);
+    }
+    state.SetItemsProcessed(state.iterations() * manifest.records());
+}
+BENCHMARK(BM_run_shards)->Arg(1)->Arg(4)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
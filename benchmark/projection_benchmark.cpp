@@ -0,0 +1,39 @@
+// Parsing BED12 input into narrower projections of its columns.
+#include <benchmark/benchmark.h>
+#include <Biovoltron/format/bed/parallel_parser.hpp>
+#include "bed_generator.hpp"
+using namespace biovoltron::format;
+
+using BED12Tuple = std::tuple <std::string, uint32_t, uint32_t, std::string, uint16_t, char, uint32_t, uint32_t,
+                              uint32_t, uint16_t, std::vector<uint32_t>, std::vector<uint32_t> >;
+using BED3Tuple = std::tuple <std::string, uint32_t, uint32_t>;
+using StrandTuple = std::tuple <std::string, uint32_t, uint32_t, bed::Skip, bed::Skip, char>;
+using LazyBlocksTuple = std::tuple <std::string, uint32_t, uint32_t, std::string, uint16_t, char, uint32_t, uint32_t,
+                                   uint32_t, uint16_t, bed::Lazy<std::vector<uint32_t>>, bed::Lazy<std::vector<uint32_t>> >;
+
+static const std::string& data()
+{
+    static const std::string d = bed::bench::generate(bed::bench::Kind::BED12, 500000);
+    return d;
+}
+
+template<class TupleType>
+static void BM_parse_BED12_as(benchmark::State& state)
+{
+    BEDParallelParser<TupleType> parser(1);
+    std::size_t n = 0;
+    data();
+    for(auto _: state)
+    {
+        auto v_bed = parser.parse(data());
+        n += v_bed.size();
+    }
+    state.SetItemsProcessed(n);
+    state.SetBytesProcessed(state.iterations() * data().size());
+}
+BENCHMARK_TEMPLATE(BM_parse_BED12_as, BED12Tuple)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_parse_BED12_as, LazyBlocksTuple)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_parse_BED12_as, StrandTuple)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_parse_BED12_as, BED3Tuple)->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
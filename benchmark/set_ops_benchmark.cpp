@@ -0,0 +1,98 @@
+// Streaming set operations on two sorted BED6 files, next to the same
+// bedtools commands when bedtools is on the PATH.
+#include <benchmark/benchmark.h>
+#include <Biovoltron/format/bed/set_ops.hpp>
+#include <Biovoltron/format/bed/sorter.hpp>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include "bed_generator.hpp"
+using namespace biovoltron::format;
+
+using BED6Tuple = std::tuple <std::string, uint32_t, uint32_t, std::string, uint16_t, char>;
+
+struct Input
+{
+    bed::bench::TempBedFile a{"bed_set_ops_a"};
+    bed::bench::TempBedFile b{"bed_set_ops_b"};
+    bed::bench::TempBedFile genome{"bed_set_ops_genome"};
+    bed::bench::TempBedFile out{"bed_set_ops_out"};
+    std::size_t bytes = 0;
+
+    Input()
+    {
+        // the generator numbers chromosomes, set operations want byte order
+        for(auto [path, seed]: { std::pair(a.path(), 1u), std::pair(b.path(), 2u) })
+        {
+            std::istringstream iss(bed::bench::generate(bed::bench::Kind::BED6, 1000000, seed));
+            bytes += iss.str().size();
+            std::ofstream ofs(path);
+            BEDSorter<BED6Tuple>().sort(iss, ofs);
+        }
+        std::ofstream ofs(genome.path());
+        for(int i = 1; i <= 24; i++)
+            ofs << "chr" << i << '\t' << 250000000 << '\n';
+    }
+
+    std::vector<std::pair<std::string, uint32_t>> chrom_sizes() const
+    {
+        std::vector<std::pair<std::string, uint32_t>> sizes;
+        for(int i = 1; i <= 24; i++)
+            sizes.emplace_back("chr" + std::to_string(i), 250000000);
+        return sizes;
+    }
+};
+
+static const Input& input()
+{
+    static const Input in;
+    return in;
+}
+
+enum Op { MERGE, INTERSECT, SUBTRACT, COMPLEMENT };
+
+static void BM_set_ops(benchmark::State& state)
+{
+    input();
+    for(auto _: state)
+    {
+        std::ifstream ia(input().a.path()), ib(input().b.path());
+        std::ofstream os(input().out.path());
+        bed::RecordSource<BED6Tuple> a(ia), b(ib);
+        switch(state.range(0))
+        {
+            case MERGE:      { auto p = bed::merge(std::move(a));                         bed::write(p, os); break; }
+            case INTERSECT:  { auto p = bed::intersect(std::move(a), std::move(b));       bed::write(p, os); break; }
+            case SUBTRACT:   { auto p = bed::subtract(std::move(a), std::move(b));        bed::write(p, os); break; }
+            case COMPLEMENT: { auto p = bed::complement(std::move(a), input().chrom_sizes()); bed::write(p, os); break; }
+        }
+    }
+    state.SetBytesProcessed(state.iterations() * input().bytes);
+}
+
+static void BM_bedtools(benchmark::State& state)
+{
+    if(std::system("command -v bedtools > /dev/null 2>&1") != 0)
+    {
+        state.SkipWithError("bedtools not found");
+        return;
+    }
+
+    const std::string a = input().a.path(), b = input().b.path(), out = " > " + input().out.path();
+    const std::string cmds[] = {
+        "bedtools merge -i " + a + out,
+        "bedtools intersect -sorted -a " + a + " -b " + b + out,
+        "bedtools subtract -sorted -a " + a + " -b " + b + out,
+        "bedtools complement -i " + a + " -g " + input().genome.path() + out,
+    };
+    for(auto _: state)
+        if(std::system(cmds[state.range(0)].c_str()) != 0)
+            state.SkipWithError("bedtools failed");
+
+    state.SetBytesProcessed(state.iterations() * input().bytes);
+}
+
+BENCHMARK(BM_set_ops)->DenseRange(MERGE, COMPLEMENT)->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_bedtools)->DenseRange(MERGE, COMPLEMENT)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
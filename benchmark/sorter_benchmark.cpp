@@ -0,0 +1,76 @@
+// Compares BEDSorter with GNU sort on the same shuffled input.
+// The input size is BED_SORT_BENCH_RECORDS records (default 2M); set it to
+// ~200M for the 20GB comparison.
+#include <benchmark/benchmark.h>
+#include <Biovoltron/format/bed/sorter.hpp>
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <random>
+#include "bed_generator.hpp"
+using namespace biovoltron::format;
+
+using BED6Tuple = std::tuple <std::string, uint32_t, uint32_t, std::string, uint16_t, char>;
+
+struct Input
+{
+    bed::bench::TempBedFile path{"bed_sort_benchmark"};
+    bed::bench::TempBedFile out{"bed_sort_benchmark_out"};
+    std::size_t bytes = 0;
+
+    Input()
+    {
+        const char* env = std::getenv("BED_SORT_BENCH_RECORDS");
+        std::size_t n = env ? std::strtoull(env, nullptr, 10) : 2000000;
+
+        std::string data = bed::bench::generate(bed::bench::Kind::BED6, n);
+        std::vector<std::string_view> lines;
+        for(std::size_t p = 0, nl; (nl = data.find('\n', p)) != std::string::npos; p = nl + 1)
+            lines.push_back(std::string_view(data).substr(p, nl - p + 1));
+        std::shuffle(lines.begin(), lines.end(), std::mt19937(1));
+
+        std::ofstream ofs(path.path());
+        ofs << "track name=\"sort benchmark\"\n";
+        for(auto line: lines)
+            ofs << line;
+        bytes = data.size();
+    }
+};
+
+static const Input& input()
+{
+    static const Input in;
+    return in;
+}
+
+static void BM_bed_sorter(benchmark::State& state)
+{
+    BEDSorter<BED6Tuple>::Options options;
+    options.memory_budget = std::size_t(state.range(0)) << 20;
+    options.thread_num = state.range(1);
+    input();
+
+    for(auto _: state)
+        BEDSorter<BED6Tuple>(options).sort(input().path.path(), input().out.path());
+
+    state.SetBytesProcessed(state.iterations() * input().bytes);
+}
+
+static void BM_gnu_sort(benchmark::State& state)
+{
+    std::string cmd = "LC_ALL=C sort -k1,1 -k2,2n -S " + std::to_string(state.range(0)) + "M --parallel="
+                    + std::to_string(state.range(1)) + " " + input().path.path() + " -o " + input().out.path();
+    for(auto _: state)
+        if(std::system(cmd.c_str()) != 0)
+            state.SkipWithError("sort failed");
+
+    state.SetBytesProcessed(state.iterations() * input().bytes);
+}
+
+// { memory budget in MiB, threads }
+BENCHMARK(BM_bed_sorter)->Args({ 1024, 1 })->Args({ 64, 1 })->Args({ 1024, 8 })
+    ->UseRealTime()->Unit(benchmark::kMillisecond)->Iterations(1);
+BENCHMARK(BM_gnu_sort)->Args({ 1024, 1 })->Args({ 64, 1 })->Args({ 1024, 8 })
+    ->UseRealTime()->Unit(benchmark::kMillisecond)->Iterations(1);
+
+BENCHMARK_MAIN();
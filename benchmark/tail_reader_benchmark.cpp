@@ -0,0 +1,65 @@
+// A file of 2M BED6 lines receives batches of 10k new lines. Keeping an
+// interval index current by parsing the whole file again and rebuilding
+// the index is compared with BEDTailReader::poll(index), which parses the
+// new lines and merges them into the index.
+#include <benchmark/benchmark.h>
+#include <Biovoltron/format/bed/tail_reader.hpp>
+#include <Biovoltron/format/bed/parallel_parser.hpp>
+#include <fstream>
+#include <string>
+#include "bed_generator.hpp"
+using namespace biovoltron::format;
+
+using BED6Tuple = std::tuple <std::string, uint32_t, uint32_t, std::string, uint16_t, char>;
+
+static const bed::bench::TempBedFile file("bed_tail_reader_benchmark");
+static const std::string& path = file.path();
+
+static const std::string& batch()
+{
+    static const auto text = bed::bench::generate(bed::bench::Kind::BED6, 10000, 2);
+    return text;
+}
+
+static void write_base()
+{
+    std::ofstream(path, std::ios::trunc) << bed::bench::generate(bed::bench::Kind::BED6, 2000000);
+}
+
+static void BM_reparse_and_rebuild(benchmark::State& state)
+{
+    write_base();
+    batch();
+    for(auto _: state)
+    {
+        state.PauseTiming();
+        std::ofstream(path, std::ios::app) << batch();
+        state.ResumeTiming();
+
+        auto v_bed = BEDParallelParser<BED6Tuple>(1).load(path);
+        BEDIntervalIndex index(v_bed);
+        benchmark::DoNotOptimize(index.size());
+    }
+}
+BENCHMARK(BM_reparse_and_rebuild)->Iterations(5)->Unit(benchmark::kMillisecond);
+
+static void BM_tail_poll(benchmark::State& state)
+{
+    write_base();
+    batch();
+    BEDTailReader<BED6Tuple> reader(path);
+    BEDIntervalIndex index;
+    reader.poll(index);
+
+    for(auto _: state)
+    {
+        state.PauseTiming();
+        std::ofstream(path, std::ios::app) << batch();
+        state.ResumeTiming();
+
+        benchmark::DoNotOptimize(reader.poll(index));
+    }
+}
+BENCHMARK(BM_tail_poll)->Iterations(20)->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,85 @@
+#include <benchmark/benchmark.h>
+#include <boost/algorithm/string/classification.hpp>
+#include <boost/algorithm/string/split.hpp>
+#include <boost/spirit/include/qi.hpp>
+#include <Biovoltron/format/bed.hpp>
+#include "bed_generator.hpp"
+using namespace biovoltron::format;
+
+using BED12Tuple = std::tuple <std::string, uint32_t, uint32_t, std::string, uint16_t, char, uint32_t, uint32_t,
+                              uint32_t, uint16_t, std::vector<uint32_t>, std::vector<uint32_t> >;
+
+static std::vector<std::string> bed12_lines()
+{
+    std::vector<std::string> lines;
+    std::string data = bed::bench::generate(bed::bench::Kind::BED12, 100000);
+    boost::split( lines, data, boost::is_any_of( "\n" ));
+    lines.pop_back();
+    return lines;
+}
+
+// the boost::split / stoi / spirit path set_bed_data used before the tokenizer
+static void legacy_set_bed_data(const std::string& str, BED12Tuple& t)
+{
+    std::vector<std::string> split_str;
+    boost::split( split_str, str, boost::is_any_of( " \t" ), boost::token_compress_on );
+
+    std::get<0>(t) = split_str[0];
+    std::get<1>(t) = stoi(split_str[1]);
+    std::get<2>(t) = stoi(split_str[2]);
+    std::get<3>(t) = split_str[3];
+    std::get<4>(t) = stoi(split_str[4]);
+    std::get<5>(t) = split_str[5][0];
+    std::get<6>(t) = stoi(split_str[6]);
+    std::get<7>(t) = stoi(split_str[7]);
+    std::get<8>(t) = stoi(split_str[8]);
+    std::get<9>(t) = stoi(split_str[9]);
+    for(int i: { 10, 11 })
+    {
+        auto& list = i == 10 ? std::get<10>(t) : std::get<11>(t);
+        list.clear();
+        boost::spirit::qi::phrase_parse(split_str[i].begin(), split_str[i].end(),
+        boost::spirit::qi::int_ % ',', boost::spirit::ascii::space, list);
+    }
+}
+
+static void BM_legacy_BED12(benchmark::State& state)
+{
+    static const auto lines = bed12_lines();
+    BED12Tuple t;
+    std::size_t bytes = 0;
+
+    for(auto _: state)
+        for(auto& line: lines)
+        {
+            legacy_set_bed_data(line, t);
+            benchmark::DoNotOptimize(t);
+            bytes += line.size();
+        }
+
+    state.SetItemsProcessed(state.iterations() * lines.size());
+    state.SetBytesProcessed(bytes);
+}
+
+static void BM_set_bed_data_BED12(benchmark::State& state)
+{
+    static const auto lines = bed12_lines();
+    BED<BED12Tuple> bed;
+    std::size_t bytes = 0;
+
+    for(auto _: state)
+        for(auto& line: lines)
+        {
+            bed.set_bed_data(line);
+            benchmark::DoNotOptimize(bed.data);
+            bytes += line.size();
+        }
+
+    state.SetItemsProcessed(state.iterations() * lines.size());
+    state.SetBytesProcessed(bytes);
+}
+
+BENCHMARK(BM_legacy_BED12)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_set_bed_data_BED12)->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,44 @@
+// Validation scan vs full parsing of the same BED12 text.
+#include <benchmark/benchmark.h>
+#include <Biovoltron/format/bed/parallel_parser.hpp>
+#include <Biovoltron/format/bed/validator.hpp>
+#include "bed_generator.hpp"
+using namespace biovoltron::format;
+
+using BED12Tuple = std::tuple <std::string, uint32_t, uint32_t, std::string, uint16_t, char, uint32_t, uint32_t,
+                              uint32_t, uint16_t, std::vector<uint32_t>, std::vector<uint32_t> >;
+
+static const std::string& data()
+{
+    static const std::string d = bed::bench::generate(bed::bench::Kind::BED12, 1000000);
+    return d;
+}
+
+static void BM_validate(benchmark::State& state)
+{
+    BEDValidator validator(state.range(0));
+    data();
+    for(auto _: state)
+    {
+        auto violations = validator.validate(data());
+        benchmark::DoNotOptimize(violations.data());
+    }
+    state.SetBytesProcessed(state.iterations() * data().size());
+}
+
+static void BM_parse(benchmark::State& state)
+{
+    BEDParallelParser<BED12Tuple> parser(state.range(0));
+    data();
+    for(auto _: state)
+    {
+        auto v_bed = parser.parse(data());
+        benchmark::DoNotOptimize(v_bed.data());
+    }
+    state.SetBytesProcessed(state.iterations() * data().size());
+}
+
+BENCHMARK(BM_validate)->Arg(1)->Arg(8)->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_parse)->Arg(1)->Arg(8)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
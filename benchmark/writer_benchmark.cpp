@@ -0,0 +1,58 @@
+#include <benchmark/benchmark.h>
+#include <Biovoltron/format/bed/parallel_parser.hpp>
+#include <Biovoltron/format/bed/writer.hpp>
+#include "bed_generator.hpp"
+using namespace biovoltron::format;
+
+using BED12Tuple = std::tuple <std::string, uint32_t, uint32_t, std::string, uint16_t, char, uint32_t, uint32_t,
+                              uint32_t, uint16_t, std::vector<uint32_t>, std::vector<uint32_t> >;
+
+static const std::vector<BEDRecord<BED12Tuple>>& records()
+{
+    static const auto v_bed = BEDParallelParser<BED12Tuple>(1).parse(
+                                  bed::bench::generate(bed::bench::Kind::BED12, 200000));
+    return v_bed;
+}
+
+// one std::string per record, written through operator<< (the former dump)
+static void BM_to_string_stream(benchmark::State& state)
+{
+    auto& v_bed = records();
+    std::size_t bytes = 0;
+
+    for(auto _: state)
+    {
+        std::ostringstream oss;
+        for(auto& bed: v_bed)
+            oss << bed.to_string() << "\n";
+        bytes += oss.tellp();
+    }
+
+    state.SetItemsProcessed(state.iterations() * v_bed.size());
+    state.SetBytesProcessed(bytes);
+}
+
+static void BM_writer(benchmark::State& state)
+{
+    auto& v_bed = records();
+    std::size_t bytes = 0;
+
+    for(auto _: state)
+    {
+        std::ostringstream oss;
+        {
+            BEDWriter<BED12Tuple> writer(oss, BEDWriter<BED12Tuple>::default_buffer_size, state.range(0));
+            for(auto& bed: v_bed)
+                writer.write(bed);
+        }
+        bytes += oss.tellp();
+    }
+
+    state.SetItemsProcessed(state.iterations() * v_bed.size());
+    state.SetBytesProcessed(bytes);
+}
+
+BENCHMARK(BM_to_string_stream)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_writer)->Arg(0)->Arg(1)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -1,8 +1,27 @@
 #include <boost/filesystem.hpp>
 #include <Biovoltron/format/bed.hpp>
+#include <Biovoltron/format/bed/mmap_reader.hpp>
+#include <Biovoltron/format/bed/table.hpp>
+#include <Biovoltron/format/bed/parallel_parser.hpp>
+#include <Biovoltron/format/bed/file.hpp>
+#include <Biovoltron/format/bed/interval_index.hpp>
+#include <Biovoltron/format/bed/binary.hpp>
+#include <Biovoltron/format/bed/gzip_reader.hpp>
+#include <Biovoltron/format/bed/sorter.hpp>
+#include <Biovoltron/format/bed/set_ops.hpp>
+#include <Biovoltron/format/bed/coverage.hpp>
+#include <Biovoltron/format/bed/arena.hpp>
+#include <Biovoltron/format/bed/validator.hpp>
+#include <Biovoltron/format/bed/closest.hpp>
+#include <Biovoltron/format/bed/blocks.hpp>
+#include <Biovoltron/format/bed/filter.hpp>
+#include <Biovoltron/format/bed/line_index.hpp>
+#include <Biovoltron/format/bed/partition.hpp>
+#include <Biovoltron/format/bed/tail_reader.hpp>
 #include <Nucleona/app/cli/gtest.hpp>
 #include <Nucleona/test/data_dir.hpp>
 #include <Nucleona/sys/executable_dir.hpp>
+#include <random>
 using namespace biovoltron::format;
 
 // header
@@ -39,6 +58,18 @@ std::string file_BED12() {
     return (nucleona::test::data_dir() / "bed" / "12_column.bed").string();
 }
 
+std::string file_sorted_BED3() {   // 300 sorted BED3 lines on chr1 and chr2, with header
+    return (nucleona::test::data_dir() / "bed" / "sorted.bed").string();
+}
+
+std::string file_sorted_BED3_bgzf() {   // bgzip'd, with .tbi and .csi index
+    return (nucleona::test::data_dir() / "bed" / "sorted.bed.gz").string();
+}
+
+std::string file_sorted_BED3_gzip() {   // plain gzip, two members
+    return (nucleona::test::data_dir() / "bed" / "sorted_plain.bed.gz").string();
+}
+
 // complete BED
 std::string file_BED3_with_header() {         
     return (nucleona::test::data_dir() / "bed" / "3_column_with_header.bed").string();
@@ -234,3 +265,1534 @@ TEST (Header_and_BED, iostream)
     
     EXPECT_EQ( ans, oss.str());
 } 
+
+
+TEST (BEDMmapReader, BED3_with_header)
+{
+    using TupleType = std::tuple <std::string, uint32_t, uint32_t>;
+
+    BEDMmapReader<TupleType> reader(file_BED3_with_header());
+
+    EXPECT_EQ("ItemRGBDemo", reader.header().name);
+    EXPECT_TRUE(reader.header().item_RGB);
+
+    std::vector<BED<TupleType>> v_bed;
+    for(auto& view: reader)
+    {
+        EXPECT_EQ(3, view.size());
+        v_bed.emplace_back(view.to_bed());
+    }
+
+    ASSERT_EQ(3, v_bed.size());
+    EXPECT_EQ("chr1\t85000835\t85003645", v_bed[0].to_string());
+    EXPECT_EQ("chr1\t85153339\t85154239", v_bed[2].to_string());
+}
+
+TEST (BEDMmapReader, BED12)
+{
+    using TupleType = std::tuple <std::string, uint32_t, uint32_t, std::string, uint16_t, char, uint32_t, uint32_t,
+                                 uint32_t, uint16_t, std::vector<uint32_t>, std::vector<uint32_t> >;
+
+    BEDMmapReader<TupleType> reader(file_BED12());
+    auto it = reader.begin();
+    ASSERT_NE(reader.end(), it);
+
+    EXPECT_EQ("chr1",     (*it)[bed::Col::chrom]);
+    EXPECT_EQ("uc001aaa", (*it)[bed::Col::name]);
+
+    auto bed = it->to_bed();
+    std::vector<uint32_t> expected_block_sizes = { 354, 109, 1189 };
+
+    EXPECT_EQ(85000835,             std::get<bed::Col::chromStart>(bed.data));
+    EXPECT_EQ('+',                  std::get<bed::Col::strand>(bed.data));
+    EXPECT_EQ(expected_block_sizes, std::get<bed::Col::blockSizes>(bed.data));
+    EXPECT_EQ(reader.end(), ++it);
+}
+
+TEST (BEDTable, load)
+{
+    using TupleType = std::tuple <std::string, uint32_t, uint32_t>;
+
+    auto table = BEDTable<TupleType>::load(file_BED3_with_header());
+
+    std::vector<uint32_t> starts = { 85000835, 85100217, 85153339 };
+    std::vector<uint32_t> ends   = { 85003645, 85106585, 85154239 };
+
+    ASSERT_EQ(3, table.size());
+    EXPECT_EQ("ItemRGBDemo", table.header.name);
+    EXPECT_EQ(1, table.chrom_dict().size());
+    EXPECT_EQ(0, table.column<bed::Col::chrom>()[2]);
+    EXPECT_EQ("chr1", table.chrom(2));
+    EXPECT_EQ(starts, table.column<bed::Col::chromStart>());
+    EXPECT_EQ(ends,   table.column<bed::Col::chromEnd>());
+    EXPECT_EQ("chr1\t85100217\t85106585", table.get(1).to_string());
+}
+
+TEST (BEDTable, push_back)
+{
+    using TupleType = std::tuple <std::string, uint32_t, uint32_t, std::string, uint16_t, char, uint32_t, uint32_t,
+                                 uint32_t, uint16_t, std::vector<uint32_t>, std::vector<uint32_t> >;
+
+    std::string str1 = "chr1\t85000835\t85003645\tuc001aaa\t0\t+\t11873\t11873\t0\t3\t354,109,1189,\t0,739,1347,";
+    std::string str2 = "chr2\t1000\t5000\tcloneA\t960\t-\t1000\t5000\t0\t2\t567,488,\t0,3512,";
+    BED<TupleType> bed;
+    BEDTable<TupleType> table;
+
+    bed.set_bed_data(str1);
+    table.push_back(bed);
+    bed.set_bed_data(str2);
+    table.push_back(bed);
+    table.push_back(bed);
+
+    ASSERT_EQ(3, table.size());
+    EXPECT_EQ(2, table.chrom_dict().size());
+    EXPECT_EQ(1, table.column<bed::Col::chrom>()[2]);
+    EXPECT_EQ('-', table.column<bed::Col::strand>()[1]);
+    EXPECT_EQ(str1, table.get(0).to_string());
+    EXPECT_EQ(str2, table.get(2).to_string());
+}
+
+TEST (BEDParallelParser, load)
+{
+    using TupleType = std::tuple <std::string, uint32_t, uint32_t>;
+
+    BEDParallelParser<TupleType> parser(4);
+    BEDHeader h;
+    auto v_bed = parser.load(file_BED3_with_header(), h);
+
+    EXPECT_EQ("ItemRGBDemo", h.name);
+    ASSERT_EQ(3, v_bed.size());
+    EXPECT_EQ("chr1\t85000835\t85003645", v_bed[0].to_string());
+    EXPECT_EQ("chr1\t85100217\t85106585", v_bed[1].to_string());
+    EXPECT_EQ("chr1\t85153339\t85154239", v_bed[2].to_string());
+}
+
+TEST (BEDParallelParser, keep_order)
+{
+    using TupleType = std::tuple <std::string, uint32_t, uint32_t>;
+
+    std::string data;
+    for(int i = 0; i < 1000; i++)
+        data += "chr" + std::to_string(i % 7) + "\t" + std::to_string(i) + "\t" + std::to_string(i + 10) + "\n";
+
+    for(std::size_t thread_num: { 1, 3, 8 })
+    {
+        BEDParallelParser<TupleType> parser(thread_num);
+        auto v_bed = parser.parse(data);
+
+        ASSERT_EQ(1000, v_bed.size());
+        for(uint32_t i = 0; i < 1000; i++)
+            EXPECT_EQ(i, std::get<bed::Col::chromStart>(v_bed[i].data));
+    }
+}
+
+TEST (bed_tokenizer, split_fields)
+{
+    std::vector<std::string> lines = {
+        "chr1\t85000835\t85003645",
+        "chr1    85000835    85003645    uc001aaa    0   +   11873   11873   0   3   354,109,1189,   0,739,1347,",
+        "chr22 1000 5000 cloneA 960 + 1000 5000 0 2 567,488, 0,3512\t \t",
+        "\tchr1\t1\t2",
+        "",
+        "a_field_that_is_longer_than_thirty_two_bytes_without_delimiters\tx"
+    };
+
+    for(auto& line: lines)
+    {
+        std::vector<std::string> expected;
+        boost::split( expected, line, boost::is_any_of( " \t" ), boost::token_compress_on );
+
+        std::array<std::string_view, 16> fields;
+        auto n = bed::split_fields(line, fields);
+
+        ASSERT_EQ(expected.size(), n);
+        for(std::size_t i = 0; i < n; i++)
+            EXPECT_EQ(expected[i], fields[i]);
+    }
+
+    std::array<std::string_view, 3> fields;
+    EXPECT_EQ(3, bed::split_fields(lines[1], fields));
+    EXPECT_EQ("85003645", fields[2]);
+}
+
+TEST (bed_tokenizer, to_integral)
+{
+    EXPECT_EQ(85000835,   bed::to_integral<uint32_t>("85000835"));
+    EXPECT_EQ(4294967295, bed::to_integral<uint32_t>("4294967295"));
+    EXPECT_EQ(1234567890123456789ULL, bed::to_integral<uint64_t>("1234567890123456789"));
+    EXPECT_EQ(255,        bed::to_integral<uint32_t>("255,0,0"));
+    EXPECT_EQ(-12,        bed::to_integral<int32_t>("-12"));
+    EXPECT_EQ(7,          bed::to_integral<uint16_t>("+7"));
+
+    EXPECT_THROW(bed::to_integral<uint32_t>(""),           std::invalid_argument);
+    EXPECT_THROW(bed::to_integral<uint32_t>("chr1"),       std::invalid_argument);
+    EXPECT_THROW(bed::to_integral<uint16_t>("65536"),      std::out_of_range);
+    EXPECT_THROW(bed::to_integral<uint32_t>("4294967296"), std::out_of_range);
+
+    std::vector<uint32_t> list = { 1, 2 };
+    std::vector<uint32_t> expected = { 354, 109, 1189 };
+    bed::parse_list("354,109,1189,", list);
+    EXPECT_EQ(expected, list);
+    bed::parse_list("354,109,1189", list);
+    EXPECT_EQ(expected, list);
+}
+
+TEST (BEDWriter, same_as_to_string)
+{
+    using TupleType = std::tuple <std::string, uint32_t, uint32_t, std::string, uint32_t, char, uint32_t, uint32_t,
+                                 uint32_t, uint32_t, std::tuple<uint32_t, uint32_t, uint32_t>, std::vector<uint32_t> >;
+
+    std::vector<std::string> lines = {
+        "chr1\t85000835\t85003645\tuc001aaa\t0\t+\t11873\t11873\t0\t3\t354,109,1189,\t0,739,1347,",
+        "chr22\t1000\t5000\tcloneA\t960\t-\t1000\t5000\t0\t2\t567,488,0,\t0,3512,"
+    };
+
+    std::string expected;
+    std::vector<BED<TupleType>> v_bed(lines.size());
+    for(std::size_t i = 0; i < lines.size(); i++)
+    {
+        v_bed[i].set_bed_data(lines[i]);
+        expected += v_bed[i].to_string() + "\n";
+    }
+
+    for(bool background: { false, true })
+    {
+        std::ostringstream oss;
+        {
+            BEDWriter<TupleType> writer(oss, 16, background);
+            for(int n = 0; n < 100; n++)
+                for(auto& bed: v_bed)
+                    writer << bed;
+        }
+
+        std::string ans;
+        for(int n = 0; n < 100; n++)
+            ans += expected;
+        EXPECT_EQ(ans, oss.str());
+    }
+}
+
+TEST (BEDWriter, dump)
+{
+    using TupleType = std::tuple <std::string, uint32_t, uint32_t>;
+
+    std::ifstream ifs(file_BED3_with_header());
+    BEDHeader h;
+    BED< TupleType> bed;
+    std::vector<BED< TupleType>> v_bed;
+
+    ifs>>h;
+    while(BED< TupleType>::get_obj(ifs, bed))
+    {
+        bed.header = h;
+        v_bed.emplace_back(std::move(bed));
+    }
+
+    std::ostringstream expected, oss;
+    BED< TupleType>::dump(expected, v_bed);
+    {
+        BEDWriter<TupleType> writer(oss);
+        writer.write_header(h);
+        for(auto& bed: v_bed)
+            writer.write(bed);
+    }
+
+    EXPECT_EQ(expected.str(), oss.str());
+}
+
+TEST (BEDFile, iostream)
+{
+    using TupleType = std::tuple <std::string, uint32_t, uint32_t>;
+
+    std::string ans = "track name=\"ItemRGBDemo\" description=\"Item RGB demonstration\" visibility=2 itemRgb=\"On\"\nchr1\t85000835\t85003645\nchr1\t85100217\t85106585\nchr1\t85153339\t85154239\n";
+
+    std::ifstream ifs(file_BED3_with_header());
+    BEDFile<TupleType> file;
+    ifs >> file;
+
+    EXPECT_EQ("ItemRGBDemo", file.header.name);
+    ASSERT_EQ(3, file.size());
+    EXPECT_EQ(85100217, std::get<bed::Col::chromStart>(file[1].data));
+
+    std::ostringstream oss;
+    oss << file;
+    EXPECT_EQ(ans, oss.str());
+
+    // reading again replaces the records and the header
+    std::istringstream again("chr2\t10\t20\n");
+    again >> file;
+    EXPECT_TRUE(file.header.track_line.empty());
+    ASSERT_EQ(1, file.size());
+    EXPECT_EQ("chr2", std::get<bed::Col::chrom>(file[0].data));
+
+    auto loaded = BEDFile<TupleType>::load(file_BED3_with_header(), 2);
+    std::ostringstream oss2;
+    oss2 << loaded;
+    EXPECT_EQ(ans, oss2.str());
+    EXPECT_LT(sizeof(BEDRecord<TupleType>), sizeof(BED<TupleType>));
+}
+
+TEST (BEDIntervalIndex, query)
+{
+    using TupleType = std::tuple <std::string, uint32_t, uint32_t>;
+
+    std::vector<BEDRecord<TupleType>> v_bed;
+    std::mt19937 rng(7);
+    for(int i = 0; i < 5000; i++)
+    {
+        uint32_t start = rng() % 100000;
+        v_bed.emplace_back();
+        v_bed.back().data = std::make_tuple(i % 3 ? "chr1" : "chr2", start, start + 1 + rng() % 3000);
+    }
+
+    BEDIntervalIndex index(v_bed);
+    EXPECT_EQ(5000, index.size());
+
+    std::vector<bed::Region> regions;
+    for(int q = 0; q < 200; q++)
+    {
+        uint32_t start = rng() % 110000;
+        regions.push_back({ q % 4 ? "chr1" : "chr2", start, static_cast<uint32_t>(start + rng() % 500) });
+    }
+    regions.push_back({ "chrX", 0, 100000 });
+
+    auto batch = index.query(regions, 3);
+    ASSERT_EQ(regions.size() + 1, batch.offsets.size());
+
+    for(std::size_t q = 0; q < regions.size(); q++)
+    {
+        std::vector<std::size_t> expected;
+        for(std::size_t i = 0; i < v_bed.size(); i++)
+        {
+            auto& [ chrom, start, end ] = v_bed[i].data;
+            if(regions[q].overlaps(chrom, start, end))
+                expected.push_back(i);
+        }
+
+        auto ids = index.query(regions[q]);
+        std::sort(ids.begin(), ids.end());
+        EXPECT_EQ(expected, ids);
+
+        std::vector<std::size_t> batch_ids(batch.ids.begin() + batch.offsets[q], batch.ids.begin() + batch.offsets[q + 1]);
+        std::sort(batch_ids.begin(), batch_ids.end());
+        EXPECT_EQ(expected, batch_ids);
+    }
+}
+
+TEST (BEDIntervalIndex, table)
+{
+    using TupleType = std::tuple <std::string, uint32_t, uint32_t>;
+
+    auto table = BEDTable<TupleType>::load(file_BED3());
+    BEDIntervalIndex index(table);
+
+    std::vector<std::size_t> expected = { 1, 2 };
+    EXPECT_EQ(expected, index.query(bed::Region::parse("chr1:85106000-85153340")));
+    EXPECT_TRUE(index.query("chr1", 85003645, 85100217).empty());
+}
+
+TEST (BEDBinary, write_and_read)
+{
+    using TupleType = std::tuple <std::string, uint32_t, uint32_t, std::string, uint16_t, char, uint32_t, uint32_t,
+                                 uint32_t, uint16_t, std::tuple<uint32_t, uint32_t>, std::vector<uint32_t> >;
+
+    std::vector<std::string> lines = {
+        "chr2\t2000\t6000\tcloneB\t900\t-\t2000\t6000\t0\t2\t433,399,\t0,3601,",
+        "chr1\t85000835\t85003645\tuc001aaa\t0\t+\t11873\t11873\t0\t3\t354,109,\t0,739,1347,",
+        "chr2\t1000\t5000\tcloneA\t960\t+\t1000\t5000\t0\t2\t567,488,\t0,3512,"
+    };
+
+    BEDFile<TupleType> file;
+    file.header.track_line = "track name=pairedReads description=\"Clone Paired Reads\" useScore=1";
+    for(auto& line: lines)
+    {
+        file.records.emplace_back();
+        file.records.back().set_bed_data(line);
+    }
+
+    auto path = (boost::filesystem::temp_directory_path() / boost::filesystem::unique_path()).string();
+    BEDBinaryWriter<TupleType>::write(path, file.records, file.header);
+
+    {
+        BEDBinaryReader<TupleType> reader(path);
+
+        // grouped by chrom (first seen first), sorted by chromStart
+        ASSERT_EQ(3, reader.size());
+        EXPECT_EQ("pairedReads", reader.header().name);
+        EXPECT_EQ(lines[2], reader.get(0).to_string());
+        EXPECT_EQ(lines[0], reader.get(1).to_string());
+        EXPECT_EQ(lines[1], reader.get(2).to_string());
+
+        EXPECT_EQ(1000, reader.column<bed::Col::chromStart>()[0]);
+        EXPECT_EQ("cloneB", reader.field<bed::Col::name>(1));
+        EXPECT_EQ(3, reader.field<bed::Col::blockStarts>(2).size());
+
+        std::vector<std::size_t> expected = { 0, 1 };
+        EXPECT_EQ(expected, reader.query(bed::Region::parse("chr2:4000-4500")));
+        expected = { 1 };
+        EXPECT_EQ(expected, reader.query("chr2", 5000, 5001));
+        EXPECT_TRUE(reader.query("chrX", 0, 100).empty());
+
+        using BED3Reader = BEDBinaryReader<std::tuple <std::string, uint32_t, uint32_t>>;
+        EXPECT_THROW(BED3Reader bad(path), std::runtime_error);
+    }
+
+    // truncated or corrupt files throw instead of being read out of bounds
+    std::string bytes;
+    {
+        std::ifstream ifs(path, std::ios::binary);
+        bytes.assign(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+    }
+    auto bad_path = path + ".bad";
+    auto open_bad = [&](const std::string& content)
+    {
+        std::ofstream(bad_path, std::ios::binary | std::ios::trunc) << content;
+        BEDBinaryReader<TupleType> reader(bad_path);
+    };
+    for(std::size_t size = 0; size < bytes.size(); size++)
+        EXPECT_THROW(open_bad(bytes.substr(0, size)), std::runtime_error) << size;
+
+    auto corrupt = bytes;
+    uint64_t record_num = uint64_t(1) << 40;
+    std::memcpy(&corrupt[offsetof(bed::detail::FileHeader, record_num)], &record_num, sizeof(record_num));
+    EXPECT_THROW(open_bad(corrupt), std::runtime_error);
+
+    // rows are only checked when they are read
+    uint64_t column_offset, chrom_offset, name_offset;
+    std::memcpy(&column_offset, &bytes[offsetof(bed::detail::FileHeader, column_offset)], sizeof(uint64_t));
+    std::memcpy(&chrom_offset, &bytes[column_offset], sizeof(uint64_t));
+    std::memcpy(&name_offset, &bytes[column_offset + bed::Col::name * sizeof(uint64_t)], sizeof(uint64_t));
+    corrupt = bytes;
+    uint32_t chrom_id = 7;
+    std::memcpy(&corrupt[chrom_offset + sizeof(uint32_t)], &chrom_id, sizeof(chrom_id));
+    uint64_t name_end = 1000;
+    std::memcpy(&corrupt[name_offset + 2 * sizeof(uint64_t)], &name_end, sizeof(name_end));
+    std::ofstream(bad_path, std::ios::binary | std::ios::trunc) << corrupt;
+    {
+        BEDBinaryReader<TupleType> reader(bad_path);
+        EXPECT_EQ(lines[2], reader.get(0).to_string());
+        EXPECT_THROW(reader.get(1), std::runtime_error);
+        EXPECT_THROW(reader.field<bed::Col::name>(2), std::runtime_error);
+        EXPECT_EQ(lines[1].substr(0, 4), reader.field<bed::Col::chrom>(2));
+    }
+
+    boost::filesystem::remove(bad_path);
+    boost::filesystem::remove(path);
+}
+
+TEST (BEDGzipReader, read)
+{
+    using TupleType = std::tuple <std::string, uint32_t, uint32_t>;
+
+    BEDFile<TupleType> expected;
+    std::ifstream ifs(file_sorted_BED3());
+    ifs >> expected;
+
+    for(auto path: { file_sorted_BED3_bgzf(), file_sorted_BED3_gzip() })
+    {
+        BEDGzipReader<TupleType> reader(path, 3);
+        EXPECT_EQ(path == file_sorted_BED3_bgzf(), reader.is_bgzf());
+        EXPECT_EQ("BgzfDemo", reader.header().name);
+
+        BEDRecord<TupleType> bed;
+        std::size_t n = 0;
+        while(reader.read(bed))
+        {
+            ASSERT_LT(n, expected.size());
+            EXPECT_EQ(expected[n++].data, bed.data);
+        }
+        EXPECT_EQ(expected.size(), n);
+    }
+}
+
+TEST (BEDGzipReader, truncated)
+{
+    using TupleType = std::tuple <std::string, uint32_t, uint32_t>;
+    namespace fs = boost::filesystem;
+    auto path = (fs::temp_directory_path() / fs::unique_path()).string() + ".bed.gz";
+
+    auto read_all = [&](const std::string& content)
+    {
+        std::ofstream(path, std::ios::binary | std::ios::trunc) << content;
+        BEDGzipReader<TupleType> reader(path);
+        BEDRecord<TupleType> bed;
+        std::size_t n = 0;
+        while(reader.read(bed))
+            n++;
+        return n;
+    };
+
+    for(auto fixture: { file_sorted_BED3_bgzf(), file_sorted_BED3_gzip() })
+    {
+        std::string bytes;
+        {
+            std::ifstream ifs(fixture, std::ios::binary);
+            bytes.assign(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+        }
+        EXPECT_LT(0u, read_all(bytes));
+        EXPECT_THROW(read_all(bytes.substr(0, bytes.size() / 2)), std::runtime_error) << fixture;
+        EXPECT_THROW(read_all(bytes.substr(0, bytes.size() - 10)), std::runtime_error) << fixture;
+    }
+
+    // BGZF cut at a block boundary: only the missing EOF block tells
+    std::string bytes;
+    {
+        std::ifstream ifs(file_sorted_BED3_bgzf(), std::ios::binary);
+        bytes.assign(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+    }
+    EXPECT_THROW(read_all(bytes.substr(0, bytes.size() - 28)), std::runtime_error);
+
+    fs::remove(path);
+}
+
+TEST (BEDGzipReader, query)
+{
+    using TupleType = std::tuple <std::string, uint32_t, uint32_t>;
+    namespace fs = boost::filesystem;
+
+    BEDFile<TupleType> expected;
+    std::ifstream ifs(file_sorted_BED3());
+    ifs >> expected;
+
+    // a copy with only the .csi index next to it
+    auto dir = fs::temp_directory_path() / fs::unique_path();
+    fs::create_directories(dir);
+    fs::copy_file(file_sorted_BED3_bgzf(), dir / "sorted.bed.gz");
+    fs::copy_file(file_sorted_BED3_bgzf() + ".csi", dir / "sorted.bed.gz.csi");
+
+    std::vector<std::string> regions = { "chr1:0-1", "chr1:15000-17000", "chr1:150000-300000", "chr2:0-1000000",
+                                         "chr2:50008-50009", "chr1:199000-200000", "chr3:0-100" };
+
+    for(auto path: { file_sorted_BED3_bgzf(), (dir / "sorted.bed.gz").string() })
+    {
+        BEDGzipReader<TupleType> reader(path);
+        for(auto& str: regions)
+        {
+            auto region = bed::Region::parse(str);
+            std::vector<TupleType> ans, got;
+            for(auto& bed: expected)
+            {
+                auto& [ chrom, start, end ] = bed.data;
+                if(region.overlaps(chrom, start, end))
+                    ans.push_back(bed.data);
+            }
+            for(auto& bed: reader.query(region))
+                got.push_back(bed.data);
+
+            EXPECT_EQ(ans, got) << str;
+        }
+    }
+
+    fs::remove_all(dir);
+    BEDGzipReader<TupleType> plain(file_sorted_BED3_gzip());
+    EXPECT_THROW(plain.query(bed::Region::parse("chr1")), std::runtime_error);
+}
+
+TEST (BEDSorter, sort)
+{
+    using TupleType = std::tuple <std::string, uint32_t, uint32_t, std::string>;
+
+    std::string header = "track name=\"SortDemo\"\n";
+    std::vector<TupleType> expected;
+    std::string data;
+    std::mt19937 rng(11);
+    for(int i = 0; i < 3000; i++)
+    {
+        std::string chrom = "chr" + std::to_string(1 + rng() % 12);
+        uint32_t start = rng() % 5000;
+        uint32_t end = start + rng() % 100;
+        std::string name = "r" + std::to_string(i);
+        expected.emplace_back(chrom, start, end, name);
+        data += chrom + "\t" + std::to_string(start) + "\t" + std::to_string(end) + "\t" + name + "\n";
+    }
+    std::stable_sort(expected.begin(), expected.end(), [](auto& a, auto& b)
+    {
+        return std::tie(std::get<0>(a), std::get<1>(a), std::get<2>(a))
+             < std::tie(std::get<0>(b), std::get<1>(b), std::get<2>(b));
+    });
+
+    // all in memory, then with a budget forcing many spilled runs
+    for(std::size_t budget: { std::size_t(1) << 30, std::size_t(4096) })
+    {
+        BEDSorter<TupleType>::Options options;
+        options.memory_budget = budget;
+        options.thread_num = 3;
+        options.temp_dir = boost::filesystem::temp_directory_path().string();
+
+        std::istringstream iss(header + data);
+        std::ostringstream oss;
+        BEDSorter<TupleType>(options).sort(iss, oss);
+
+        std::istringstream result(oss.str());
+        BEDFile<TupleType> file;
+        result >> file;
+
+        EXPECT_EQ("SortDemo", file.header.name);
+        ASSERT_EQ(expected.size(), file.size());
+        for(std::size_t i = 0; i < expected.size(); i++)
+            EXPECT_EQ(expected[i], file[i].data);
+    }
+
+    std::istringstream iss(data);
+    BEDFile<TupleType> file;
+    iss >> file;
+    BEDSorter<TupleType>().sort(file.records);
+    for(std::size_t i = 0; i < expected.size(); i++)
+        EXPECT_EQ(expected[i], file[i].data);
+}
+
+TEST(bed_set_ops, merge_intersect_subtract_complement)
+{
+    using TupleType = std::tuple <std::string, uint32_t, uint32_t>;
+    auto collect = [](auto&& src)
+    {
+        std::vector<std::tuple<std::string, uint32_t, uint32_t>> out;
+        bed::for_each(src, [&](const bed::Interval& iv){ out.emplace_back(iv.chrom, iv.start, iv.end); });
+        return out;
+    };
+    using Out = std::vector<std::tuple<std::string, uint32_t, uint32_t>>;
+
+    std::string a = "track name=A\n"
+                    "chr1\t100\t200\n"
+                    "chr1\t150\t300\n"
+                    "chr1\t310\t400\n"
+                    "chr1\t1000\t1100\n"
+                    "chr2\t0\t50\n";
+    std::string b = "chr1\t0\t120\n"
+                    "chr1\t180\t190\n"
+                    "chr1\t350\t2000\n"
+                    "chr10\t0\t10\n"
+                    "chr2\t40\t45\n";
+
+    {
+        std::istringstream ia(a);
+        EXPECT_EQ((Out{ { "chr1", 100, 300 }, { "chr1", 310, 400 }, { "chr1", 1000, 1100 }, { "chr2", 0, 50 } }),
+                  collect(bed::merge(bed::RecordSource<TupleType>(ia))));
+    }
+    {
+        std::istringstream ia(a);
+        EXPECT_EQ((Out{ { "chr1", 100, 400 }, { "chr1", 1000, 1100 }, { "chr2", 0, 50 } }),
+                  collect(bed::merge(bed::RecordSource<TupleType>(ia), 10)));
+    }
+    {
+        std::istringstream ia(a), ib(b);
+        EXPECT_EQ((Out{ { "chr1", 100, 120 }, { "chr1", 180, 190 }, { "chr1", 180, 190 },
+                        { "chr1", 350, 400 }, { "chr1", 1000, 1100 }, { "chr2", 40, 45 } }),
+                  collect(bed::intersect(bed::RecordSource<TupleType>(ia), bed::RecordSource<TupleType>(ib))));
+    }
+    {
+        std::istringstream ia(a), ib(b);
+        EXPECT_EQ((Out{ { "chr1", 120, 180 }, { "chr1", 150, 180 }, { "chr1", 190, 200 }, { "chr1", 190, 300 },
+                        { "chr1", 310, 350 }, { "chr2", 0, 40 }, { "chr2", 45, 50 } }),
+                  collect(bed::subtract(bed::RecordSource<TupleType>(ia), bed::RecordSource<TupleType>(ib))));
+    }
+    {
+        std::istringstream ia(a);
+        EXPECT_EQ((Out{ { "chr1", 0, 100 }, { "chr1", 300, 310 }, { "chr1", 400, 1000 }, { "chr1", 1100, 5000 },
+                        { "chr10", 0, 700 }, { "chr2", 50, 800 } }),
+                  collect(bed::complement(bed::RecordSource<TupleType>(ia),
+                                          { { "chr2", 800 }, { "chr1", 5000 }, { "chr10", 700 } })));
+    }
+
+    {
+        // records past the end of a chromosome leave no gap behind them
+        std::istringstream ia("chr1\t50\t150\nchr1\t150\t200\nchr1\t300\t400\nchr2\t150\t200\n");
+        EXPECT_EQ((Out{ { "chr1", 0, 50 }, { "chr2", 0, 100 } }),
+                  collect(bed::complement(bed::RecordSource<TupleType>(ia), { { "chr1", 100 }, { "chr2", 100 } })));
+    }
+
+    // pipelines over in-memory records, written back as BED3
+    std::istringstream ia(a);
+    BEDFile<TupleType> file;
+    ia >> file;
+    std::istringstream ib(b);
+    auto pipeline = bed::subtract(bed::merge(bed::range_source(file.records)), bed::RecordSource<TupleType>(ib));
+    std::ostringstream oss;
+    bed::write(pipeline, oss);
+    EXPECT_EQ("chr1\t120\t180\nchr1\t190\t300\nchr1\t310\t350\nchr2\t0\t40\nchr2\t45\t50\n", oss.str());
+
+    std::istringstream unsorted("chr2\t0\t10\nchr1\t0\t10\n");
+    auto src = bed::RecordSource<TupleType>(unsorted);
+    EXPECT_THROW(collect(bed::merge(std::move(src))), std::runtime_error);
+}
+
+TEST(bed_set_ops, chained_operators)
+{
+    using TupleType = std::tuple <std::string, uint32_t, uint32_t>;
+    using Out = std::vector<std::tuple<std::string, uint32_t, uint32_t>>;
+    auto collect = [](auto&& src)
+    {
+        Out out;
+        bed::for_each(src, [&](const bed::Interval& iv){ out.emplace_back(iv.chrom, iv.start, iv.end); });
+        return out;
+    };
+    auto source = [](std::istringstream& is, const std::string& text)
+    {
+        is.str(text);
+        return bed::RecordSource<TupleType>(is);
+    };
+
+    // overlapping A intervals still give sorted output
+    std::string a = "chr1\t0\t100\nchr1\t5\t30\nchr2\t0\t10\n";
+    std::string b = "chr1\t20\t25\nchr1\t50\t60\nchr2\t5\t8\n";
+    std::string c = "chr1\t22\t23\nchr2\t0\t6\n";
+    {
+        std::istringstream ia, ib;
+        EXPECT_EQ((Out{ { "chr1", 20, 25 }, { "chr1", 20, 25 }, { "chr1", 50, 60 }, { "chr2", 5, 8 } }),
+                  collect(bed::intersect(source(ia, a), source(ib, b))));
+    }
+    {
+        std::istringstream ia, ib;
+        EXPECT_EQ((Out{ { "chr1", 0, 20 }, { "chr1", 5, 20 }, { "chr1", 25, 30 }, { "chr1", 25, 50 },
+                        { "chr1", 60, 100 }, { "chr2", 0, 5 }, { "chr2", 8, 10 } }),
+                  collect(bed::subtract(source(ia, a), source(ib, b))));
+    }
+    {
+        std::istringstream ia, ib, ic;
+        EXPECT_EQ((Out{ { "chr1", 20, 22 }, { "chr1", 20, 22 }, { "chr1", 23, 25 }, { "chr1", 23, 25 },
+                        { "chr1", 50, 60 }, { "chr2", 6, 8 } }),
+                  collect(bed::subtract(bed::intersect(source(ia, a), source(ib, b)), source(ic, c))));
+    }
+    {
+        std::istringstream ia, ib, ic;
+        EXPECT_EQ((Out{ { "chr2", 0, 5 } }),
+                  collect(bed::intersect(bed::merge(bed::subtract(source(ia, a), source(ib, b))), source(ic, c))));
+    }
+    {
+        std::istringstream ia, ib, ic;
+        EXPECT_EQ((Out{ { "chr1", 22, 23 }, { "chr2", 5, 6 } }),
+                  collect(bed::intersect(source(ic, c), bed::merge(bed::intersect(source(ia, a), source(ib, b))))));
+    }
+
+    // a source that is not sorted is caught by the operator it feeds
+    std::vector<BEDRecord<TupleType>> unsorted(2);
+    unsorted[0].data = { "chr1", 50, 60 };
+    unsorted[1].data = { "chr1", 10, 20 };
+    std::istringstream ib;
+    EXPECT_THROW(collect(bed::intersect(bed::range_source(unsorted), source(ib, b))), std::runtime_error);
+}
+
+TEST(BEDCoverage, bedgraph)
+{
+    using TupleType = std::tuple <std::string, uint32_t, uint32_t>;
+    std::istringstream iss("chr2\t10\t20\n"
+                           "chr1\t100\t200\n"
+                           "chr1\t150\t250\n"
+                           "chr10\t0\t5\n"
+                           "chr1\t200\t300\n"
+                           "chr1\t400\t400\n");
+    BEDFile<TupleType> file;
+    iss >> file;
+
+    for(std::size_t threads: { 1, 2, 4 })
+    {
+        std::ostringstream oss;
+        BEDCoverage<TupleType>(threads).write_bedgraph(file.records, oss);
+        EXPECT_EQ("chr1\t100\t150\t1\n"
+                  "chr1\t150\t250\t2\n"
+                  "chr1\t250\t300\t1\n"
+                  "chr10\t0\t5\t1\n"
+                  "chr2\t10\t20\t1\n", oss.str());
+    }
+
+    // BED12 blocks are counted on their own unless use_blocks is off
+    using BED12Tuple = std::tuple <std::string, uint32_t, uint32_t, std::string, uint16_t, char,
+                                   uint32_t, uint32_t, std::tuple<uint8_t, uint8_t, uint8_t>,
+                                   uint16_t, std::vector<uint32_t>, std::vector<uint32_t>>;
+    std::istringstream iss12("chr1\t1000\t2000\tgene\t0\t+\t1000\t2000\t0,0,0\t2\t100,200,\t0,800,\n"
+                             "chr1\t1050\t1250\tread\t0\t+\t1050\t1250\t0,0,0\t1\t200,\t0,\n");
+    BEDFile<BED12Tuple> file12;
+    iss12 >> file12;
+
+    std::vector<bed::CoverageRun> runs;
+    BEDCoverage<BED12Tuple>(2).compute(file12.records, [&](std::string_view chrom, const auto& r)
+    {
+        EXPECT_EQ("chr1", chrom);
+        runs = r;
+    });
+    EXPECT_EQ((std::vector<bed::CoverageRun>{ { 1000, 1050, 1 }, { 1050, 1100, 2 }, { 1100, 1250, 1 }, { 1800, 2000, 1 } }), runs);
+
+    BEDCoverage<BED12Tuple>(1, false).compute(file12.records, [&](std::string_view, const auto& r){ runs = r; });
+    EXPECT_EQ((std::vector<bed::CoverageRun>{ { 1000, 1050, 1 }, { 1050, 1250, 2 }, { 1250, 2000, 1 } }), runs);
+}
+
+TEST(BEDArenaFile, load)
+{
+    using TupleType = std::tuple <std::string, uint32_t, uint32_t, std::string, uint16_t, char,
+                                  uint32_t, uint32_t, std::tuple<uint8_t, uint8_t, uint8_t>,
+                                  uint16_t, std::vector<uint32_t>, std::vector<uint32_t>>;
+    std::string data;
+    for(int i = 0; i < 500; i++)
+        data += std::string(i % 100 == 0 ? "\n" : "") + "chr" + std::to_string(i % 3 + 1) + "\t" + std::to_string(i * 10) + "\t" + std::to_string(i * 10 + 300)
+              + "\tname" + std::to_string(i) + "\t" + std::to_string(i) + "\t+\t" + std::to_string(i * 10)
+              + "\t" + std::to_string(i * 10 + 300) + "\t255,0,0\t2\t100,50,\t0,250,\n";
+
+    BEDParallelParser<TupleType> parser(1);
+    auto expected = parser.parse(data);
+
+    for(std::size_t threads: { 1, 3 })
+    {
+        auto file = BEDArenaFile<TupleType>::parse(data, threads);
+        ASSERT_EQ(expected.size(), file.size());
+        EXPECT_EQ(3u, file.chrom_dict().size());
+        for(std::size_t i = 0; i < file.size(); i++)
+        {
+            EXPECT_EQ(expected[i].data, file.get(i).data);
+            EXPECT_EQ(std::get<0>(expected[i].data), file.chrom(i));
+            EXPECT_EQ(std::get<3>(expected[i].data), std::get<bed::Col::name>(file[i]));
+            EXPECT_EQ(2u, std::get<bed::Col::blockSizes>(file[i]).size());
+        }
+        EXPECT_GT(file.arena_bytes(), 0u);
+    }
+
+    auto file = BEDArenaFile<std::tuple <std::string, uint32_t, uint32_t>>::load(file_sorted_BED3(), 2);
+    EXPECT_EQ(300u, file.size());
+    EXPECT_EQ("chr2", file.chrom(299));
+    EXPECT_FALSE(file.header.name.empty());
+}
+
+TEST(BEDFile, block_span)
+{
+    using VectorTuple = std::tuple <std::string, uint32_t, uint32_t, std::string, uint16_t, char,
+                                    uint32_t, uint32_t, std::tuple<uint8_t, uint8_t, uint8_t>,
+                                    uint16_t, std::vector<uint32_t>, std::vector<uint32_t>>;
+    using SpanTuple = std::tuple <std::string, uint32_t, uint32_t, std::string, uint16_t, char,
+                                  uint32_t, uint32_t, std::tuple<uint8_t, uint8_t, uint8_t>,
+                                  uint16_t, bed::BlockSpan<uint32_t>, bed::BlockSpan<uint32_t>>;
+    static_assert(bed::BlockStore<SpanTuple>::enabled && !bed::BlockStore<VectorTuple>::enabled);
+
+    std::string text = "track name=Blocks\n";
+    for(int i = 0; i < 200; i++)
+    {
+        int n = 1 + i % 4;
+        std::string sizes, starts;
+        for(int b = 0; b < n; b++)
+        {
+            sizes += std::to_string(10 + b) + ",";
+            starts += std::to_string(b * 100) + ",";
+        }
+        text += "chr1\t" + std::to_string(i * 1000) + "\t" + std::to_string(i * 1000 + n * 100)
+              + "\ttx" + std::to_string(i) + "\t0\t-\t" + std::to_string(i * 1000) + "\t"
+              + std::to_string(i * 1000) + "\t0,0,255,\t" + std::to_string(n) + "\t" + sizes + "\t" + starts + "\n";
+    }
+
+    std::istringstream iss_vec(text), iss_span(text);
+    BEDFile<VectorTuple> vec;
+    BEDFile<SpanTuple> span;
+    iss_vec >> vec;
+    iss_span >> span;
+
+    ASSERT_EQ(vec.size(), span.size());
+    for(std::size_t i = 0; i < span.size(); i++)
+    {
+        auto& sizes = std::get<bed::Col::blockSizes>(span[i].data);
+        auto& starts = std::get<bed::Col::blockStarts>(span[i].data);
+        EXPECT_EQ(std::get<bed::Col::blockSizes>(vec[i].data), std::vector<uint32_t>(sizes.begin(), sizes.end()));
+        EXPECT_EQ(std::get<bed::Col::blockStarts>(vec[i].data), std::vector<uint32_t>(starts.begin(), starts.end()));
+        EXPECT_EQ(vec[i].to_string(), span[i].to_string());
+    }
+    EXPECT_EQ(500u, span.blocks().column<bed::Col::blockSizes>().values.size());
+
+    std::istringstream iss_again(text);
+    iss_again >> span;
+    ASSERT_EQ(vec.size(), span.size());
+    EXPECT_EQ(500u, span.blocks().column<bed::Col::blockSizes>().values.size());
+    EXPECT_EQ(vec.records.back().to_string(), span.records.back().to_string());
+
+    std::ostringstream oss;
+    oss << span;
+    EXPECT_EQ(text, oss.str());
+
+    // copies view their own storage
+    BEDFile<SpanTuple> copy = span;
+    span = BEDFile<SpanTuple>();
+    std::ostringstream oss_copy;
+    oss_copy << copy;
+    EXPECT_EQ(text, oss_copy.str());
+
+    boost::filesystem::path path = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+    std::ofstream(path.string()) << text;
+    for(std::size_t threads: { 1, 3 })
+    {
+        auto loaded = BEDFile<SpanTuple>::load(path.string(), threads);
+        std::ostringstream oss_loaded;
+        oss_loaded << loaded;
+        EXPECT_EQ(text, oss_loaded.str());
+    }
+    boost::filesystem::remove(path);
+}
+
+TEST(BEDRecord, projection)
+{
+    std::string line = "chr7\t127471196\t127495720\tPos1\t0\t+\t127471196\t127472363\t255,0,0\t2\t100,200,\t0,24324,";
+
+    static_assert(bed::parsed_columns<std::tuple<std::string, uint32_t, uint32_t, bed::Skip, bed::Skip>>() == 3);
+    static_assert(bed::parsed_columns<std::tuple<std::string, bed::Skip, uint32_t>>() == 3);
+
+    BEDRecord<std::tuple<std::string, uint32_t, uint32_t, bed::Skip, bed::Skip, char>> strand;
+    strand.set_bed_data(line);
+    EXPECT_EQ("chr7", std::get<bed::Col::chrom>(strand.data));
+    EXPECT_EQ(127495720u, std::get<bed::Col::chromEnd>(strand.data));
+    EXPECT_EQ('+', std::get<bed::Col::strand>(strand.data));
+    EXPECT_EQ("chr7\t127471196\t127495720\t.\t.\t+", strand.to_string());
+
+    using LazyTuple = std::tuple<std::string, uint32_t, uint32_t, bed::Skip, bed::Lazy<uint16_t>, bed::Skip,
+                                 bed::Skip, bed::Skip, bed::Lazy<std::tuple<uint8_t, uint8_t, uint8_t>>,
+                                 bed::Skip, bed::Lazy<std::vector<uint32_t>>, bed::Lazy<std::vector<uint32_t>>>;
+    BEDRecord<LazyTuple> lazy;
+    lazy.set_bed_data(line);
+    EXPECT_EQ("100,200,", std::get<bed::Col::blockSizes>(lazy.data).raw());
+    EXPECT_EQ((std::vector<uint32_t>{ 0, 24324 }), std::get<bed::Col::blockStarts>(lazy.data).get());
+    EXPECT_EQ(0, std::get<bed::Col::score>(lazy.data).get());
+    EXPECT_EQ(255, std::get<0>(std::get<bed::Col::itemRgb>(lazy.data).get()));
+
+    auto copy = lazy;
+    lazy.set_bed_data("chr1\t0\t10\tx\t7\t-\t0\t0\t0,0,0\t1\t10,\t0,");
+    EXPECT_EQ(7, std::get<bed::Col::score>(lazy.data).get());
+    EXPECT_EQ(0, std::get<bed::Col::score>(copy.data).get());
+
+    auto v_bed = BEDParallelParser<std::tuple<std::string, uint32_t, uint32_t, bed::Skip, bed::Skip, char>>(2)
+                     .parse(line + "\n" + line + "\n");
+    ASSERT_EQ(2u, v_bed.size());
+    EXPECT_EQ(strand.data, v_bed[1].data);
+}
+
+TEST(bed_stats, counters)
+{
+    using TupleType = std::tuple <std::string, uint32_t, uint32_t, std::string, uint16_t, char,
+                                  uint32_t, uint32_t, std::tuple<uint8_t, uint8_t, uint8_t>>;
+    bed::stats().reset();
+
+    std::istringstream iss("chr1\t10\t20\ta_rather_long_feature_name\t5\t+\t10\t20\t255,0,0\n"
+                           "chr1\t30\t40\tb\t5\t-\t30\t40\t0,0,255\n");
+    std::vector<BED<TupleType>> v_bed;
+    BED<TupleType> bed;
+    while(BED<TupleType>::get_obj(iss, bed))
+        v_bed.push_back(bed);
+    ASSERT_EQ(2u, v_bed.size());
+
+    std::ostringstream oss;
+    BED<TupleType>::dump(oss, v_bed);
+
+    BED<TupleType> bad;
+    EXPECT_THROW(bad.set_bed_data("chr1\tx\t20\tc\t5\t+\t10\t20\t0,y,0"), std::invalid_argument);
+    EXPECT_THROW(bad.set_bed_data("chr1\t10\t20\tc\t5\t+\t10\t20\t0,y,0"), std::invalid_argument);
+
+    auto& stats = bed::stats();
+    auto json = stats.to_json();
+    if constexpr(bed::stats_enabled)
+    {
+        EXPECT_EQ(2u, stats.lines_read());
+        EXPECT_EQ(iss.str().size(), stats.bytes_read());
+        EXPECT_EQ(2u, stats.lines_formatted());
+        EXPECT_EQ(oss.str().size(), stats.bytes_written());
+        EXPECT_EQ(2u, stats.stage_calls(bed::Stage::read) - 1);   // the failing getline at the end
+        EXPECT_EQ(4u, stats.stage_calls(bed::Stage::tokenize));
+        EXPECT_GE(stats.allocations(), 1u);
+        EXPECT_EQ(1u, stats.column_errors(bed::Col::chromStart));
+        EXPECT_EQ(1u, stats.column_errors(bed::Col::itemRgb));
+        EXPECT_NE(std::string::npos, json.find("\"enabled\":true"));
+    }
+    else
+    {
+        EXPECT_EQ(0u, stats.lines_read());
+        EXPECT_EQ(0u, stats.stage_calls(bed::Stage::convert));
+        EXPECT_NE(std::string::npos, json.find("\"enabled\":false"));
+    }
+    EXPECT_NE(std::string::npos, json.find("\"column_errors\":["));
+}
+
+TEST(BEDValidator, validate)
+{
+    std::string data = "track name=Check\n"                                                        // 1
+                       "\n"                                                                         // 2
+                       "chr1\t10\t20\tok\t0\t+\t10\t20\t0\t2\t5,5,\t0,5,\n"                   // 3
+                       "chr1\t30\t20\tbad_order\t1001\t*\t30\t20\t0\t2\t5,5,\t0,\n"           // 4
+                       "chr1\t1x\t20\tbad_number\t0\t-\t10\t20\t0\t1\t5,\t0,\n"               // 5
+                       "chr1\t10\n"                                                                // 6
+                       "# comment\n"                                                                // 7
+                       "chr1\t10\t20\tshort\t0\t.\n"                                            // 8
+                       "chr1\t10\t20\tok\t1000\t.\t10\t20\t255,0,0\t1\t10\t0";               // 9
+
+    using bed::Rule;
+    std::vector<std::tuple<Rule, uint64_t, int>> expected = {
+        { Rule::start_after_end, 4, 1 }, { Rule::score_range, 4, 4 }, { Rule::strand, 4, 5 }, { Rule::block_count, 4, 11 },
+        { Rule::invalid_number, 5, 1 },
+        { Rule::too_few_columns, 6, -1 },
+        { Rule::misplaced_header, 7, -1 },
+        { Rule::column_count, 8, -1 },
+    };
+
+    for(std::size_t threads: { 1, 2, 8 })
+    {
+        auto violations = BEDValidator(threads).validate(data);
+        ASSERT_EQ(expected.size(), violations.size());
+        for(std::size_t i = 0; i < expected.size(); i++)
+        {
+            EXPECT_EQ(expected[i], std::make_tuple(violations[i].rule, violations[i].line, violations[i].column));
+            auto offset = violations[i].offset;
+            EXPECT_EQ('\n', data[offset - 1]);
+            EXPECT_EQ(violations[i].line - 1, std::count(data.begin(), data.begin() + offset, '\n'));
+        }
+    }
+    EXPECT_EQ("line 4 (byte 56), column 2: start_after_end", BEDValidator(1).validate(data)[0].to_string());
+
+    EXPECT_TRUE(BEDValidator(2).validate_file(file_sorted_BED3()).empty());
+}
+
+TEST(BEDClosest, closest)
+{
+    using TupleType = std::tuple <std::string, uint32_t, uint32_t, std::string, uint16_t, char>;
+    auto make = [](std::string chrom, uint32_t s, uint32_t e, char strand)
+    {
+        BEDRecord<TupleType> r;
+        r.data = { chrom, s, e, "f", 0, strand };
+        return r;
+    };
+
+    std::vector<BEDRecord<TupleType>> genes = {
+        make("chr1", 100, 200, '+'),    // 0
+        make("chr1", 300, 400, '-'),    // 1
+        make("chr1", 300, 350, '+'),    // 2
+        make("chr1", 1000, 1100, '.'),  // 3
+        make("chr2", 50, 60, '+'),      // 4
+    };
+    BEDClosest index(genes);
+    using Hits = std::vector<BEDClosest::Hit>;
+
+    EXPECT_EQ((Hits{ { 0, 0 } }), index.closest("chr1", 150, 160));
+    EXPECT_EQ((Hits{ { 0, 50 }, { 1, 50 }, { 2, 50 } }), index.closest("chr1", 250, 250));
+    EXPECT_EQ((Hits{ { 0, 0 } }), index.closest("chr1", 200, 210));          // book-ended
+    EXPECT_EQ((Hits{ { 1, 0 }, { 2, 0 } }), index.closest("chr1", 320, 330));
+    EXPECT_EQ((Hits{}), index.closest("chr3", 0, 10));
+
+    BEDClosest::Options opts;
+    opts.ties = bed::TieMode::first;
+    EXPECT_EQ((Hits{ { 0, 50 } }), index.closest("chr1", 250, 250, '.', opts));
+    opts.ties = bed::TieMode::last;
+    EXPECT_EQ((Hits{ { 2, 50 } }), index.closest("chr1", 250, 250, '.', opts));
+
+    opts = BEDClosest::Options();
+    opts.strand = bed::StrandMode::same;
+    EXPECT_EQ((Hits{ { 1, 100 } }), index.closest("chr1", 500, 600, '-', opts));
+    EXPECT_EQ((Hits{ { 3, 400 } }), index.closest("chr1", 500, 600, '.', opts));
+    opts.strand = bed::StrandMode::opposite;
+    EXPECT_EQ((Hits{ { 2, 150 } }), index.closest("chr1", 500, 600, '-', opts));
+    EXPECT_EQ((Hits{}), index.closest("chr1", 500, 600, '.', opts));
+    opts.strand = bed::StrandMode::ignore;
+    opts.max_distance = 99;
+    EXPECT_EQ((Hits{}), index.closest("chr1", 500, 600, '.', opts));
+
+    // batches against a brute force answer, sorted and shuffled, on several threads
+    std::mt19937 rng(7);
+    std::vector<BEDRecord<TupleType>> features, peaks;
+    for(int i = 0; i < 300; i++)
+    {
+        uint32_t s = rng() % 100000;
+        features.push_back(make("chr" + std::to_string(1 + rng() % 3), s, s + rng() % 3000, "+-."[rng() % 3]));
+    }
+    for(int i = 0; i < 500; i++)
+    {
+        uint32_t s = rng() % 110000;
+        peaks.push_back(make("chr" + std::to_string(1 + rng() % 4), s, s + rng() % 500, "+-."[rng() % 3]));
+    }
+    BEDClosest random_index(features);
+
+    for(auto mode: { bed::StrandMode::ignore, bed::StrandMode::same, bed::StrandMode::opposite })
+        for(auto ties: { bed::TieMode::all, bed::TieMode::first })
+        {
+            BEDClosest::Options o;
+            o.strand = mode;
+            o.ties = ties;
+            o.max_distance = 20000;
+
+            std::vector<Hits> expected;
+            for(auto& p: peaks)
+            {
+                auto& [ pc, ps, pe, pn, psc, pst ] = p.data;
+                uint32_t qe = std::max(pe, ps + 1);   // overlap test of an empty query
+                Hits hits;
+                uint64_t best = UINT64_MAX;
+                for(uint32_t id = 0; id < features.size(); id++)
+                {
+                    auto& [ fc, fs, fe, fn, fsc, fst ] = features[id].data;
+                    if(fc != pc)
+                        continue;
+                    if(mode == bed::StrandMode::same && fst != pst)
+                        continue;
+                    if(mode == bed::StrandMode::opposite && !((pst == '+' && fst == '-') || (pst == '-' && fst == '+')))
+                        continue;
+                    uint64_t d = (fs < qe && ps < fe) ? 0 : fe <= ps ? ps - fe : fs - pe;
+                    if(d < best)
+                    {
+                        best = d;
+                        hits.clear();
+                    }
+                    if(d == best)
+                        hits.push_back({ id, uint32_t(d) });
+                }
+                if(best > o.max_distance)
+                    hits.clear();
+                if(ties == bed::TieMode::first && hits.size() > 1)
+                    hits.resize(1);
+                expected.push_back(hits);
+            }
+
+            auto sorted = peaks;
+            std::vector<std::size_t> order(peaks.size());
+            std::iota(order.begin(), order.end(), 0);
+            std::sort(order.begin(), order.end(), [&](auto a, auto b)
+            {
+                return std::get<1>(peaks[a].data) < std::get<1>(peaks[b].data);
+            });
+            for(std::size_t i = 0; i < order.size(); i++)
+                sorted[i] = peaks[order[i]];
+
+            for(std::size_t threads: { 1, 3 })
+            {
+                o.thread_num = threads;
+                auto result = random_index.closest(peaks, o);
+                auto result_sorted = random_index.closest(sorted, o);
+                for(std::size_t q = 0; q < peaks.size(); q++)
+                {
+                    EXPECT_EQ(expected[q], Hits(result.hits.begin() + result.offsets[q],
+                                                result.hits.begin() + result.offsets[q + 1]));
+                    EXPECT_EQ(expected[order[q]], Hits(result_sorted.hits.begin() + result_sorted.offsets[q],
+                                                       result_sorted.hits.begin() + result_sorted.offsets[q + 1]));
+                }
+            }
+        }
+}
+
+TEST(bed_blocks, exons_introns_and_coordinates)
+{
+    using VectorTuple = std::tuple <std::string, uint32_t, uint32_t, std::string, uint16_t, char,
+                                    uint32_t, uint32_t, std::tuple<uint8_t, uint8_t, uint8_t>,
+                                    uint16_t, std::vector<uint32_t>, std::vector<uint32_t>>;
+    using NestedTuple = std::tuple <std::string, uint32_t, uint32_t, std::string, uint16_t, char,
+                                    uint32_t, uint32_t, std::tuple<uint8_t, uint8_t, uint8_t>,
+                                    uint16_t, std::tuple<uint32_t, uint32_t, uint32_t, uint32_t>,
+                                    std::tuple<uint32_t, uint32_t, uint32_t, uint32_t>>;
+    using SpanTuple = std::tuple <std::string, uint32_t, uint32_t, std::string, uint16_t, char,
+                                  uint32_t, uint32_t, std::tuple<uint8_t, uint8_t, uint8_t>,
+                                  uint16_t, bed::BlockSpan<uint32_t>, bed::BlockSpan<uint32_t>>;
+
+    // exons [100,110) [150,170) [200,230); nested tuples are padded to 4 blocks
+    std::string text = "chr1\t100\t230\tplus\t0\t+\t100\t230\t0,0,0\t3\t10,20,30,0,\t0,50,100,0,\n"
+                       "chr2\t100\t230\tminus\t0\t-\t100\t230\t0,0,0\t3\t10,20,30,0,\t0,50,100,0,\n";
+    std::istringstream iss_vec(text), iss_nested(text), iss_span(text);
+    BEDFile<VectorTuple> vec;
+    BEDFile<NestedTuple> nested;
+    BEDFile<SpanTuple> span;
+    iss_vec >> vec;
+    iss_nested >> nested;
+    iss_span >> span;
+
+    auto check = [](const auto& file)
+    {
+        auto& plus = file.records[0].data;
+        auto& minus = file.records[1].data;
+
+        std::vector<std::pair<uint32_t, uint32_t>> exons, introns;
+        bed::for_each_exon(plus, [&](uint32_t s, uint32_t e){ exons.emplace_back(s, e); });
+        bed::for_each_intron(plus, [&](uint32_t s, uint32_t e){ introns.emplace_back(s, e); });
+        EXPECT_EQ(3u, bed::exon_count(plus));
+        EXPECT_EQ((std::vector<std::pair<uint32_t, uint32_t>>{ { 100, 110 }, { 150, 170 }, { 200, 230 } }), exons);
+        EXPECT_EQ((std::vector<std::pair<uint32_t, uint32_t>>{ { 110, 150 }, { 170, 200 } }), introns);
+        EXPECT_EQ(60u, bed::spliced_length(plus));
+
+        EXPECT_EQ(0u, bed::genome_to_transcript(plus, 100));
+        EXPECT_EQ(15u, bed::genome_to_transcript(plus, 155));
+        EXPECT_EQ(bed::no_position, bed::genome_to_transcript(plus, 120));
+        EXPECT_EQ(bed::no_position, bed::genome_to_transcript(plus, 230));
+        EXPECT_EQ(59u, bed::genome_to_transcript(minus, 100));
+        EXPECT_EQ(0u, bed::genome_to_transcript(minus, 229));
+
+        for(uint32_t t = 0; t < 60; t++)
+        {
+            EXPECT_EQ(t, bed::genome_to_transcript(plus, bed::transcript_to_genome(plus, t)));
+            EXPECT_EQ(t, bed::genome_to_transcript(minus, bed::transcript_to_genome(minus, t)));
+        }
+        EXPECT_EQ(bed::no_position, bed::transcript_to_genome(plus, 60));
+    };
+    check(vec);
+    check(nested);
+    check(span);
+
+    std::ostringstream oss;
+    bed::write_features(span.records, bed::Feature::intron, oss);
+    EXPECT_EQ("chr1\t110\t150\tplus\t0\t+\n"
+              "chr1\t170\t200\tplus\t1\t+\n"
+              "chr2\t110\t150\tminus\t0\t-\n"
+              "chr2\t170\t200\tminus\t1\t-\n", oss.str());
+
+    BEDIntervalIndex index;
+    bed::index_features(nested.records, bed::Feature::exon, index);
+    index.build();
+    EXPECT_EQ(6u, index.size());
+    EXPECT_EQ((std::vector<BEDIntervalIndex::id_type>{ 0 }), index.query("chr1", 160, 161));
+    EXPECT_TRUE(index.query("chr1", 120, 140).empty());
+
+    // BED3 records are one exon
+    using BED3 = std::tuple <std::string, uint32_t, uint32_t>;
+    BED3 bed3{ "chr1", 10, 20 };
+    EXPECT_EQ(10u, bed::spliced_length(bed3));
+    EXPECT_EQ(5u, bed::genome_to_transcript(bed3, 15));
+}
+
+TEST(BEDFilter, predicate)
+{
+    // score is kept as text so the "." line converts; the predicate still reads it as a number
+    using TupleType = std::tuple <std::string, uint32_t, uint32_t, std::string, std::string, char>;
+    std::string text = "track name=Filter\n"
+                       "chr1\t100\t200\ta\t900\t+\n"
+                       "chr10\t100\t200\tb\t900\t+\n"
+                       "chr1\t300\t400\tc\t100\t-\n"
+                       "chr2\t100\t200\td\t700\t-\n"
+                       "chr1\t150\t160\te\t.\t+\n"
+                       "chr1 500  600 f 800 +  \n";
+
+    auto names = [&](const bed::Predicate& pred)
+    {
+        std::string result;
+        BEDFilter<TupleType>(pred).for_each(text, [&](const auto& bed){ result += std::get<bed::Col::name>(bed.data); });
+        return result;
+    };
+
+    EXPECT_EQ("abcdef", names(bed::Predicate()));
+
+    bed::Predicate chrom;
+    chrom.chrom = "chr1";
+    EXPECT_EQ("acef", names(chrom));
+
+    bed::Predicate region = chrom;
+    region.start = 190;
+    region.end = 550;
+    EXPECT_EQ("acf", names(region));
+
+    bed::Predicate score;
+    score.min_score = 700;
+    EXPECT_EQ("abdf", names(score));   // "." is not a score
+
+    bed::Predicate strand = score;
+    strand.strand = '-';
+    EXPECT_EQ("d", names(strand));
+
+    // matching records are the same as the unfiltered parser's
+    auto all = BEDParallelParser<TupleType>(1).parse(text.substr(text.find('\n') + 1));
+    for(std::size_t threads: { 1, 3 })
+    {
+        auto v_bed = BEDFilter<TupleType>(chrom, threads).select(text);
+        ASSERT_EQ(4u, v_bed.size());
+        EXPECT_EQ(all[0].data, v_bed[0].data);
+        EXPECT_EQ(all[5].data, v_bed[3].data);
+    }
+
+    // BED3 records with a predicate on columns they do not keep
+    BEDFilter<std::tuple<std::string, uint32_t, uint32_t>> bed3(strand);
+    std::istringstream iss(text);
+    BED<std::tuple<std::string, uint32_t, uint32_t>> bed;
+    ASSERT_TRUE(bed3.get_obj(iss, bed));
+    EXPECT_EQ("chr2\t100\t200", bed.to_string());
+    EXPECT_FALSE(bed3.get_obj(iss, bed));
+}
+
+TEST(BEDLineIndex, query_and_record)
+{
+    using TupleType = std::tuple <std::string, uint32_t, uint32_t, std::string>;
+    auto path = (boost::filesystem::temp_directory_path() / boost::filesystem::unique_path()).string();
+
+    std::vector<BEDRecord<TupleType>> all;
+    {
+        std::ofstream ofs(path);
+        ofs << "track name=Lines\n# comment\n";
+        std::mt19937 rng(7);
+        for(int c = 1; c <= 3; c++)
+        {
+            uint32_t start = 0;
+            for(int i = 0; i < 500; i++)
+            {
+                start += rng() % 50;
+                BEDRecord<TupleType> bed;
+                bed.data = { "chr" + std::to_string(c), start, start + 1 + rng() % (i % 50 == 0 ? 5000 : 100),
+                             "r" + std::to_string(all.size()) };
+                ofs << bed.to_string() << "\n";
+                if(i == 250)
+                    ofs << "\n";
+                all.push_back(bed);
+            }
+        }
+    }
+
+    for(std::size_t threads: { 1, 3 })
+    {
+        auto index = BEDLineIndex::build(path, threads, 16);
+        index.save(BEDLineIndex::default_path(path));
+        EXPECT_EQ(all.size(), index.size());
+        EXPECT_EQ(3u, index.chrom_dict().size());
+
+        BEDLineReader<TupleType> reader(path);
+        for(uint64_t n: { 0, 1, 15, 16, 17, 251, 499, 500, 1234, 1499 })
+            EXPECT_EQ(all[n].data, reader.record(n).data);
+        EXPECT_THROW(reader.record(all.size()), std::out_of_range);
+
+        std::mt19937 rng(threads);
+        for(int q = 0; q < 50; q++)
+        {
+            bed::Region region;
+            region.chrom = "chr" + std::to_string(1 + rng() % 4);
+            region.start = rng() % 13000;
+            region.end = region.start + rng() % 2000;
+
+            std::vector<std::string> expected, got;
+            for(auto& bed: all)
+                if(region.overlaps(std::get<0>(bed.data), std::get<1>(bed.data), std::get<2>(bed.data)))
+                    expected.push_back(std::get<3>(bed.data));
+            for(auto& bed: reader.query(region))
+                got.push_back(std::get<3>(bed.data));
+            EXPECT_EQ(expected, got);
+        }
+    }
+
+    // a corrupt index is rejected on load
+    {
+        const auto index_path = BEDLineIndex::default_path(path);
+        std::string bytes;
+        {
+            std::ifstream ifs(index_path, std::ios::binary);
+            bytes.assign(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+        }
+        auto load_bad = [&](const std::string& content)
+        {
+            std::ofstream(index_path, std::ios::binary | std::ios::trunc) << content;
+            BEDLineIndex::load(index_path);
+        };
+        // first chrom entry, after the header and the name "chr1"
+        const std::size_t entry = sizeof(bed::detail::LineIndexHeader) + sizeof(uint32_t) + 4;
+        auto set = [&](std::size_t offset, uint64_t value)
+        {
+            auto corrupt = bytes;
+            std::memcpy(&corrupt[offset], &value, sizeof(value));
+            return corrupt;
+        };
+
+        EXPECT_NO_THROW(load_bad(bytes));
+        EXPECT_THROW(load_bad(set(entry + offsetof(bed::ChromEntry, sample_end), 1 << 20)), std::runtime_error);
+        EXPECT_THROW(load_bad(set(entry + offsetof(bed::ChromEntry, end), 1 << 30)), std::runtime_error);
+        // sample_num * sizeof(LineSample) wraps around to the real size
+        uint64_t sample_num;
+        std::memcpy(&sample_num, &bytes[offsetof(bed::detail::LineIndexHeader, sample_num)], sizeof(sample_num));
+        EXPECT_THROW(load_bad(set(offsetof(bed::detail::LineIndexHeader, sample_num), sample_num + (uint64_t(1) << 61))),
+                     std::runtime_error);
+
+        auto duplicate = bytes;
+        auto second = duplicate.find("chr2");
+        ASSERT_NE(std::string::npos, second);
+        duplicate[second + 3] = '1';
+        EXPECT_THROW(load_bad(duplicate), std::runtime_error);
+
+        std::ofstream(index_path, std::ios::binary | std::ios::trunc) << bytes;
+    }
+
+    // a changed file is rejected, unsorted input cannot be indexed
+    {
+        std::ofstream ofs(path, std::ios::app);
+        ofs << "chr1\t0\t10\tlate\n";
+    }
+    EXPECT_THROW(BEDLineReader<TupleType>{ path }, std::runtime_error);
+    EXPECT_THROW(BEDLineIndex::build(path, 2, 16), std::runtime_error);
+
+    boost::filesystem::remove(path);
+    boost::filesystem::remove(BEDLineIndex::default_path(path));
+}
+
+TEST(BEDPartitioner, shards_and_run)
+{
+    namespace fs = boost::filesystem;
+    using TupleType = std::tuple <std::string, uint32_t, uint32_t, std::string>;
+    auto dir = fs::temp_directory_path() / fs::unique_path();
+    fs::create_directories(dir);
+
+    std::string text = "track name=Shards\n";
+    std::vector<std::string> lines;
+    std::mt19937 rng(3);
+    for(int i = 0; i < 3000; i++)
+    {
+        auto start = rng() % 50000;
+        lines.push_back("chr" + std::to_string(1 + i % 3) + "\t" + std::to_string(start) + "\t"
+                        + std::to_string(start + 10) + "\tr" + std::to_string(i));
+        text += lines.back() + "\n";
+    }
+
+    for(auto mode: { bed::PartitionMode::chrom, bed::PartitionMode::bin })
+    {
+        bed::PartitionOptions opts;
+        opts.mode = mode;
+        opts.bin_size = 20000;
+        opts.buffer_size = 1000;    // force several appends per shard
+
+        std::istringstream iss(text);
+        auto manifest = BEDPartitioner(dir.string(), opts).partition(iss);
+        manifest.save((dir / "manifest.tsv").string());
+        auto loaded = bed::Manifest::load((dir / "manifest.tsv").string());
+
+        ASSERT_EQ(mode == bed::PartitionMode::chrom ? 3u : 9u, loaded.shards.size());
+        EXPECT_EQ("track name=Shards", loaded.track_line);
+        EXPECT_EQ(3000u, loaded.records());
+        EXPECT_EQ("chr1", loaded.shards[0].chrom);
+
+        // every shard holds its lines in input order, behind the track line
+        for(auto& shard: loaded.shards)
+        {
+            std::string expected = "track name=Shards\n";
+            uint64_t records = 0;
+            for(auto& line: lines)
+            {
+                std::istringstream ls(line);
+                std::string chrom;
+                uint32_t start;
+                ls >> chrom >> start;
+                if(chrom == shard.chrom && start >= shard.bin_start && start < shard.bin_end)
+                {
+                    expected += line + "\n";
+                    records++;
+                }
+            }
+            std::ifstream ifs(shard.path);
+            std::string content((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+            EXPECT_EQ(expected, content);
+            EXPECT_EQ(records, shard.records);
+            EXPECT_EQ(content.size(), shard.bytes);
+            EXPECT_LE(shard.bin_start, shard.min_start);
+        }
+
+        // results come back in manifest order whatever the thread number
+        for(std::size_t threads: { 1, 4 })
+        {
+            auto counts = bed::run_shards<TupleType>(loaded, threads, [](const bed::Shard& shard, auto& v_bed)
+            {
+                return std::make_pair(shard.chrom, v_bed.size());
+            });
+            ASSERT_EQ(loaded.shards.size(), counts.size());
+            for(std::size_t s = 0; s < counts.size(); s++)
+            {
+                EXPECT_EQ(loaded.shards[s].chrom, counts[s].first);
+                EXPECT_EQ(loaded.shards[s].records, counts[s].second);
+            }
+
+            auto total = bed::run_shards<TupleType>(loaded, threads,
+                [](const bed::Shard&, auto& v_bed){ return v_bed.size(); },
+                std::size_t(0), [](std::size_t& sum, std::size_t n){ sum += n; });
+            EXPECT_EQ(3000u, total);
+        }
+        for(auto& shard: loaded.shards)
+            fs::remove(shard.path);
+    }
+
+    // chrom names are escaped into file names inside dir, one per chrom
+    std::istringstream iss("a/b\t0\t10\n../up\t0\t10\n.hidden\t0\t10\na%2Fb\t0\t10\n");
+    auto manifest = BEDPartitioner(dir.string()).partition(iss);
+    ASSERT_EQ(4u, manifest.shards.size());
+    EXPECT_EQ("a/b", manifest.shards[0].chrom);
+    EXPECT_EQ((dir / "a%2Fb.bed").string(), manifest.shards[0].path);
+    EXPECT_EQ((dir / "%2E.%2Fup.bed").string(), manifest.shards[1].path);
+    EXPECT_EQ((dir / "%2Ehidden.bed").string(), manifest.shards[2].path);
+    EXPECT_EQ((dir / "a%252Fb.bed").string(), manifest.shards[3].path);
+    for(auto& shard: manifest.shards)
+    {
+        std::ifstream ifs(shard.path);
+        std::string line;
+        ASSERT_TRUE(std::getline(ifs, line));
+        EXPECT_EQ(shard.chrom + "\t0\t10", line);
+    }
+    EXPECT_EQ("%", bed::shard_name(""));
+    fs::remove_all(dir);
+}
+
+TEST(BEDTailReader, poll_and_resume)
+{
+    using TupleType = std::tuple <std::string, uint32_t, uint32_t, std::string>;
+    auto path = (boost::filesystem::temp_directory_path() / boost::filesystem::unique_path()).string();
+    auto cp_path = path + ".checkpoint";
+    auto append = [&](const std::string& text){ std::ofstream(path, std::ios::app) << text; };
+
+    std::vector<BEDRecord<TupleType>> all;
+    std::string lines;
+    std::mt19937 rng(11);
+    for(int i = 0; i < 300; i++)
+    {
+        BEDRecord<TupleType> bed;
+        auto start = rng() % 10000;
+        bed.data = { "chr" + std::to_string(1 + rng() % 2), start, start + 1 + rng() % 300, "r" + std::to_string(i) };
+        all.push_back(bed);
+        lines += bed.to_string() + "\n";
+    }
+    auto line_end = [&](std::size_t n)    // byte offset after line n - 1
+    {
+        std::size_t pos = 0;
+        for(std::size_t i = 0; i < n; i++)
+            pos = lines.find('\n', pos) + 1;
+        return pos;
+    };
+
+    append("track name=Tail\n");
+    // the 100th line is cut in the middle: it must wait for the next poll
+    append(lines.substr(0, line_end(99) + 5));
+
+    BEDIntervalIndex index;
+    BEDTable<TupleType> table;
+    std::vector<uint64_t> numbers;
+    {
+        BEDTailReader<TupleType> reader(path, bed::Checkpoint(), 64);   // small reads cross lines
+        EXPECT_EQ(99u, reader.poll(index));
+        EXPECT_EQ("track name=Tail", reader.header().track_line);
+        EXPECT_EQ(0u, reader.poll(index));
+
+        append(lines.substr(line_end(99) + 5, line_end(200) - line_end(99) - 5));
+        EXPECT_EQ(101u, reader.poll(index));
+        EXPECT_EQ(200u, reader.checkpoint().lines);
+        reader.checkpoint().save(cp_path);
+    }
+
+    // a restarted consumer carries on from the checkpoint
+    append(lines.substr(line_end(200)));
+    {
+        BEDTailReader<TupleType> reader(path, bed::Checkpoint::load(cp_path));
+        EXPECT_EQ("track name=Tail", reader.header().track_line);
+        EXPECT_EQ(100u, reader.poll(index));
+    }
+    EXPECT_EQ(all.size(), index.size());
+
+    BEDTailReader<TupleType> from_start(path);
+    from_start.poll([&](const auto&, uint64_t line){ numbers.push_back(line); });
+    EXPECT_EQ(300u, numbers.size());
+    EXPECT_EQ(299u, numbers.back());
+
+    BEDTailReader<TupleType> table_reader(path);
+    EXPECT_EQ(300u, table_reader.poll(table));
+    ASSERT_EQ(300u, table.size());
+    BEDRecord<TupleType> row;
+    table.get(123, row);
+    EXPECT_EQ(all[123].data, row.data);
+
+    // the incrementally built index answers like one built at once
+    BEDIntervalIndex full(all);
+    for(int q = 0; q < 50; q++)
+    {
+        std::string chrom = "chr" + std::to_string(1 + rng() % 2);
+        uint32_t start = rng() % 10000;
+        auto a = full.query(chrom, start, start + 200);
+        auto b = index.query(chrom, start, start + 200);
+        std::sort(a.begin(), a.end());
+        std::sort(b.begin(), b.end());
+        EXPECT_EQ(a, b);
+    }
+
+    // a truncated file no longer matches the checkpoint
+    std::ofstream(path, std::ios::trunc) << "chr1\t0\t10\tnew\n";
+    BEDTailReader<TupleType> stale(path, bed::Checkpoint::load(cp_path));
+    EXPECT_THROW(stale.poll([](const auto&, uint64_t){}), std::runtime_error);
+
+    boost::filesystem::remove(path);
+    boost::filesystem::remove(cp_path);
+}